@@ -391,7 +391,16 @@ void cells_update_ghosts()
     /* methods using skin rsp. rebuild_verletlist */
   case CELL_STRUCTURE_DOMDEC:
     if(dd.use_vList) {
-      if (rebuild_verletlist == 1)
+      if (rebuild_vlist_pending) {
+	/* The verlet criterion is still being reduced. Since resorting
+	   is rare, speculatively update the ghost positions in the
+	   meantime and only throw them away if a resort is necessary. */
+	ghost_communicator(&cell_structure.update_ghost_pos_comm);
+	announce_rebuild_vlist_wait();
+	if (rebuild_verletlist == 1)
+	  cells_resort_particles(CELL_NEIGHBOR_EXCHANGE);
+      }
+      else if (rebuild_verletlist == 1)
 	/* Communication step:  number of ghosts and ghost information */
 	cells_resort_particles(CELL_NEIGHBOR_EXCHANGE);
       else
@@ -404,6 +413,7 @@ void cells_update_ghosts()
     /* layered has a skin only in z in principle, but
        probably we can live very well with the standard skin */
   case CELL_STRUCTURE_LAYERED:
+    announce_rebuild_vlist_wait();
     if (rebuild_verletlist == 1)
       /* Communication step:  number of ghosts and ghost information */
       cells_resort_particles(CELL_NEIGHBOR_EXCHANGE);
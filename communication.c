@@ -45,6 +45,7 @@
 #include "maggs.h"
 #include "elc.h"
 #include "iccp3m.h"
+#include "magnetic_non_p3m__methods.h"
 #include "statistics_chain.h"
 #include "statistics_fluid.h"
 #include "topology.h"
@@ -190,9 +191,11 @@ typedef void (SlaveCallback)(int node, int param);
 #define REQ_SET_MU_E     57
 /** Action number for \ref mpi_recv_fluid_populations. */
 #define REQ_GET_FLUID_POP 58
+/** Action number for \ref mpi_coulomb_energy_change. */
+#define REQ_COULOMB_CHANGE 59
 
 /** Total number of action numbers. */
-#define REQ_MAXIMUM 59
+#define REQ_MAXIMUM 60
 
 /*@}*/
 
@@ -260,6 +263,7 @@ void mpi_send_isVirtual_slave(int node, int parm);
 void mpi_bcast_tf_params_slave(int node, int parm);
 void mpi_send_rotational_inertia_slave(int node, int parm);
 void mpi_recv_fluid_populations_slave(int node, int parm);
+void mpi_coulomb_energy_change_slave(int node, int parm);
 /*@}*/
 
 /** A list of which function has to be called for
@@ -323,7 +327,8 @@ static SlaveCallback *slave_callbacks[] = {
   mpi_bcast_lb_boundary_slave,      /* 55: REQ_BCAST_LBBOUNDARY */
   mpi_recv_fluid_border_flag_slave,  /* 56: REQ_LB_GET_BORDER_FLAG */
   mpi_send_mu_E_slave,                 /* 57: REQ_SET_MU_E */
-  mpi_recv_fluid_populations_slave            /* 57: REQ_GET_FLUID_POP */
+  mpi_recv_fluid_populations_slave,           /* 58: REQ_GET_FLUID_POP */
+  mpi_coulomb_energy_change_slave             /* 59: REQ_COULOMB_CHANGE */
 };
 
 /** Names to be printed when communication debugging is on. */
@@ -394,9 +399,10 @@ char *names[] = {
   "REQ_ICCP3M_INIT",      /* 53 */
   "SET_RINERTIA",   /* 54 */
   "REQ_BCAST_LBBOUNDARY", /* 55 */
-  "REQ_LB_GET_BORDER_FLAG" /* 56 */
-  "REQ_SEND_MUE" /* 57 */
-  "REQ_GET_FLUID_POP" /* 58 */
+  "REQ_LB_GET_BORDER_FLAG", /* 56 */
+  "REQ_SEND_MUE", /* 57 */
+  "REQ_GET_FLUID_POP", /* 58 */
+  "REQ_COULOMB_CHANGE" /* 59 */
 };
 
 /** the requests are compiled here. So after a crash you get the last issued request */
@@ -1936,6 +1942,11 @@ void mpi_bcast_coulomb_params_slave(int node, int parm)
  case  DIPOLAR_DS:
     break;   
 #endif 
+#ifdef DIPOLAR_BARNES_HUT
+  case DIPOLAR_BH:
+    MPI_Bcast(&dipolar_bh_params, sizeof(Dipolar_BH_struct), MPI_BYTE, 0, MPI_COMM_WORLD);
+    break;
+#endif
   default:
     fprintf(stderr, "%d: INTERNAL ERROR: cannot bcast dipolar params for unknown method %d\n", this_node, coulomb.Dmethod);
     errexit();
@@ -2779,6 +2790,27 @@ void mpi_recv_fluid_populations_slave(int node, int index) {
 #endif
 }
 
+/*********************** REQ_COULOMB_CHANGE ****************/
+
+#ifdef ELECTROSTATICS
+double mpi_coulomb_energy_change(int n, ChargeChange *changes)
+{
+  mpi_issue(REQ_COULOMB_CHANGE, -1, n);
+  MPI_Bcast(changes, n*sizeof(ChargeChange), MPI_BYTE, 0, MPI_COMM_WORLD);
+  return coulomb_energy_change(n, changes);
+}
+#endif
+
+void mpi_coulomb_energy_change_slave(int node, int n)
+{
+#ifdef ELECTROSTATICS
+  ChargeChange *changes = malloc(n*sizeof(ChargeChange));
+
+  MPI_Bcast(changes, n*sizeof(ChargeChange), MPI_BYTE, 0, MPI_COMM_WORLD);
+  coulomb_energy_change(n, changes);
+  free(changes);
+#endif
+}
 
 /*********************** MAIN LOOP for slaves ****************/
 
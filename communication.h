@@ -47,6 +47,7 @@
 #include "particle_data.h"
 #include "random.h"
 #include "topology.h"
+#include "interaction_data.h"
 
 /**************************************************
  * exported variables
@@ -468,6 +469,17 @@ int mpi_iccp3m_init(int dummy);
  */
 void mpi_recv_fluid_populations(int node, int index, double *pop);
 
+#ifdef ELECTROSTATICS
+/** Issue REQ_COULOMB_CHANGE: calculate the change of the electrostatic
+    energy for trial changes of a few charges, see \ref
+    coulomb_energy_change.
+    @param n       number of changes
+    @param changes the changes, only needed on the master node
+    @return the energy change
+*/
+double mpi_coulomb_energy_change(int n, ChargeChange *changes);
+#endif
+
 
 
 /** Issue REQ_GET_ERRS: gather all error messages from all nodes and set the interpreter result
@@ -55,6 +55,15 @@
 #endif
 
 
+#ifdef DIPOLAR_BARNES_HUT
+
+#ifndef MAGNETOSTATICS 
+#error  DIPOLAR_BARNES_HUT needs MAGNETOSTATICS in order to work
+#endif
+
+#endif
+
+
 #ifdef MDLC
   
   #ifndef MAGNETOSTATICS
@@ -258,6 +267,9 @@ int compilation_callback(Tcl_Interp *interp)
 #endif
 #ifdef MAGNETIC_DIPOLAR_DIRECT_SUM
   Tcl_AppendResult(interp, "{ MAGNETIC_DIPOLAR_DIRECT_SUM } ", (char *) NULL);
+#endif
+#ifdef DIPOLAR_BARNES_HUT
+  Tcl_AppendResult(interp, "{ DIPOLAR_BARNES_HUT } ", (char *) NULL);
 #endif
  Tcl_AppendResult(interp, "}", (char *) NULL);
   return (TCL_OK);
@@ -94,6 +94,11 @@
 #endif
 
 
+/* the particle mesh path of the Ewald sum needs the FFTW3 interface */
+#if defined(ELECTROSTATICS) && defined(FFTW) && FFTW == 3
+#define EWALD_PME
+#endif
+
 /* activate dipolar P3M only with FFTW */
 #if defined(MAGNETOSTATICS) && defined(FFTW)
 #define ELP3M
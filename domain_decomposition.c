@@ -28,6 +28,17 @@
 /** half the number of cell neighbors in 3 Dimensions. */
 #define CELLS_MAX_NEIGHBORS 14
 
+/** number of bits per dimension used for the Morton key of a particle
+    within its cell, see \ref dd_sort_cells_along_curve. */
+#define DD_MORTON_BITS 10
+
+/** maximal number of distinct neighbor nodes a particle can migrate
+    to in \ref dd_migrate_particles_single_pass. */
+#define DD_MAX_MIGRATION_NEIGHBORS 26
+
+/** MPI tag for the particle migration in \ref dd_migrate_particles_single_pass. */
+#define REQ_DD_MIGRATE 0xab
+
 /*@}*/
 
 /************************************************/
@@ -41,6 +52,12 @@ int max_num_cells = CELLS_MAX_NUM_CELLS;
 int min_num_cells = 1;
 double max_skin   = 0.0;
 
+int dd_sort_interval = 0;
+
+/** number of particle exchanges since the last reordering along the
+    space filling curve. */
+static int dd_resorts_since_sort = 0;
+
 /*@}*/
 
 /************************************************************/
@@ -661,6 +678,9 @@ void dd_topology_init(CellPList *old)
   dd_assign_prefetches(&cell_structure.exchange_ghosts_comm);
   dd_assign_prefetches(&cell_structure.update_ghost_pos_comm);
   dd_assign_prefetches(&cell_structure.collect_ghost_force_comm);
+  /* the communicators used in every time step keep their buffers and requests */
+  cell_structure.update_ghost_pos_comm.persistent    = 1;
+  cell_structure.collect_ghost_force_comm.persistent = 1;
 
 #ifdef LB
   dd_prepare_comm(&cell_structure.ghost_lbcoupling_comm, GHOSTTRANS_COUPLING) ;
@@ -714,6 +734,377 @@ void dd_topology_release()
 }
 
 /************************************************************/
+
+/** Spread the lowest \ref DD_MORTON_BITS bits of i such that two zero
+    bits are between each two bits of the input. */
+MDINLINE unsigned int dd_morton_spread(unsigned int i)
+{
+  i &= (1u << DD_MORTON_BITS) - 1;
+  i = (i | (i << 16)) & 0x030000FF;
+  i = (i | (i <<  8)) & 0x0300F00F;
+  i = (i | (i <<  4)) & 0x030C30C3;
+  i = (i | (i <<  2)) & 0x09249249;
+  return i;
+}
+
+/** Morton (Z-order) key of a position within a cell whose lower left
+    corner is at corner. */
+MDINLINE unsigned int dd_morton_key(double pos[3], double corner[3])
+{
+  int i;
+  unsigned int key = 0;
+  double ci;
+
+  for (i = 0; i < 3; i++) {
+    ci = (pos[i] - corner[i])*dd.inv_cell_size[i]*(1 << DD_MORTON_BITS);
+    /* particles in the left overs cell might be out of range */
+    if (ci < 0) ci = 0;
+    if (ci > (1 << DD_MORTON_BITS) - 1) ci = (1 << DD_MORTON_BITS) - 1;
+    key |= dd_morton_spread((unsigned int)ci) << i;
+  }
+  return key;
+}
+
+/** entry of the sort index for \ref dd_sort_cells_along_curve */
+typedef struct {
+  unsigned int key;
+  int ind;
+} DDSortKey;
+
+static int dd_compare_sort_keys(const void *a, const void *b)
+{
+  unsigned int ka = ((DDSortKey *)a)->key, kb = ((DDSortKey *)b)->key;
+  if (ka != kb) return (ka < kb) ? -1 : 1;
+  /* keep the sort stable */
+  return ((DDSortKey *)a)->ind - ((DDSortKey *)b)->ind;
+}
+
+/** Reorder the particles within each local cell along a Morton curve,
+    so that particles that are close in space are also close in
+    memory. Across cells and nodes, the spatial order is given by the
+    domain decomposition and the cell grid anyways. Since this moves
+    particles in memory, it may only be called when the Verlet lists
+    and the ghosts are rebuilt afterwards, i.e. during resorting. */
+static void dd_sort_cells_along_curve()
+{
+  int c, i, m, n, o, max_np = 0;
+  double corner[3];
+  Cell *cell;
+  DDSortKey *keys;
+  Particle *tmp;
+
+  for (c = 0; c < local_cells.n; c++)
+    if (local_cells.cell[c]->n > max_np) max_np = local_cells.cell[c]->n;
+  if (max_np < 2)
+    return;
+
+  keys = malloc(max_np*sizeof(DDSortKey));
+  tmp  = malloc(max_np*sizeof(Particle));
+
+  DD_LOCAL_CELLS_LOOP(m,n,o) {
+    cell = &cells[get_linear_index(m,n,o,dd.ghost_cell_grid)];
+    if (cell->n < 2)
+      continue;
+
+    corner[0] = my_left[0] + (m-1)*dd.cell_size[0];
+    corner[1] = my_left[1] + (n-1)*dd.cell_size[1];
+    corner[2] = my_left[2] + (o-1)*dd.cell_size[2];
+    for (i = 0; i < cell->n; i++) {
+      keys[i].key = dd_morton_key(cell->part[i].r.p, corner);
+      keys[i].ind = i;
+    }
+    qsort(keys, cell->n, sizeof(DDSortKey), dd_compare_sort_keys);
+
+    /* particles are plain structs with pointers to their bond lists
+       etc., so they can be moved around like in move_indexed_particle */
+    for (i = 0; i < cell->n; i++)
+      memcpy(&tmp[i], &cell->part[keys[i].ind], sizeof(Particle));
+    memcpy(cell->part, tmp, cell->n*sizeof(Particle));
+    update_local_particles(cell);
+  }
+
+  free(tmp);
+  free(keys);
+}
+
+/************************************************************/
+
+/** send and receive buffers for one neighbor node in \ref dd_migrate_particles_single_pass. */
+typedef struct {
+  /** the neighbor node. */
+  int node;
+  /** particles to send. */
+  ParticleList send;
+  /** bonds and exclusions of the particles to send. */
+  IntList send_dyn;
+  /** number of particles and bond/exclusion ints to send. */
+  int send_cnt[2];
+  /** received particles. */
+  ParticleList recv;
+  /** bonds and exclusions of the received particles. */
+  IntList recv_dyn;
+  /** number of particles and bond/exclusion ints to receive. */
+  int recv_cnt[2];
+} DDMigrationBuffer;
+
+/** Find the distinct nodes among the up to 26 neighbor nodes a
+    particle can migrate to. Since the neighborhood relation is
+    symmetric, every node of the list expects messages from this node
+    as well.
+    @param nb        the buffers to initialize, one per distinct neighbor node.
+    @param nb_index  for each of the 27 offsets (-1,0,1)^3, the index into nb,
+                     or -1 if particles do not migrate in that direction.
+    @return the number of distinct neighbor nodes. */
+static int dd_init_migration_neighbors(DDMigrationBuffer *nb, int nb_index[27])
+{
+  int i, j, dir, valid, node, n_nb = 0;
+  int off[3], pos[3];
+
+  for (i = 0; i < 27; i++) {
+    nb_index[i] = -1;
+    off[0] = i%3 - 1; off[1] = (i/3)%3 - 1; off[2] = i/9 - 1;
+    if (off[0] == 0 && off[1] == 0 && off[2] == 0)
+      continue;
+
+    valid = 1;
+    for (dir = 0; dir < 3; dir++) {
+      if (off[dir] != 0) {
+	/* single node directions are handled by folding */
+	if (node_grid[dir] == 1)
+	  valid = 0;
+#ifdef PARTIAL_PERIODIC
+	if (!PERIODIC(dir) && boundary[2*dir + (off[dir] > 0)] != 0)
+	  valid = 0;
+#endif
+      }
+      pos[dir] = (node_pos[dir] + off[dir] + node_grid[dir]) % node_grid[dir];
+    }
+    if (!valid)
+      continue;
+
+    node = map_array_node(pos);
+    for (j = 0; j < n_nb; j++)
+      if (nb[j].node == node)
+	break;
+    if (j == n_nb) {
+      nb[j].node = node;
+      init_particlelist(&nb[j].send);
+      init_intlist(&nb[j].send_dyn);
+      init_particlelist(&nb[j].recv);
+      init_intlist(&nb[j].recv_dyn);
+      n_nb++;
+    }
+    nb_index[i] = j;
+  }
+  return n_nb;
+}
+
+/** Put the particles that have left the node domain into the send
+    buffers of their destination nodes, folding them if they cross the
+    box boundary, and sort the remaining ones into their cells.
+    @return 0 if some particles are outside of the node domain and
+    cannot be send to a neighbor, 1 otherwise. */
+static int dd_classify_particles(DDMigrationBuffer *nb, int nb_index[27])
+{
+  int c, p, dir, off, ind, ok = 1;
+  ParticleList *cell, *sort_cell;
+  Particle *part;
+
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    for (p = 0; p < cell->n; p++) {
+      part = &cell->part[p];
+      ind = 0;
+      for (dir = 2; dir >= 0; dir--) {
+	off = 0;
+	if (node_grid[dir] == 1) {
+#ifdef PARTIAL_PERIODIC
+	  if (PERIODIC(dir))
+#endif
+	    fold_coordinate(part->r.p, part->l.i, dir);
+	}
+	else if (part->r.p[dir] - my_left[dir] < -ROUND_ERROR_PREC)
+	  off = -1;
+	else if (part->r.p[dir] - my_right[dir] >= ROUND_ERROR_PREC)
+	  off = 1;
+
+	if (off != 0) {
+#ifdef PARTIAL_PERIODIC
+	  if (!PERIODIC(dir) && boundary[2*dir + (off > 0)] != 0)
+	    off = 0;
+	  else
+#endif
+	    /* leaving the box, fold like dd_append_particles does on the receiver side */
+	    if (boundary[2*dir + (off > 0)] != 0)
+	      fold_coordinate(part->r.p, part->l.i, dir);
+	}
+	ind = 3*ind + off + 1;
+      }
+
+      if (nb_index[ind] >= 0) {
+	CELL_TRACE(fprintf(stderr,"%d: dd_migrate: send part %d to %d\n",this_node,part->p.identity,nb[nb_index[ind]].node));
+	move_indexed_particle(&nb[nb_index[ind]].send, cell, p);
+	if(p < cell->n) p--;
+      }
+      else {
+	sort_cell = dd_save_position_to_cell(part->r.p);
+	if (sort_cell == NULL) {
+	  CELL_TRACE(fprintf(stderr, "%d: dd_migrate: Particle %d (%f,%f,%f) not inside node domain.\n",
+			     this_node,part->p.identity,part->r.p[0],part->r.p[1],part->r.p[2]));
+	  ok = 0;
+	  sort_cell = local_cells.cell[0];
+	}
+	if (sort_cell != cell) {
+	  move_indexed_particle(sort_cell, cell, p);
+	  if(p < cell->n) p--;
+	}
+      }
+    }
+  }
+  return ok;
+}
+
+/** Serialize the bonds and exclusions of the particles to send, like \ref send_particles. */
+static void dd_pack_migration_dyn(DDMigrationBuffer *nb)
+{
+  int pc, size;
+
+  for (pc = 0; pc < nb->send.n; pc++) {
+    Particle *p = &nb->send.part[pc];
+    size = nb->send_dyn.n + p->bl.n;
+#ifdef EXCLUSIONS
+    size += p->el.n;
+#endif
+    realloc_intlist(&nb->send_dyn, size);
+    memcpy(nb->send_dyn.e + nb->send_dyn.n, p->bl.e, p->bl.n*sizeof(int));
+    nb->send_dyn.n += p->bl.n;
+#ifdef EXCLUSIONS
+    memcpy(nb->send_dyn.e + nb->send_dyn.n, p->el.e, p->el.n*sizeof(int));
+    nb->send_dyn.n += p->el.n;
+#endif
+  }
+  nb->send_cnt[0] = nb->send.n;
+  nb->send_cnt[1] = nb->send_dyn.n;
+}
+
+/** Restore the bonds and exclusions of the received particles, like
+    \ref recv_particles, and put the particles directly into their cells.
+    @return 0 if some particles are not inside the node domain, 1 otherwise. */
+static int dd_unpack_migration(DDMigrationBuffer *nb)
+{
+  int pc, read = 0, ok = 1;
+  Cell *cell;
+
+  for (pc = 0; pc < nb->recv.n; pc++) {
+    Particle *p = &nb->recv.part[pc];
+
+#ifdef ADDITIONAL_CHECKS
+    if (local_particles[p->p.identity] != NULL) {
+      fprintf(stderr, "%d: transmitted particle %d is already here...\n", this_node, p->p.identity);
+      errexit();
+    }
+#endif
+
+    if (p->bl.n > 0) {
+      alloc_intlist(&p->bl, p->bl.n);
+      memcpy(p->bl.e, &nb->recv_dyn.e[read], p->bl.n*sizeof(int));
+      read += p->bl.n;
+    }
+    else
+      p->bl.e = NULL;
+#ifdef EXCLUSIONS
+    if (p->el.n > 0) {
+      alloc_intlist(&p->el, p->el.n);
+      memcpy(p->el.e, &nb->recv_dyn.e[read], p->el.n*sizeof(int));
+      read += p->el.n;
+    }
+    else
+      p->el.e = NULL;
+#endif
+
+    cell = dd_save_position_to_cell(p->r.p);
+    if (cell == NULL) {
+      CELL_TRACE(fprintf(stderr, "%d: dd_migrate: received particle %d (%f,%f,%f) not inside node domain.\n",
+			 this_node,p->p.identity,p->r.p[0],p->r.p[1],p->r.p[2]));
+      ok = 0;
+      cell = local_cells.cell[0];
+    }
+    append_indexed_particle(cell, p);
+  }
+  return ok;
+}
+
+/** Particle exchange for \ref CELL_NEIGHBOR_EXCHANGE in a single pass.
+    In contrast to the direction by direction exchange, particles are
+    sent directly to any of the up to 26 neighbor nodes, so that each
+    pair of neighbors exchanges only one message with the sizes and
+    then the particle data, using non-blocking communication.
+    @return 0 if some particles moved more than one node domain, 1 otherwise. */
+static int dd_migrate_particles_single_pass()
+{
+  DDMigrationBuffer nb[DD_MAX_MIGRATION_NEIGHBORS];
+  int nb_index[27];
+  MPI_Request req[4*DD_MAX_MIGRATION_NEIGHBORS];
+  MPI_Status stat[4*DD_MAX_MIGRATION_NEIGHBORS];
+  int n_nb, n_req, j, pc, ok;
+
+  n_nb = dd_init_migration_neighbors(nb, nb_index);
+  ok   = dd_classify_particles(nb, nb_index);
+
+  /* exchange the sizes. Messages between two nodes are matched in
+     order, so the data below uses the same tag. */
+  n_req = 0;
+  for (j = 0; j < n_nb; j++) {
+    dd_pack_migration_dyn(&nb[j]);
+    MPI_Irecv(nb[j].recv_cnt, 2, MPI_INT, nb[j].node, REQ_DD_MIGRATE, MPI_COMM_WORLD, &req[n_req++]);
+    MPI_Isend(nb[j].send_cnt, 2, MPI_INT, nb[j].node, REQ_DD_MIGRATE, MPI_COMM_WORLD, &req[n_req++]);
+  }
+  MPI_Waitall(n_req, req, stat);
+
+  /* exchange particles and their bonds and exclusions */
+  n_req = 0;
+  for (j = 0; j < n_nb; j++) {
+    CELL_TRACE(fprintf(stderr,"%d: dd_migrate: send %d/recv %d particles to/from %d\n",
+		       this_node,nb[j].send_cnt[0],nb[j].recv_cnt[0],nb[j].node));
+    if (nb[j].recv_cnt[0] > 0) {
+      realloc_particlelist(&nb[j].recv, nb[j].recv.n = nb[j].recv_cnt[0]);
+      MPI_Irecv(nb[j].recv.part, nb[j].recv_cnt[0]*sizeof(Particle), MPI_BYTE, nb[j].node,
+		REQ_DD_MIGRATE, MPI_COMM_WORLD, &req[n_req++]);
+    }
+    if (nb[j].recv_cnt[1] > 0) {
+      alloc_intlist(&nb[j].recv_dyn, nb[j].recv_cnt[1]);
+      MPI_Irecv(nb[j].recv_dyn.e, nb[j].recv_cnt[1]*sizeof(int), MPI_BYTE, nb[j].node,
+		REQ_DD_MIGRATE, MPI_COMM_WORLD, &req[n_req++]);
+    }
+    if (nb[j].send_cnt[0] > 0)
+      MPI_Isend(nb[j].send.part, nb[j].send_cnt[0]*sizeof(Particle), MPI_BYTE, nb[j].node,
+		REQ_DD_MIGRATE, MPI_COMM_WORLD, &req[n_req++]);
+    if (nb[j].send_cnt[1] > 0)
+      MPI_Isend(nb[j].send_dyn.e, nb[j].send_cnt[1]*sizeof(int), MPI_BYTE, nb[j].node,
+		REQ_DD_MIGRATE, MPI_COMM_WORLD, &req[n_req++]);
+  }
+  MPI_Waitall(n_req, req, stat);
+
+  for (j = 0; j < n_nb; j++) {
+    /* the sent particles are gone */
+    for (pc = 0; pc < nb[j].send.n; pc++) {
+      local_particles[nb[j].send.part[pc].p.identity] = NULL;
+      free_particle(&nb[j].send.part[pc]);
+    }
+    realloc_particlelist(&nb[j].send, 0);
+    realloc_intlist(&nb[j].send_dyn, 0);
+
+    if (!dd_unpack_migration(&nb[j]))
+      ok = 0;
+    realloc_particlelist(&nb[j].recv, 0);
+    realloc_intlist(&nb[j].recv_dyn, 0);
+  }
+
+  return ok;
+}
+
+/************************************************************/
+
 void  dd_exchange_and_sort_particles(int global_flag)
 {
   int dir, c, p, i, finished=0;
@@ -725,6 +1116,17 @@ void  dd_exchange_and_sort_particles(int global_flag)
   init_particlelist(&send_buf_r);
   init_particlelist(&recv_buf_l);
   init_particlelist(&recv_buf_r);
+
+  /* exchanges with the neighbors only are the common case during the
+     integration, and can be done in a single pass */
+  if (global_flag == CELL_NEIGHBOR_EXCHANGE) {
+    if (!dd_migrate_particles_single_pass()) {
+      char *errtext = runtime_error(128);
+      ERROR_SPRINTF(errtext,"{004 some particles moved more than min_local_box_l, reduce the time step} ");
+    }
+    finished = 1;
+  }
+
   while(finished == 0 ) {
     finished=1;
     /* direction loop: x, y, z */  
@@ -880,6 +1282,13 @@ void  dd_exchange_and_sort_particles(int global_flag)
   realloc_particlelist(&recv_buf_l, 0);
   realloc_particlelist(&recv_buf_r, 0);
 
+  /* every now and then, restore the memory locality of the particles
+     which the exchange above slowly destroys */
+  if (dd_sort_interval > 0 && ++dd_resorts_since_sort >= dd_sort_interval) {
+    dd_sort_cells_along_curve();
+    dd_resorts_since_sort = 0;
+  }
+
 #ifdef ADDITIONAL_CHECKS
   check_particle_consistency();
 #endif
@@ -931,6 +1340,18 @@ int min_num_cells_callback(Tcl_Interp *interp, void *_data)
   return (TCL_OK);
 }
 
+int sort_interval_callback(Tcl_Interp *interp, void *_data)
+{
+  int data = *(int *)_data;
+  if (data < 0) {
+    Tcl_AppendResult(interp, "sort_interval must be non-negative", (char *) NULL);
+    return (TCL_ERROR);
+  }
+  dd_sort_interval = data;
+  mpi_bcast_parameter(FIELD_SORTINTERVAL);
+  return (TCL_OK);
+}
+
 void calc_link_cell()
 {
   int c, np1, n, np2, i ,j, j_start;
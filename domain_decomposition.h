@@ -134,6 +134,13 @@ extern int max_num_cells;
 */
 extern int min_num_cells;
 
+/** Number of particle exchanges after which the particles within
+    each cell are reordered along a space filling curve to improve
+    memory locality. Zero disables the reordering. The corresponding
+    callback function is \ref sort_interval_callback.
+*/
+extern int dd_sort_interval;
+
 /*@}*/
 
 /************************************************************/
@@ -188,6 +195,10 @@ int max_num_cells_callback(Tcl_Interp *interp, void *_data);
     see also \ref min_num_cells */
 int min_num_cells_callback(Tcl_Interp *interp, void *_data);
 
+/** Callback for setmd sort_interval.
+    see also \ref dd_sort_interval */
+int sort_interval_callback(Tcl_Interp *interp, void *_data);
+
 /** calculate physical (processor) minimal number of cells */
 int calc_processor_min_num_cells();
 
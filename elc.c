@@ -70,13 +70,25 @@ ELC_struct elc_params = { 1e100, 10, 1, 0, 1, 1, 1, 1, 0, 0, 0, 0 };
 #define PQECCM 7
 /*@}*/
 
+/** number of (p,q) modes whose sums are collected by a single reduction */
+#define ELC_MODE_BLOCK 16
+
 /** number of local particles, equals the size of \ref elc::partblk. */
 static int n_localpart = 0;
 
-/** temporary buffers for product decomposition */
+/** temporary buffers for product decomposition, for all modes of a block */
+static double *partblk_buf = NULL;
+/** collected data from the other cells, 8 values for all modes of a block */
+static double gblcblk_buf[8*ELC_MODE_BLOCK];
+/** temporary buffer for product decomposition of the current mode */
 static double *partblk = NULL;
-/** collected data from the other cells */
-static double gblcblk[8];
+/** collected data from the other cells of the current mode */
+static double *gblcblk = gblcblk_buf;
+
+/** the (p,q) modes of the far formula, in the order in which they are
+    calculated. Modes with q=0 rsp. p=0 are handled by the P rsp. Q code. */
+static int *far_modes = NULL;
+static int far_modes_size = 0;
 
 /** structure for storing of sin and cos values */
 typedef struct {
@@ -103,6 +115,9 @@ static void prepare_scy_cache();
 /** \name common code */
 /*@{*/
 static void distribute(int size);
+static void distribute_block(int n_modes);
+static int collect_far_modes();
+static void select_block_slot(int slot);
 /*@}*/
 /** \name p=0 per frequency code */
 /*@{*/
@@ -144,22 +159,27 @@ void ELC_setup_constants()
 static void prepare_scx_cache()
 {
   int np, c, i, ic, freq, o;
-  double pref, arg;
+  double pref, arg, s1, c1;
   Particle *part;
   
-  for (freq = 1; freq <= n_scxcache; freq++) {
-    pref = C_2PI*ux*freq;
-    o = (freq-1)*n_localpart;
-    ic = 0;
-    for (c = 0; c < local_cells.n; c++) {
-      np   = local_cells.cell[c]->n;
-      part = local_cells.cell[c]->part;
-      for (i = 0; i < np; i++) {
-	arg = pref*part[i].r.p[0];
-	scxcache[o + ic].s = sin(arg);
-	scxcache[o + ic].c = cos(arg);
-	ic++;
+  pref = C_2PI*ux;
+  ic = 0;
+  for (c = 0; c < local_cells.n; c++) {
+    np   = local_cells.cell[c]->n;
+    part = local_cells.cell[c]->part;
+    for (i = 0; i < np; i++) {
+      arg = pref*part[i].r.p[0];
+      s1 = sin(arg);
+      c1 = cos(arg);
+      scxcache[ic].s = s1;
+      scxcache[ic].c = c1;
+      /* the higher frequencies from the addition theorems */
+      for (freq = 2; freq <= n_scxcache; freq++) {
+	o = (freq-1)*n_localpart + ic;
+	scxcache[o].s = scxcache[o - n_localpart].s*c1 + scxcache[o - n_localpart].c*s1;
+	scxcache[o].c = scxcache[o - n_localpart].c*c1 - scxcache[o - n_localpart].s*s1;
       }
+      ic++;
     }
   }
 }
@@ -167,22 +187,27 @@ static void prepare_scx_cache()
 static void prepare_scy_cache()
 {
   int np, c, i, ic, freq, o;
-  double pref, arg;
+  double pref, arg, s1, c1;
   Particle *part;
   
-  for (freq = 1; freq <= n_scycache; freq++) {
-    pref = C_2PI*uy*freq;
-    o = (freq-1)*n_localpart;
-    ic = 0;
-    for (c = 0; c < local_cells.n; c++) {
-      np   = local_cells.cell[c]->n;
-      part = local_cells.cell[c]->part;
-      for (i = 0; i < np; i++) {
-	arg = pref*part[i].r.p[1];
-	scycache[o + ic].s = sin(arg);
-	scycache[o + ic].c = cos(arg);
-	ic++;
+  pref = C_2PI*uy;
+  ic = 0;
+  for (c = 0; c < local_cells.n; c++) {
+    np   = local_cells.cell[c]->n;
+    part = local_cells.cell[c]->part;
+    for (i = 0; i < np; i++) {
+      arg = pref*part[i].r.p[1];
+      s1 = sin(arg);
+      c1 = cos(arg);
+      scycache[ic].s = s1;
+      scycache[ic].c = c1;
+      /* the higher frequencies from the addition theorems */
+      for (freq = 2; freq <= n_scycache; freq++) {
+	o = (freq-1)*n_localpart + ic;
+	scycache[o].s = scycache[o - n_localpart].s*c1 + scycache[o - n_localpart].c*s1;
+	scycache[o].c = scycache[o - n_localpart].c*c1 - scycache[o - n_localpart].s*s1;
       }
+      ic++;
     }
   }
 }
@@ -238,6 +263,70 @@ void distribute(int size)
   MPI_Allreduce(send_buf, gblcblk, size, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 }
 
+/** sum up the data of the first n_modes slots of a block at once */
+void distribute_block(int n_modes)
+{
+  double send_buf[8*ELC_MODE_BLOCK];
+  copy_vec(send_buf, gblcblk_buf, 8*n_modes);
+  MPI_Allreduce(send_buf, gblcblk_buf, 8*n_modes, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+}
+
+/** let partblk and gblcblk point to the data of a slot of the block */
+void select_block_slot(int slot)
+{
+  partblk = partblk_buf + 8*slot*n_localpart;
+  gblcblk = gblcblk_buf + 8*slot;
+}
+
+/** add a (p,q) mode to \ref far_modes */
+MDINLINE void add_far_mode(int *n, int p, int q)
+{
+  if (*n >= far_modes_size) {
+    far_modes_size += 64;
+    far_modes = realloc(far_modes, 2*far_modes_size*sizeof(int));
+  }
+  far_modes[2*(*n)    ] = p;
+  far_modes[2*(*n) + 1] = q;
+  (*n)++;
+}
+
+/** fill \ref far_modes and return the number of modes */
+int collect_far_modes()
+{
+  int p, q, n = 0;
+
+  /* the second condition is just for the case of numerical accident */
+  for (p = 1; ux*(p - 1) < elc_params.far_cut && p <= n_scxcache; p++)
+    add_far_mode(&n, p, 0);
+  for (q = 1; uy*(q - 1) < elc_params.far_cut && q <= n_scycache; q++)
+    add_far_mode(&n, 0, q);
+  for (p = 1; ux*(p - 1) < elc_params.far_cut  && p <= n_scxcache ; p++)
+    for (q = 1; SQR(ux*(p - 1)) + SQR(uy*(q - 1)) < elc_params.far_cut2 && q <= n_scycache; q++)
+      add_far_mode(&n, p, q);
+  return n;
+}
+
+/** frequency of a (p,q) mode */
+MDINLINE double far_mode_omega(int p, int q)
+{
+  return C_2PI*sqrt(SQR(ux*p) + SQR(uy*q));
+}
+
+/** set up the sums of the m-th far mode in a slot of the block */
+static void setup_far_mode(int m, int slot)
+{
+  int p = far_modes[2*m], q = far_modes[2*m + 1];
+
+  select_block_slot(slot);
+  clear_vec(gblcblk, 8);
+  if (q == 0)
+    setup_P(p, C_2PI*ux*p);
+  else if (p == 0)
+    setup_Q(q, C_2PI*uy*q);
+  else
+    setup_PQ(p, q, far_mode_omega(p, q));
+}
+
 #ifdef CHECKPOINTS
 static void checkpoint(char *text, int p, int q, int e_size)
 {
@@ -1078,8 +1167,7 @@ static double PQ_energy(double omega)
 
 void ELC_add_force()
 {
-  int p, q;
-  double omega;
+  int p, q, m, start, n_modes, n_block;
 
   prepare_scx_cache();
   prepare_scy_cache();
@@ -1094,32 +1182,32 @@ void ELC_add_force()
 
   clear_log_forces("z_force");
 
-  /* the second condition is just for the case of numerical accident */
-  for (p = 1; ux*(p - 1) < elc_params.far_cut && p <= n_scxcache; p++) {
-    omega = C_2PI*ux*p;
-    setup_P(p, omega);
-    distribute(4);
-    add_P_force(); 
-    checkpoint("************distri p", p, 0, 2);
-  }
-
-  for (q = 1; uy*(q - 1) < elc_params.far_cut && q <= n_scycache; q++) {
-    omega = C_2PI*uy*q;
-    setup_Q(q, omega);
-    distribute(4); 
-    add_Q_force();
-    checkpoint("************distri q", 0, q, 2);
-  }
-
-  for (p = 1; ux*(p - 1) < elc_params.far_cut  && p <= n_scxcache ; p++) {
-    for (q = 1; SQR(ux*(p - 1)) + SQR(uy*(q - 1)) < elc_params.far_cut2 && q <= n_scycache; q++) {
-      omega = C_2PI*sqrt(SQR(ux*p) + SQR(uy*q));
-      setup_PQ(p, q, omega);
-      distribute(8);
-      add_PQ_force(p, q, omega); 
-      checkpoint("************distri pq", p, q, 4);
+  /* the modes are set up in blocks, whose sums are collected at once */
+  n_modes = collect_far_modes();
+  for (start = 0; start < n_modes; start += ELC_MODE_BLOCK) {
+    n_block = (n_modes - start < ELC_MODE_BLOCK) ? n_modes - start : ELC_MODE_BLOCK;
+    for (m = 0; m < n_block; m++)
+      setup_far_mode(start + m, m);
+    distribute_block(n_block);
+    for (m = 0; m < n_block; m++) {
+      p = far_modes[2*(start + m)];
+      q = far_modes[2*(start + m) + 1];
+      select_block_slot(m);
+      if (q == 0) {
+	add_P_force(); 
+	checkpoint("************distri p", p, 0, 2);
+      }
+      else if (p == 0) {
+	add_Q_force();
+	checkpoint("************distri q", 0, q, 2);
+      }
+      else {
+	add_PQ_force(p, q, far_mode_omega(p, q)); 
+	checkpoint("************distri pq", p, q, 4);
+      }
     }
   }
+  select_block_slot(0);
 
   clear_log_forces("end");
 }
@@ -1127,38 +1215,38 @@ void ELC_add_force()
 double ELC_energy()
 {
   double eng;
-  int p, q;
-  double omega;
+  int p, q, m, start, n_modes, n_block;
 
   eng = 2*dipole_energy(); 
   eng+=z_energy();
   prepare_scx_cache();
   prepare_scy_cache();
 
-  /* the second condition is just for the case of numerical accident */
-  for (p = 1; ux*(p - 1) < elc_params.far_cut && p <= n_scxcache; p++) {
-    omega = C_2PI*ux*p;
-    setup_P(p, omega);
-    distribute(4);
-    eng += P_energy(omega);
-    checkpoint("E************distri p", p, 0, 2);
-  }
-  for (q = 1; uy*(q - 1) < elc_params.far_cut && q <= n_scycache; q++) {
-    omega = C_2PI*uy*q;
-    setup_Q(q, omega);
-    distribute(4);
-    eng += Q_energy(omega);
-    checkpoint("E************distri q", 0, q, 2);
-  }
-  for (p = 1; ux*(p - 1) < elc_params.far_cut  && p <= n_scxcache ; p++) {
-    for (q = 1; SQR(ux*(p - 1)) + SQR(uy*(q - 1)) < elc_params.far_cut2 && q <= n_scycache; q++) {
-      omega = C_2PI*sqrt(SQR(ux*p) + SQR(uy*q));
-      setup_PQ(p, q, omega);
-      distribute(8);
-      eng += PQ_energy(omega);
-      checkpoint("E************distri pq", p, q, 4);
+  n_modes = collect_far_modes();
+  for (start = 0; start < n_modes; start += ELC_MODE_BLOCK) {
+    n_block = (n_modes - start < ELC_MODE_BLOCK) ? n_modes - start : ELC_MODE_BLOCK;
+    for (m = 0; m < n_block; m++)
+      setup_far_mode(start + m, m);
+    distribute_block(n_block);
+    for (m = 0; m < n_block; m++) {
+      p = far_modes[2*(start + m)];
+      q = far_modes[2*(start + m) + 1];
+      select_block_slot(m);
+      if (q == 0) {
+	eng += P_energy(C_2PI*ux*p);
+	checkpoint("E************distri p", p, 0, 2);
+      }
+      else if (p == 0) {
+	eng += Q_energy(C_2PI*uy*q);
+	checkpoint("E************distri q", 0, q, 2);
+      }
+      else {
+	eng += PQ_energy(far_mode_omega(p, q));
+	checkpoint("E************distri pq", p, q, 4);
+      }
     }
   }
+  select_block_slot(0);
   /* we count both i<->j and j<->i, so return just half of it */
   return 0.5*eng;
 }
@@ -1347,7 +1435,8 @@ void ELC_on_resort_particles()
   scxcache = realloc(scxcache, n_scxcache*n_localpart*sizeof(SCCache));
   scycache = realloc(scycache, n_scycache*n_localpart*sizeof(SCCache));
     
-  partblk   = realloc(partblk,  n_localpart*8*sizeof(double));
+  partblk_buf = realloc(partblk_buf, ELC_MODE_BLOCK*n_localpart*8*sizeof(double));
+  select_block_slot(0);
 }
 
 void ELC_on_coulomb_change()
@@ -82,13 +82,13 @@ void calc_long_range_energies()
   switch (coulomb.method) {
 #ifdef ELP3M
   case COULOMB_P3M:
-    P3M_charge_assign(); 
+    P3M_charge_assign_cached(); 
     energy.coulomb[1] = P3M_calc_kspace_forces_for_charges(0,1);
     break;
   case COULOMB_ELC_P3M:
     // assign the original charges first
     // they may not have been assigned yet
-    P3M_charge_assign(); 
+    P3M_charge_assign_cached(); 
     if(!elc_params.dielectric_contrast_on)
       energy.coulomb[1] = P3M_calc_kspace_forces_for_charges(0,1);
     else {
@@ -118,6 +118,10 @@ void calc_long_range_energies()
     *energy.coulomb += MMM2D_far_energy();
     *energy.coulomb += MMM2D_dielectric_layers_energy_contribution();
     break;
+  case COULOMB_MMM1D:
+    if (mmm1d_params.tree_theta > 0)
+      *energy.coulomb += MMM1D_tree_energy();
+    break;
     /* calculate electric part of energy (only for MAGGS) */
   case COULOMB_MAGGS:
     *energy.coulomb += maggs_electric_energy();
@@ -156,6 +160,11 @@ void calc_long_range_energies()
      energy.dipolar[1] = magnetic_dipolar_direct_sum_calculations(0,1);
     break;
   #endif
+ #ifdef DIPOLAR_BARNES_HUT
+  case DIPOLAR_BH:
+     energy.dipolar[1] = dipolar_bh_calculations(0,1);
+    break;
+  #endif
   
   } 
 #endif /* ifdef MAGNETOSTATICS */
@@ -199,6 +208,9 @@ void init_energies(Observable_stat *stat)
 #ifdef MAGNETIC_DIPOLAR_DIRECT_SUM
  case DIPOLAR_MDLC_DS: n_dipolar=3; break;
  case DIPOLAR_DS:   n_dipolar = 2; break;
+#endif
+#ifdef DIPOLAR_BARNES_HUT
+  case DIPOLAR_BH:   n_dipolar = 2; break;
 #endif
   }
 
@@ -216,6 +228,104 @@ void master_energy_calc() {
   total_energy.init_status=1;
 }
 
+/************************************************************/
+
+#ifdef ELECTROSTATICS
+
+/** real space energy of two charges for the methods supported by
+    \ref coulomb_energy_change. */
+MDINLINE double coulomb_pair_energy_q(double chgfac, double *d, double dist2, double dist)
+{
+  switch (coulomb.method) {
+#ifdef ELP3M
+  case COULOMB_P3M:
+    return p3m_coulomb_pair_energy(chgfac, d, dist2, dist);
+#endif
+  case COULOMB_EWALD:
+    return ewald_coulomb_pair_energy(chgfac, d, dist2, dist);
+  }
+  return 0.0;
+}
+
+/** energy of charge \a q at \a pos with charge \a pq at \a ppos. */
+MDINLINE double coulomb_change_pair_energy(double q, double *pos, double pq, double *ppos)
+{
+  double d[3], dist2;
+
+  if (q == 0.0)
+    return 0.0;
+  get_mi_vector(d, pos, ppos);
+  dist2 = sqrlen(d);
+  return coulomb_pair_energy_q(q*pq, d, dist2, sqrt(dist2));
+}
+
+/** real space part of \ref coulomb_energy_change on this node, that is
+    the interactions of the changed charges with the local charges that
+    are not changed themselves, and on the master node the interactions
+    of the changed charges among each other. */
+static double coulomb_real_space_change(int n, ChargeChange *c)
+{
+  Cell *cell;
+  Particle *p;
+  int i, j, k, cc, np;
+  double energy = 0.0;
+
+  for (cc = 0; cc < local_cells.n; cc++) {
+    cell = local_cells.cell[cc];
+    p  = cell->part;
+    np = cell->n;
+    for (i = 0; i < np; i++) {
+      if (p[i].p.q == 0.0)
+	continue;
+      for (j = 0; j < n; j++)
+	if (c[j].identity == p[i].p.identity)
+	  break;
+      if (j < n)
+	continue;
+      for (j = 0; j < n; j++)
+	energy += coulomb_change_pair_energy(c[j].new_q, c[j].new_pos, p[i].p.q, p[i].r.p)
+	  - coulomb_change_pair_energy(c[j].old_q, c[j].old_pos, p[i].p.q, p[i].r.p);
+    }
+  }
+
+  if (this_node == 0)
+    for (j = 0; j < n; j++)
+      for (k = j + 1; k < n; k++)
+	energy += coulomb_change_pair_energy(c[j].new_q, c[j].new_pos, c[k].new_q, c[k].new_pos)
+	  - coulomb_change_pair_energy(c[j].old_q, c[j].old_pos, c[k].old_q, c[k].old_pos);
+
+  return energy;
+}
+
+double coulomb_energy_change(int n, ChargeChange *c)
+{
+  double node_energy, energy = 0.0;
+
+  if (!check_obs_calc_initialized())
+    return 0.0;
+
+  on_observable_calc();
+
+  node_energy = coulomb_real_space_change(n, c);
+
+  switch (coulomb.method) {
+#ifdef ELP3M
+  case COULOMB_P3M:
+    node_energy += P3M_energy_change(n, c);
+    break;
+#endif
+  case COULOMB_EWALD:
+    node_energy += EWALD_energy_change(n, c);
+    break;
+  }
+
+  MPI_Reduce(&node_energy, &energy, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  return energy;
+}
+
+#endif
+
 /****************************************************************************************
  *                                 parser
  ****************************************************************************************/
@@ -415,3 +525,139 @@ int parse_and_print_energy(Tcl_Interp *interp, int argc, char **argv)
 
   return (TCL_OK);
 }
+
+/************************************************************/
+
+#ifdef ELECTROSTATICS
+/** find the change of particle \a id in \a c, or append a new one
+    filled with the current position and charge of the particle. */
+static ChargeChange *get_charge_change(Tcl_Interp *interp, int id, int *n, ChargeChange **c)
+{
+  Particle part;
+  int j;
+
+  for (j = 0; j < *n; j++)
+    if ((*c)[j].identity == id)
+      return *c + j;
+
+  if (get_particle_data(id, &part) == TCL_ERROR) {
+    char buffer[TCL_INTEGER_SPACE];
+    sprintf(buffer, "%d", id);
+    Tcl_AppendResult(interp, "particle ", buffer, " does not exist", (char *)NULL);
+    return NULL;
+  }
+  *c = realloc(*c, (*n + 1)*sizeof(ChargeChange));
+  (*c)[*n].identity = id;
+  for (j = 0; j < 3; j++)
+    (*c)[*n].old_pos[j] = (*c)[*n].new_pos[j] = part.r.p[j];
+  (*c)[*n].old_q = (*c)[*n].new_q = part.p.q;
+  free_particle(&part);
+
+  return *c + (*n)++;
+}
+#endif
+
+int parse_coulomb_energy_change(Tcl_Interp *interp, int argc, char **argv)
+{
+  /* 'analyze coulomb_change { move <id> <x> <y> <z> | charge <id> <q> | insert <x> <y> <z> <q> | delete <id> } ...' */
+#ifdef ELECTROSTATICS
+  char buffer[TCL_DOUBLE_SPACE];
+  ChargeChange *c = NULL, *cc;
+  int n = 0, id, j;
+  double value;
+
+  if (coulomb.method != COULOMB_EWALD
+#ifdef ELP3M
+      && coulomb.method != COULOMB_P3M
+#endif
+      ) {
+    Tcl_AppendResult(interp, "analyze coulomb_change is only implemented for P3M and Ewald",
+		     (char *)NULL);
+    return (TCL_ERROR);
+  }
+
+  while (argc > 0) {
+    if (ARG0_IS_S("move")) {
+      if (argc < 5 || !ARG_IS_I(1, id)) {
+	Tcl_AppendResult(interp, "usage: move <id> <x> <y> <z>", (char *)NULL);
+	free(c);
+	return (TCL_ERROR);
+      }
+      if (!(cc = get_charge_change(interp, id, &n, &c))) {
+	free(c);
+	return (TCL_ERROR);
+      }
+      for (j = 0; j < 3; j++)
+	if (!ARG_IS_D(2 + j, cc->new_pos[j])) {
+	  free(c);
+	  return (TCL_ERROR);
+	}
+      argc -= 5; argv += 5;
+    }
+    else if (ARG0_IS_S("charge")) {
+      if (argc < 3 || !ARG_IS_I(1, id)) {
+	Tcl_AppendResult(interp, "usage: charge <id> <q>", (char *)NULL);
+	free(c);
+	return (TCL_ERROR);
+      }
+      if (!(cc = get_charge_change(interp, id, &n, &c)) || !ARG_IS_D(2, cc->new_q)) {
+	free(c);
+	return (TCL_ERROR);
+      }
+      argc -= 3; argv += 3;
+    }
+    else if (ARG0_IS_S("delete")) {
+      if (argc < 2 || !ARG_IS_I(1, id)) {
+	Tcl_AppendResult(interp, "usage: delete <id>", (char *)NULL);
+	free(c);
+	return (TCL_ERROR);
+      }
+      if (!(cc = get_charge_change(interp, id, &n, &c))) {
+	free(c);
+	return (TCL_ERROR);
+      }
+      cc->new_q = 0.0;
+      argc -= 2; argv += 2;
+    }
+    else if (ARG0_IS_S("insert")) {
+      if (argc < 5) {
+	Tcl_AppendResult(interp, "usage: insert <x> <y> <z> <q>", (char *)NULL);
+	free(c);
+	return (TCL_ERROR);
+      }
+      c = realloc(c, (n + 1)*sizeof(ChargeChange));
+      cc = c + n++;
+      cc->identity = -1;
+      cc->old_q = 0.0;
+      for (j = 0; j < 3; j++) {
+	cc->old_pos[j] = 0.0;
+	if (!ARG_IS_D(1 + j, cc->new_pos[j])) {
+	  free(c);
+	  return (TCL_ERROR);
+	}
+      }
+      if (!ARG_IS_D(4, cc->new_q)) {
+	free(c);
+	return (TCL_ERROR);
+      }
+      argc -= 5; argv += 5;
+    }
+    else {
+      Tcl_AppendResult(interp, "unknown change ", argv[0],
+		       ", expected move, charge, insert or delete", (char *)NULL);
+      free(c);
+      return (TCL_ERROR);
+    }
+  }
+
+  value = (n > 0) ? mpi_coulomb_energy_change(n, c) : 0.0;
+  free(c);
+
+  Tcl_PrintDouble(interp, value, buffer);
+  Tcl_AppendResult(interp, buffer, (char *)NULL);
+  return mpi_gather_runtime_errors(interp, TCL_OK);
+#else
+  Tcl_AppendResult(interp, "ELECTROSTATICS not compiled (see config.h)", (char *)NULL);
+  return (TCL_ERROR);
+#endif
+}
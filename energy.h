@@ -193,7 +193,7 @@ MDINLINE void add_non_bonded_pair_energy(Particle *p1, Particle *p2, double d[3]
     break;
 #endif
     case COULOMB_EWALD:
-      ret = ewald_coulomb_pair_energy(p1,p2,d,dist2,dist);
+      ret = ewald_coulomb_pair_energy(p1->p.q*p2->p.q,d,dist2,dist);
       break;
     case COULOMB_DH:
       ret = dh_coulomb_pair_energy(p1,p2,dist);
@@ -436,6 +436,20 @@ MDINLINE void add_kinetic_energy(Particle *p1)
 /** implementation of analyze energy */
 int parse_and_print_energy(Tcl_Interp *interp, int argc, char **argv);
 
+#ifdef ELECTROSTATICS
+/** Change of the electrostatic energy if the charges are changed as
+    given, from the real space interactions of the changed charges and
+    the cached k-space data of P3M or Ewald. Has to be called on all
+    nodes, the result is only valid on the master node, see \ref
+    mpi_coulomb_energy_change.
+    @param n number of changes
+    @param c the changes */
+double coulomb_energy_change(int n, ChargeChange *c);
+#endif
+
+/** implementation of analyze coulomb_change */
+int parse_coulomb_energy_change(Tcl_Interp *interp, int argc, char **argv);
+
 /*@}*/
 
 #endif
@@ -29,6 +29,11 @@
 #include "thermostat.h"
 #include "cells.h"
 #include "mmm-common.h"
+#include "tuning.h"
+
+#ifdef EWALD_PME
+#include <fftw3.h>
+#endif
 
 #ifdef ELECTROSTATICS
 
@@ -47,13 +52,13 @@
  * variables
  ************************************************/
 
-ewald_struct ewald = { 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0 };
+ewald_struct ewald = { 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0, EWALD_METHOD_DIRECT };
 
-/** number of charged particles (only on master node). */
+/** number of charged particles. */
 int ewald_sum_qpart=0;
-/** Sum of square of charges (only on master node). */
+/** Sum of square of charges. */
 double ewald_sum_q2 = 0.0;
-/** square of sum of charges (only on master node). */
+/** square of sum of charges. */
 double ewald_square_sum_q = 0.0;
 /** ewald cache arrays */
 /*@{*/
@@ -67,21 +72,36 @@ static int total_kvectors = 0;
 /*@{*/
 static double ux, ux2, uy, uy2, uz;
 /*@}*/
-/** number of local particles, equals the size of \ref elc::partblk. */
-static int n_localpart = 0;
+
+/** a charged particle as seen by the k-space kernels. */
+typedef struct {
+  double r[3];
+  double q;
+} EwaldCharge;
+
+/** \name local charged particles, gathered for the k-space kernels */
+/*@{*/
+static EwaldCharge *lq = NULL;
+/** k-space forces on \ref lq, without the coulomb prefactor. */
+static double *lf = NULL;
+/** number of charges in \ref lq. */
+static int n_lq = 0;
+/** number of charges the caches are allocated for. */
+static int max_lq = 0;
+/*@}*/
 
 /** structure for storing of sin and cos values */
 typedef struct {
   double s, c;
 } SCCache;
 
-/** sin/cos caching */ 
+/** sin/cos caching, stored as [k*max_lq + charge] */ 
 /*@{*/
-static SCCache **scx = NULL;
+static SCCache *scx = NULL;
 static int    n_scx;  
-static SCCache **scy = NULL;
+static SCCache *scy = NULL;
 static int    n_scy;  
-static SCCache **scz = NULL;
+static SCCache *scz = NULL;
 static int    n_scz;  
 static int    scxoff;
 static int    scyoff;
@@ -90,21 +110,78 @@ static int    sczoff;
 
 /** \name ewald sum buffers */
 /*@{*/
-  double* sums=NULL;
-  double* sumc=NULL;
-  double* totsums=NULL;
-  double* totsumc=NULL;
+static double* sums=NULL;
+static double* sumc=NULL;
+static double* totsums=NULL;
+static double* totsumc=NULL;
+/** whether \ref totsums and \ref totsumc hold the structure factors
+    of the current particle configuration. */
+static int sf_valid = 0;
+/** whether the cached structure factors are the ones of the particle
+    mesh, see \ref EWALD_pme_structure_factors. */
+static int sf_mesh = 0;
+/*@}*/
+
+#ifdef EWALD_PME
+/** \name smooth particle mesh path */
+/*@{*/
+/** charge assignment order of the B-splines */
+#define PME_CAO 7
+/** number of charges used to time the two k-space paths in \ref EWALD_init */
+#define PME_TIMING_CHARGES 128
+/** number of timing repetitions, the fastest one is taken */
+#define PME_TIMING_ROUNDS 5
+/** largest mesh per direction, beyond it the direct sum is used */
+#define PME_MAX_MESH 128
+
+/** mesh points per direction, 0 if the mesh is not set up. */
+static int pme_mesh = 0;
+/** local charge mesh, [z][y][x]. */
+static double *pme_rs = NULL;
+/** summed charge mesh, and the potential mesh after the back transformation. */
+static double *pme_rs_tot = NULL;
+/** Fourier transformed mesh, [z][y][0..mesh/2]. */
+static fftw_complex *pme_ks = NULL;
+/** \ref kvec times the B-spline moduli on the k-space mesh, 0 outside the k-sphere. */
+static double *pme_influence = NULL;
+/** squared B-spline moduli \f$|b(m)|^2\f$ for \f$m=0,\ldots,\f$ mesh-1. */
+static double *pme_bmod = NULL;
+static fftw_plan pme_fwd, pme_bwd;
+/** number of charges per node above which the mesh path is used in automatic mode. */
+static double pme_crossover = 0.0;
 /*@}*/
+#endif
 
 /** \name Private Functions */
 /************************************************************/
 /*@{*/
 /** Calculates the kvectors once at the beginning*/
 int EWALD_prepare_kfield();
+/** make room for n charges in the particle and sin/cos caches. */
+static void EWALD_realloc_charges(int n);
+/** calculate the structure factors of the given charges into
+    \ref totsums and \ref totsumc, and the sin/cos caches. */
+static void EWALD_structure_factors(EwaldCharge *c, int n);
+/** evaluate the k-space sum directly from the structure factors.
+    Adds the forces (without prefactor) to f, if f is not NULL, and
+    returns the energy (without prefactor) if energy_flag is set. */
+static double EWALD_direct_kspace(EwaldCharge *c, int n, double *f, int energy_flag);
+#ifdef EWALD_PME
+/** set up mesh, plans and influence function for the particle mesh path. */
+static void EWALD_pme_init();
+/** same as \ref EWALD_direct_kspace, but via the smooth particle mesh. */
+static double EWALD_pme_kspace(EwaldCharge *c, int n, double *f, int energy_flag);
+/** time both paths and set \ref pme_crossover. */
+static void EWALD_measure_crossover();
+/** the structure factors as seen by the particle mesh, i.e. the
+    transformed B-spline charge mesh times the B-spline moduli, into
+    \ref totsums and \ref totsumc. */
+static void EWALD_pme_structure_factors(EwaldCharge *c, int n);
+#endif
+/** whether the k-space sum is currently evaluated on the mesh. */
+static int EWALD_use_mesh();
 /*@}*/
 
-
-
 int EWALD_prepare_kfield() {
   int kymin,kzmin,ksq,kx,ky,kz,totk;
   double rkx,rky,rkz,rksq;
@@ -186,11 +263,16 @@ int printEWALDToResult(Tcl_Interp *interp)
   Tcl_AppendResult(interp, buffer, " ", (char *) NULL);
   Tcl_PrintDouble(interp, b, buffer);
   Tcl_AppendResult(interp, buffer, (char *) NULL);
+  switch (ewald.method) {
+  case EWALD_METHOD_PME:  Tcl_AppendResult(interp, " pme", (char *) NULL); break;
+  case EWALD_METHOD_AUTO: Tcl_AppendResult(interp, " auto", (char *) NULL); break;
+  default: break;
+  }
 
   return TCL_OK;
 }
 
-int ewald_set_params(double r_cut, double alpha, int kmax)
+int ewald_set_params(double r_cut, double alpha, int kmax, int method)
 {
   if(r_cut < 0)
     return -1;
@@ -212,6 +294,12 @@ int ewald_set_params(double r_cut, double alpha, int kmax)
   }
   else return -5;
 
+#ifndef EWALD_PME
+  if (method == EWALD_METHOD_PME)
+    return -6;
+#endif
+  ewald.method = method;
+
   mpi_bcast_coulomb_params();
 
   return 0;
@@ -230,7 +318,7 @@ int ewald_set_eps(double eps)
 int inter_parse_ewald(Tcl_Interp * interp, int argc, char ** argv)
 {
   double r_cut, alpha;
-  int i, kmax;
+  int i, kmax, method = EWALD_METHOD_DIRECT;
 
   coulomb.method = COULOMB_EWALD;
     
@@ -246,7 +334,7 @@ int inter_parse_ewald(Tcl_Interp * interp, int argc, char ** argv)
 #endif
 
   if (argc < 2) {
-    Tcl_AppendResult(interp, "expected: inter coulomb <bjerrum> ewald <r_cut> <alpha> <kmax>",
+    Tcl_AppendResult(interp, "expected: inter coulomb <bjerrum> ewald <r_cut> <alpha> <kmax> [direct|pme|auto]",
 		     (char *) NULL);
     return TCL_ERROR;  
   }
@@ -254,8 +342,21 @@ int inter_parse_ewald(Tcl_Interp * interp, int argc, char ** argv)
   if(! ARG0_IS_D(r_cut))
     return TCL_ERROR;  
 
-  if(argc != 3) {
-    Tcl_AppendResult(interp, "wrong # arguments: inter coulomb <bjerrum> ewald <r_cut> <alpha> <kmax>",
+  if(argc == 4) {
+    if (ARG_IS_S(3, "direct"))
+      method = EWALD_METHOD_DIRECT;
+    else if (ARG_IS_S(3, "pme"))
+      method = EWALD_METHOD_PME;
+    else if (ARG_IS_S(3, "auto"))
+      method = EWALD_METHOD_AUTO;
+    else {
+      Tcl_AppendResult(interp, "unknown ewald method \"", argv[3], "\", expected direct, pme or auto",
+		       (char *) NULL);
+      return TCL_ERROR;
+    }
+  }
+  else if(argc != 3) {
+    Tcl_AppendResult(interp, "wrong # arguments: inter coulomb <bjerrum> ewald <r_cut> <alpha> <kmax> [direct|pme|auto]",
 		     (char *) NULL);
     return TCL_ERROR;  
   }
@@ -266,7 +367,7 @@ int inter_parse_ewald(Tcl_Interp * interp, int argc, char ** argv)
   if(! ARG_IS_I(2, kmax))
     return TCL_ERROR;
 
-  if ((i = ewald_set_params(r_cut, alpha, kmax)) < 0) {
+  if ((i = ewald_set_params(r_cut, alpha, kmax, method)) < 0) {
     switch (i) {
     case -1:
       Tcl_AppendResult(interp, "r_cut must be positive", (char *) NULL);
@@ -276,6 +377,10 @@ int inter_parse_ewald(Tcl_Interp * interp, int argc, char ** argv)
       break;
     case -5:
       Tcl_AppendResult(interp, "kmax must be greater than zero", (char *) NULL);
+      break;
+    case -6:
+      Tcl_AppendResult(interp, "the particle mesh Ewald sum requires FFTW3", (char *) NULL);
+      break;
     default:;
       Tcl_AppendResult(interp, "unspecified error", (char *) NULL);
     }
@@ -343,7 +448,7 @@ void EWALD_count_charged_particles()
     }
   }
   
-  MPI_Reduce(node_sums, tot_sums, 3, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  MPI_Allreduce(node_sums, tot_sums, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 
   ewald_sum_qpart    = (int)(tot_sums[0]+0.1);
   ewald_sum_q2       = tot_sums[1];
@@ -352,6 +457,8 @@ void EWALD_count_charged_particles()
 
 void EWALD_init()
 {
+  int n;
+
   ux  = 1/box_l[0];
   ux2 = ux*ux;
   uy  = 1/box_l[1];
@@ -376,6 +483,29 @@ void EWALD_init()
 
     EWALD_TRACE(fprintf(stderr,"%d: EWALD_total_kvectors=%d\n",this_node,total_kvectors));
 
+    n_scx = ewald.kmax + 1;
+    n_scy = 2*ewald.kmax + 1;
+    n_scz = 2*ewald.kmax + 1;
+    scxoff = 0;
+    scyoff = ewald.kmax;
+    sczoff = ewald.kmax;
+    sums    = realloc(sums,   total_kvectors*sizeof(double));
+    sumc    = realloc(sumc,   total_kvectors*sizeof(double));
+    totsums = realloc(totsums,total_kvectors*sizeof(double));
+    totsumc = realloc(totsumc,total_kvectors*sizeof(double));
+    /* the cache sizes depend on kmax, force reallocation */
+    n = max_lq;
+    max_lq = 0;
+    EWALD_realloc_charges(n);
+
+#ifdef EWALD_PME
+    EWALD_pme_init();
+    if (ewald.method == EWALD_METHOD_AUTO && pme_mesh > 0)
+      EWALD_measure_crossover();
+#endif
+    /* the timing overwrites the structure factors */
+    sf_valid = 0;
+
     EWALD_TRACE(fprintf(stderr,"%d: EWALD initialized\n",this_node));
 
     EWALD_count_charged_particles();
@@ -384,208 +514,517 @@ void EWALD_init()
 
 }
 
+static void EWALD_realloc_charges(int n)
+{
+  if (n <= max_lq)
+    return;
+  max_lq = n;
+  lq  = realloc(lq, max_lq*sizeof(EwaldCharge));
+  lf  = realloc(lf, 3*max_lq*sizeof(double));
+  scx = realloc(scx, n_scx*max_lq*sizeof(SCCache));
+  scy = realloc(scy, n_scy*max_lq*sizeof(SCCache));
+  scz = realloc(scz, n_scz*max_lq*sizeof(SCCache));
+}
+
 void EWALD_on_resort_particles()
 { 
-  int i;
-
-  n_localpart = cells_get_n_particles();
+  int n_localpart = cells_get_n_particles();
 
   EWALD_TRACE(fprintf(stderr,"%d: EWALD_on_resort_particles, n_localpart=%d\n",this_node,n_localpart));
 
-  n_scx = (int)(ceil(ewald.kmax) + 1);
-  n_scy = (int)(2*ceil(ewald.kmax) + 1);
-  n_scz = (int)(2*ceil(ewald.kmax) + 1);
-  scxoff = 0;
-  scyoff = (int)(ceil(ewald.kmax));
-  sczoff = (int)(ceil(ewald.kmax));
-  scx=realloc(scx,total_kvectors*sizeof(SCCache*));
-  scy=realloc(scy,total_kvectors*sizeof(SCCache*));
-  scz=realloc(scz,total_kvectors*sizeof(SCCache*));
-  for (i=0; i<total_kvectors; i++) {
-    scx[i]=realloc(scx[i],n_localpart*sizeof(SCCache));
-    scy[i]=realloc(scy[i],n_localpart*sizeof(SCCache));
-    scz[i]=realloc(scz[i],n_localpart*sizeof(SCCache));
-  }
-  sums= realloc(sums,total_kvectors*sizeof(double));
-  sumc= realloc(sumc,total_kvectors*sizeof(double));
-  totsums=realloc(totsums,total_kvectors*sizeof(double));
-  totsumc=realloc(totsumc,total_kvectors*sizeof(double));
+  EWALD_realloc_charges(n_localpart);
 }
 
-
-double EWALD_calc_kspace_forces(int force_flag, int energy_flag)
+/** copy the local charged particles into \ref lq. */
+static void EWALD_gather_charges()
 {
   Cell *cell;
   Particle *p;
-  int i,j,c,np,k,kx,ky,kz;
-  int y,z;
-  double rclx, rcly, rclz, sps, spc;
-  double fact,tf,tfc,tfs;
-  /* Prefactor for force */
-  double q,force_prefac;
-  /* k space energy */
-  double k_space_energy=0.0, node_k_space_energy=0.0;
+  int i, c, np;
 
-  EWALD_TRACE(fprintf(stderr,"%d: EWALD_calc_kspace_forces, force flag=%d, energy flag=%d\n",this_node,force_flag,energy_flag));
+  EWALD_realloc_charges(cells_get_n_particles());
 
-  rclx=C_2PI/box_l[0];
-  rcly=C_2PI/box_l[1];
-  rclz=C_2PI/box_l[2];
-  
-  y=scyoff;
-  z=sczoff;
-
-  force_prefac = coulomb.prefactor;
-
-  /* === K Space Calculations === */
-
-  /* === Calculation of k space sums that are common for energy and forces  === */
-  if(energy_flag || force_flag) {
-    j=0;
-    for (c = 0; c < local_cells.n; c++) {
-      cell = local_cells.cell[c];
-      p  = cell->part;
-      np = cell->n;
-      for(i=0; i<np; i++) {
-        scx[  0][j].c= 1.0;
-        scx[  0][j].s= 0.0;
-        scy[y+0][j].c= 1.0;
-        scy[y+0][j].s= 0.0;
-        scz[z+0][j].c= 1.0;
-        scz[z+0][j].s= 0.0;
-        scx[  1][j].c= cos(rclx*p[i].r.p[0]);
-        scx[  1][j].s= sin(rclx*p[i].r.p[0]);
-        scy[y+1][j].c= cos(rcly*p[i].r.p[1]); 
-        scy[y+1][j].s= sin(rcly*p[i].r.p[1]); 
-        scz[z+1][j].c= cos(rclz*p[i].r.p[2]); 
-        scz[z+1][j].s= sin(rclz*p[i].r.p[2]);
-        scy[y-1][j].c= scy[y+1][j].c;
-        scy[y-1][j].s=-scy[y+1][j].s;
-        scz[z-1][j].c= scz[z+1][j].c;
-        scz[z-1][j].s=-scz[z+1][j].s;
-        j++;
+  n_lq = 0;
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for(i=0; i<np; i++) {
+      if (p[i].p.q != 0.0) {
+	lq[n_lq].r[0] = p[i].r.p[0];
+	lq[n_lq].r[1] = p[i].r.p[1];
+	lq[n_lq].r[2] = p[i].r.p[2];
+	lq[n_lq].q    = p[i].p.q;
+	n_lq++;
       }
     }
-    
+  }
+}
 
-    for (k=2; k<=ewald.kmax; k++) {
-      j=0;
-      for (c = 0; c < local_cells.n; c++) {
-	cell = local_cells.cell[c];
-	p  = cell->part;
-	np = cell->n;
-	for(i=0; i<np; i++) {
-          scx[  k][j].c= scx[  k-1][j].c*scx[  1][j].c - scx[  k-1][j].s*scx[  1][j].s;
-          scx[  k][j].s= scx[  k-1][j].s*scx[  1][j].c + scx[  k-1][j].c*scx[  1][j].s;
-          scy[y+k][j].c= scy[y+k-1][j].c*scy[y+1][j].c - scy[y+k-1][j].s*scy[y+1][j].s;
-          scy[y+k][j].s= scy[y+k-1][j].s*scy[y+1][j].c + scy[y+k-1][j].c*scy[y+1][j].s;
-          scz[z+k][j].c= scz[z+k-1][j].c*scz[z+1][j].c - scz[z+k-1][j].s*scz[z+1][j].s;
-          scz[z+k][j].s= scz[z+k-1][j].s*scz[z+1][j].c + scz[z+k-1][j].c*scz[z+1][j].s;
-          scy[y-k][j].c=  scy[y+k][j].c;
-          scy[y-k][j].s= -scy[y+k][j].s;
-          scz[z-k][j].c=  scz[z+k][j].c;
-          scz[z-k][j].s= -scz[z+k][j].s;
-          j++;
-        }
+/** add the forces in \ref lf to the local charged particles, in the
+    order of \ref EWALD_gather_charges. */
+static void EWALD_scatter_forces()
+{
+  Cell *cell;
+  Particle *p;
+  int i, c, np, j = 0;
+  double force_prefac = coulomb.prefactor;
+
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for(i=0; i<np; i++) {
+      if (p[i].p.q != 0.0) {
+	p[i].f.f[0] += force_prefac*lf[3*j    ];
+	p[i].f.f[1] += force_prefac*lf[3*j + 1];
+	p[i].f.f[2] += force_prefac*lf[3*j + 2];
+	j++;
+	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: EWALD  f = (%.3e,%.3e,%.3e)\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2]));
       }
     }
+  }
+}
 
+static void EWALD_structure_factors(EwaldCharge *c, int n)
+{
+  int i, k;
+  int y = scyoff, z = sczoff;
+  double rclx, rcly, rclz, sps, spc;
+  SCCache *sx, *sy, *sz;
+
+  rclx=C_2PI*ux;
+  rcly=C_2PI*uy;
+  rclz=C_2PI*uz;
+
+  /* sin/cos of the coordinates for all kx, ky, kz */
+  for(i=0; i<n; i++) {
+    scx[          i].c = 1.0;
+    scx[          i].s = 0.0;
+    scy[y*max_lq +i].c = 1.0;
+    scy[y*max_lq +i].s = 0.0;
+    scz[z*max_lq +i].c = 1.0;
+    scz[z*max_lq +i].s = 0.0;
+    scx[   max_lq+i].c = cos(rclx*c[i].r[0]);
+    scx[   max_lq+i].s = sin(rclx*c[i].r[0]);
+    scy[(y+1)*max_lq+i].c = cos(rcly*c[i].r[1]);
+    scy[(y+1)*max_lq+i].s = sin(rcly*c[i].r[1]);
+    scz[(z+1)*max_lq+i].c = cos(rclz*c[i].r[2]);
+    scz[(z+1)*max_lq+i].s = sin(rclz*c[i].r[2]);
+  }
+  for (k=2; k<=ewald.kmax; k++) {
+    for(i=0; i<n; i++) {
+      sx = scx + i;
+      sy = scy + y*max_lq + i;
+      sz = scz + z*max_lq + i;
+      sx[k*max_lq].c = sx[(k-1)*max_lq].c*sx[max_lq].c - sx[(k-1)*max_lq].s*sx[max_lq].s;
+      sx[k*max_lq].s = sx[(k-1)*max_lq].s*sx[max_lq].c + sx[(k-1)*max_lq].c*sx[max_lq].s;
+      sy[k*max_lq].c = sy[(k-1)*max_lq].c*sy[max_lq].c - sy[(k-1)*max_lq].s*sy[max_lq].s;
+      sy[k*max_lq].s = sy[(k-1)*max_lq].s*sy[max_lq].c + sy[(k-1)*max_lq].c*sy[max_lq].s;
+      sz[k*max_lq].c = sz[(k-1)*max_lq].c*sz[max_lq].c - sz[(k-1)*max_lq].s*sz[max_lq].s;
+      sz[k*max_lq].s = sz[(k-1)*max_lq].s*sz[max_lq].c + sz[(k-1)*max_lq].c*sz[max_lq].s;
+    }
+  }
+  /* negative ky, kz */
+  for (k=1; k<=ewald.kmax; k++) {
+    for(i=0; i<n; i++) {
+      scy[(y-k)*max_lq+i].c =  scy[(y+k)*max_lq+i].c;
+      scy[(y-k)*max_lq+i].s = -scy[(y+k)*max_lq+i].s;
+      scz[(z-k)*max_lq+i].c =  scz[(z+k)*max_lq+i].c;
+      scz[(z-k)*max_lq+i].s = -scz[(z+k)*max_lq+i].s;
+    }
+  }
 
+  /* structure factors */
+  for (k=0; k<total_kvectors; k++) {
+    sx = scx + kxfield[k]*max_lq;
+    sy = scy + (y+kyfield[k])*max_lq;
+    sz = scz + (z+kzfield[k])*max_lq;
+    sums[k]=0.0;
+    sumc[k]=0.0;
+    for(i=0; i<n; i++) {
+      spc=   sx[i].c*sy[i].c*sz[i].c - sx[i].s*sy[i].s*sz[i].c 
+           - sx[i].c*sy[i].s*sz[i].s - sx[i].s*sy[i].c*sz[i].s;
+      sps= - sx[i].s*sy[i].s*sz[i].s + sx[i].c*sy[i].c*sz[i].s
+           + sx[i].c*sy[i].s*sz[i].c + sx[i].s*sy[i].c*sz[i].c;
+      sums[k] += c[i].q*sps;
+      sumc[k] += c[i].q*spc;
+    }
+  }
+  MPI_Allreduce(sums,totsums,total_kvectors,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+  MPI_Allreduce(sumc,totsumc,total_kvectors,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
+}
+
+static double EWALD_direct_kspace(EwaldCharge *c, int n, double *f, int energy_flag)
+{
+  int i, k, kx, ky, kz;
+  int y = scyoff, z = sczoff;
+  double sps, spc, tfc, tfs, tf;
+  double energy = 0.0;
+  SCCache *sx, *sy, *sz;
+
+  EWALD_structure_factors(c, n);
+
+  /* the k-vectors cover one half space, the other half contributes the same */
+  if (energy_flag)
+    for (k=0; k<total_kvectors; k++)
+      energy += 2.0*kvec[k]*(totsums[k]*totsums[k] + totsumc[k]*totsumc[k]);
+
+  if (f) {
     for (k=0; k<total_kvectors; k++) {
-      kx=(  kxfield[k]);
-      ky=(y+kyfield[k]);
-      kz=(z+kzfield[k]);
-      sums[k]=0.0;
-      sumc[k]=0.0;
-      j=0;
-      for (c = 0; c < local_cells.n; c++) {
-        cell = local_cells.cell[c];
-        p  = cell->part;
-        np = cell->n;
-        for(i=0; i<np; i++) {
-          if (p[i].p.q != 0.0) {
-            spc=   scx[kx][j].c*scy[ky][j].c*scz[kz][j].c - scx[kx][j].s*scy[ky][j].s*scz[kz][j].c 
-                 - scx[kx][j].c*scy[ky][j].s*scz[kz][j].s - scx[kx][j].s*scy[ky][j].c*scz[kz][j].s;
-            sps= - scx[kx][j].s*scy[ky][j].s*scz[kz][j].s + scx[kx][j].c*scy[ky][j].c*scz[kz][j].s
-                 + scx[kx][j].c*scy[ky][j].s*scz[kz][j].c + scx[kx][j].s*scy[ky][j].c*scz[kz][j].c;
-
-            sums[k] += p[i].p.q*sps;
-            sumc[k] += p[i].p.q*spc;
-          }
-          j++;
-        } 
+      kx = kxfield[k];
+      ky = kyfield[k];
+      kz = kzfield[k];
+      sx = scx + kx*max_lq;
+      sy = scy + (y+ky)*max_lq;
+      sz = scz + (z+kz)*max_lq;
+      tfc = 2.0*C_2PI*2.0*kvec[k]*totsumc[k];
+      tfs = 2.0*C_2PI*2.0*kvec[k]*totsums[k];
+      for(i=0; i<n; i++) {
+	spc=   sx[i].c*sy[i].c*sz[i].c - sx[i].s*sy[i].s*sz[i].c 
+	     - sx[i].c*sy[i].s*sz[i].s - sx[i].s*sy[i].c*sz[i].s;
+	sps= - sx[i].s*sy[i].s*sz[i].s + sx[i].c*sy[i].c*sz[i].s
+	     + sx[i].c*sy[i].s*sz[i].c + sx[i].s*sy[i].c*sz[i].c;
+	tf = c[i].q*(sps*tfc - spc*tfs);
+	f[3*i    ] += tf*kx*ux;
+	f[3*i + 1] += tf*ky*uy;
+	f[3*i + 2] += tf*kz*uz;
       }
     }
-    MPI_Allreduce(sums,totsums,total_kvectors,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
-    MPI_Allreduce(sumc,totsumc,total_kvectors,MPI_DOUBLE,MPI_SUM,MPI_COMM_WORLD);
   }
 
+  return energy;
+}
 
-  /* === K Space Energy Calculation  === */
-  if(energy_flag) {
-    for (k=0; k<total_kvectors; k++) {
-      kx=kxfield[k];
-      ky=kyfield[k];
-      kz=kzfield[k];
-      if (kx==0) 
-        fact=1.0;
-      else
-        fact=2.0;
-      node_k_space_energy += fact * kvec[k] * (totsums[k]*totsums[k] + totsumc[k]*totsumc[k]);
+#ifdef EWALD_PME
+
+/** Cardinal B-spline weights \f$M_p(w+j)\f$ and their derivatives
+    for \f$j=0,\ldots,p-1\f$ and \f$0\le w<1\f$, \f$p=\f$ \ref PME_CAO. */
+static void pme_spline(double w, double *m, double *dm)
+{
+  int j, k;
+
+  m[0] = w;
+  m[1] = 1.0 - w;
+  for (j = 2; j < PME_CAO; j++)
+    m[j] = 0.0;
+  for (k = 2; k < PME_CAO; k++) {
+    if (k == PME_CAO - 1) {
+      dm[0] = m[0];
+      for (j = 1; j < PME_CAO; j++)
+	dm[j] = m[j] - m[j-1];
     }
-    EWALD_TRACE(fprintf(stderr,"%d: EWALD: node_k_space_energy=%g\n",this_node,node_k_space_energy));
-    node_k_space_energy *= coulomb.prefactor;
+    for (j = k; j > 0; j--)
+      m[j] = ((w + j)*m[j] + (k + 1 - w - j)*m[j-1])/k;
+    m[0] = w*m[0]/k;
+  }
+}
 
-    MPI_Reduce(&node_k_space_energy, &k_space_energy, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+/** B-spline weights of a charge in all three directions. The weight
+    m[d][j] belongs to the mesh point g[d][j]. */
+static void pme_weights(double *r, double m[3][PME_CAO], double dm[3][PME_CAO], int g[3][PME_CAO])
+{
+  int d, j, g0;
+  double u;
+
+  for (d = 0; d < 3; d++) {
+    u  = pme_mesh*r[d]*box_l_i[d];
+    g0 = (int)floor(u);
+    pme_spline(u - g0, m[d], dm[d]);
+    g0 %= pme_mesh;
+    if (g0 < 0) g0 += pme_mesh;
+    for (j = 0; j < PME_CAO; j++)
+      g[d][j] = (g0 - j + pme_mesh) % pme_mesh;
+  }
+}
+
+/** smallest number of mesh points with only factors 2, 3 and 5 for
+    which the B-spline interpolation error of each k-vector, estimated
+    as \f$(k/(mesh-k))^p\f$ times its Gaussian damping, stays below the
+    damping at \ref ewald_struct::kmax, i.e. the truncation error of
+    the k-space sum. Returns 0 if this needs more than \ref PME_MAX_MESH
+    points. */
+static int pme_choose_mesh()
+{
+  int n, m, k;
+  double fac = SQR(PI/ewald.alpha_L), cut = exp(-fac*ewald.kmaxsq);
+
+  for (n = 2*ewald.kmax + 2; n <= PME_MAX_MESH; n++) {
+    m = n;
+    while (m % 2 == 0) m /= 2;
+    while (m % 3 == 0) m /= 3;
+    while (m % 5 == 0) m /= 5;
+    if (m != 1)
+      continue;
+    for (k = 1; k < ewald.kmax; k++)
+      if (pow((double)k/(n - k), PME_CAO)*exp(-fac*k*k) > cut)
+	break;
+    if (k == ewald.kmax)
+      return n;
+  }
+  return 0;
+}
 
-    EWALD_TRACE(fprintf(stderr,"%d: EWALD: 1 k_space_energy=%g\n",this_node,k_space_energy));
+/** release the mesh and the FFT plans. */
+static void EWALD_pme_free()
+{
+  if (pme_mesh > 0) {
+    fftw_destroy_plan(pme_fwd);
+    fftw_destroy_plan(pme_bwd);
+    fftw_free(pme_rs);
+    fftw_free(pme_rs_tot);
+    fftw_free(pme_ks);
+    free(pme_influence);
+    free(pme_bmod);
+    pme_mesh = 0;
+  }
+}
 
-    /* self energy correction */
-    k_space_energy -= coulomb.prefactor*(ewald_sum_q2*ewald.alpha_L*box_l_i[0] * wupii);
-    EWALD_TRACE(fprintf(stderr,"%d: EWALD: 2 k_space_energy=%g\n",this_node,k_space_energy));
-    /* net charge correction */
-    /*    k_space_energy -= coulomb.prefactor*(ewald_square_sum_q*PI / (2.0*box_l[0]*SQR(ewald.alpha_L))); */
-    EWALD_TRACE(fprintf(stderr,"%d: EWALD: 3 k_space_energy=%g\n",this_node,k_space_energy));
+static void EWALD_pme_init()
+{
+  int i, k, kx, ky, kz, mesh3, ks_size, idx;
+  double m[PME_CAO], dm[PME_CAO], re, im, arg;
+
+  EWALD_pme_free();
+  if (ewald.method == EWALD_METHOD_DIRECT)
+    return;
+
+  pme_mesh = pme_choose_mesh();
+  if (pme_mesh == 0) {
+    if (this_node == 0)
+      fprintf(stderr, "WARNING: Ewald PME would need more than %d mesh points per direction, using the direct k-space sum\n",
+	      PME_MAX_MESH);
+    return;
+  }
+  mesh3    = pme_mesh*pme_mesh*pme_mesh;
+  ks_size  = pme_mesh*pme_mesh*(pme_mesh/2 + 1);
+
+  EWALD_TRACE(fprintf(stderr,"%d: EWALD_pme_init: mesh %d, cao %d\n",this_node,pme_mesh,PME_CAO));
+
+  pme_rs        = fftw_malloc(mesh3*sizeof(double));
+  pme_rs_tot    = fftw_malloc(mesh3*sizeof(double));
+  pme_ks        = fftw_malloc(ks_size*sizeof(fftw_complex));
+  pme_influence = malloc(ks_size*sizeof(double));
+  pme_bmod      = malloc(pme_mesh*sizeof(double));
+
+  pme_fwd = fftw_plan_dft_r2c_3d(pme_mesh, pme_mesh, pme_mesh, pme_rs_tot, pme_ks, FFTW_ESTIMATE);
+  pme_bwd = fftw_plan_dft_c2r_3d(pme_mesh, pme_mesh, pme_mesh, pme_ks, pme_rs_tot, FFTW_ESTIMATE);
+
+  /* B-spline moduli, M_p(k+1) are the spline weights at w=0 */
+  pme_spline(0.0, m, dm);
+  for (i = 0; i < pme_mesh; i++) {
+    re = im = 0.0;
+    for (k = 0; k < PME_CAO - 1; k++) {
+      arg = C_2PI*i*k/pme_mesh;
+      re += m[k+1]*cos(arg);
+      im += m[k+1]*sin(arg);
+    }
+    pme_bmod[i] = 1.0/(re*re + im*im);
   }
-    
 
-  /* === K Space Force Calculation  === */
-  if(force_flag) {
-    for (k=0; k<total_kvectors; k++) {
-      kx=kxfield[k];
-      ky=y+kyfield[k];
-      kz=z+kzfield[k];
-      if (kx==0) 
-        fact=1.0;
-      else
-        fact=2.0;
-      tfc=fact*kvec[k]*totsumc[k];
-      tfs=fact*kvec[k]*totsums[k];
-      j=0;
-      for (c = 0; c < local_cells.n; c++) {
-	cell = local_cells.cell[c];
-	p  = cell->part;
-	np = cell->n;
-	for(i=0; i<np; i++) { 
-	  if( (q=p[i].p.q) != 0.0 ) {
-            spc=   scx[kx][j].c*scy[ky][j].c*scz[kz][j].c - scx[kx][j].s*scy[ky][j].s*scz[kz][j].c 
-                 - scx[kx][j].s*scy[ky][j].c*scz[kz][j].s - scx[kx][j].c*scy[ky][j].s*scz[kz][j].s;
-            sps=   scx[kx][j].s*scy[ky][j].s*scz[kz][j].s - scx[kx][j].c*scy[ky][j].c*scz[kz][j].s
-                 - scx[kx][j].c*scy[ky][j].s*scz[kz][j].c - scx[kx][j].s*scy[ky][j].c*scz[kz][j].c;
-            tf= spc*tfs+sps*tfc*q;
-            p[i].f.f[0] += force_prefac*2.0*C_2PI*tf*kx;
-            p[i].f.f[1] += force_prefac*2.0*C_2PI*tf*ky;
-            p[i].f.f[2] += force_prefac*2.0*C_2PI*tf*kz;
-	  }
-          j++;
+  /* influence function on the half complex mesh. For kx=0, both the
+     k-vector and its negative are stored explicitly. */
+  for (i = 0; i < ks_size; i++)
+    pme_influence[i] = 0.0;
+  for (k = 0; k < total_kvectors; k++) {
+    kx = kxfield[k];
+    ky = (kyfield[k] + pme_mesh) % pme_mesh;
+    kz = (kzfield[k] + pme_mesh) % pme_mesh;
+    idx = (kz*pme_mesh + ky)*(pme_mesh/2 + 1) + kx;
+    pme_influence[idx] = kvec[k]*pme_bmod[kx]*pme_bmod[ky]*pme_bmod[kz];
+    if (kx == 0) {
+      ky = (pme_mesh - ky) % pme_mesh;
+      kz = (pme_mesh - kz) % pme_mesh;
+      pme_influence[(kz*pme_mesh + ky)*(pme_mesh/2 + 1)] = pme_influence[idx];
+    }
+  }
+}
+
+/** assign the charges to the mesh, sum it over all nodes and transform
+    it into \ref pme_ks. */
+static void pme_assign_charges(EwaldCharge *c, int n)
+{
+  int i, jx, jy, jz, ind, mesh3 = pme_mesh*pme_mesh*pme_mesh;
+  int g[3][PME_CAO];
+  double m[3][PME_CAO], dm[3][PME_CAO];
+  double qz, qzy;
+
+  memset(pme_rs, 0, mesh3*sizeof(double));
+  for (i = 0; i < n; i++) {
+    pme_weights(c[i].r, m, dm, g);
+    for (jz = 0; jz < PME_CAO; jz++) {
+      qz = c[i].q*m[2][jz];
+      for (jy = 0; jy < PME_CAO; jy++) {
+	qzy = qz*m[1][jy];
+	ind = (g[2][jz]*pme_mesh + g[1][jy])*pme_mesh;
+	for (jx = 0; jx < PME_CAO; jx++)
+	  pme_rs[ind + g[0][jx]] += qzy*m[0][jx];
+      }
+    }
+  }
+  MPI_Allreduce(pme_rs, pme_rs_tot, mesh3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 
-	    ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: EWALD  f = (%.3e,%.3e,%.3e) in dir %d add %.5f\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2],d_rs,-db_fsum));
+  fftw_execute(pme_fwd);
+}
 
+static double EWALD_pme_kspace(EwaldCharge *c, int n, double *f, int energy_flag)
+{
+  int i, jx, jy, jz, ind, ks_size, hmesh = pme_mesh/2 + 1;
+  int g[3][PME_CAO];
+  double m[3][PME_CAO], dm[3][PME_CAO];
+  double phi, fx, fy, fz, scale;
+  double energy = 0.0;
+
+  ks_size = pme_mesh*pme_mesh*hmesh;
+
+  pme_assign_charges(c, n);
+
+  /* entries with kx>0 stand for themselves and their negative */
+  if (energy_flag)
+    for (i = 0; i < ks_size; i++)
+      if (pme_influence[i] != 0.0)
+	energy += ((i % hmesh) ? 2.0 : 1.0)*pme_influence[i]*
+	  (pme_ks[i][0]*pme_ks[i][0] + pme_ks[i][1]*pme_ks[i][1]);
+
+  if (f) {
+    for (i = 0; i < ks_size; i++) {
+      pme_ks[i][0] *= pme_influence[i];
+      pme_ks[i][1] *= pme_influence[i];
+    }
+    fftw_execute(pme_bwd);
+
+    /* back interpolation of the potential gradient */
+    for (i = 0; i < n; i++) {
+      pme_weights(c[i].r, m, dm, g);
+      fx = fy = fz = 0.0;
+      for (jz = 0; jz < PME_CAO; jz++) {
+	for (jy = 0; jy < PME_CAO; jy++) {
+	  ind = (g[2][jz]*pme_mesh + g[1][jy])*pme_mesh;
+	  for (jx = 0; jx < PME_CAO; jx++) {
+	    phi = pme_rs_tot[ind + g[0][jx]];
+	    fx += phi*dm[0][jx]* m[1][jy]* m[2][jz];
+	    fy += phi* m[0][jx]*dm[1][jy]* m[2][jz];
+	    fz += phi* m[0][jx]* m[1][jy]*dm[2][jz];
+	  }
 	}
       }
+      scale = -2.0*c[i].q*pme_mesh;
+      f[3*i    ] += scale*fx*ux;
+      f[3*i + 1] += scale*fy*uy;
+      f[3*i + 2] += scale*fz*uz;
     }
   }
 
+  return energy;
+}
+
+static void EWALD_measure_crossover()
+{
+  int i, r, n = PME_TIMING_CHARGES;
+  double t_direct = 0, t_mesh = 0, t_empty = 0, t, a_direct, a_mesh;
+
+  EWALD_realloc_charges(n);
+  /* a deterministic, roughly uniform test configuration */
+  for (i = 0; i < n; i++) {
+    lq[i].r[0] = box_l[0]*fmod(0.5 + i*0.6180339887, 1.0);
+    lq[i].r[1] = box_l[1]*fmod(0.5 + i*0.7548776662, 1.0);
+    lq[i].r[2] = box_l[2]*fmod(0.5 + i*0.5698402910, 1.0);
+    lq[i].q    = (i % 2) ? -1.0 : 1.0;
+  }
+
+  for (r = 0; r < PME_TIMING_ROUNDS; r++) {
+    markTime();
+    EWALD_direct_kspace(lq, n, lf, 1);
+    markTime();
+    t = diffTime();
+    if (r == 0 || t < t_direct) t_direct = t;
+
+    markTime();
+    EWALD_pme_kspace(lq, n, lf, 1);
+    markTime();
+    t = diffTime();
+    if (r == 0 || t < t_mesh) t_mesh = t;
+
+    markTime();
+    EWALD_pme_kspace(lq, 0, lf, 1);
+    markTime();
+    t = diffTime();
+    if (r == 0 || t < t_empty) t_empty = t;
+  }
+
+  /* the direct sum is linear in the number of charges, the mesh has an
+     additional fixed cost for the FFTs */
+  a_direct = t_direct/n;
+  a_mesh   = (t_mesh - t_empty)/n;
+  if (a_mesh < 0) a_mesh = 0;
+  if (a_direct > a_mesh)
+    pme_crossover = t_empty/(a_direct - a_mesh);
+  else
+    pme_crossover = -1;
+  MPI_Bcast(&pme_crossover, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+  EWALD_TRACE(fprintf(stderr,"%d: EWALD: direct %g ms, mesh %g+%g ms per charge, crossover at %g charges per node\n",
+		      this_node,a_direct,t_empty,a_mesh,pme_crossover));
+}
+
+#endif
+
+static int EWALD_use_mesh()
+{
+#ifdef EWALD_PME
+  switch (ewald.method) {
+  case EWALD_METHOD_PME:
+    return pme_mesh > 0;
+  case EWALD_METHOD_AUTO:
+    return pme_mesh > 0 && pme_crossover >= 0 && ewald_sum_qpart > pme_crossover*n_nodes;
+  default: break;
+  }
+#endif
+  return 0;
+}
+
+double EWALD_calc_kspace_forces(int force_flag, int energy_flag)
+{
+  int i;
+  double k_space_energy=0.0;
+
+  EWALD_TRACE(fprintf(stderr,"%d: EWALD_calc_kspace_forces, force flag=%d, energy flag=%d\n",this_node,force_flag,energy_flag));
+
+  if (!force_flag && !energy_flag)
+    return 0.0;
+
+  EWALD_gather_charges();
+  if (force_flag)
+    for (i = 0; i < 3*n_lq; i++)
+      lf[i] = 0.0;
+
+#ifdef EWALD_PME
+  if (EWALD_use_mesh())
+    k_space_energy = EWALD_pme_kspace(lq, n_lq, force_flag ? lf : NULL, energy_flag);
+  else
+#endif
+  {
+    k_space_energy = EWALD_direct_kspace(lq, n_lq, force_flag ? lf : NULL, energy_flag);
+    sf_valid = 1;
+    sf_mesh  = 0;
+  }
+
+  if (force_flag)
+    EWALD_scatter_forces();
+
+  /* the k-space sums are known on all nodes, the energy is reported by the master */
+  if (!energy_flag || this_node != 0)
+    return 0.0;
+
+  k_space_energy *= coulomb.prefactor;
+  EWALD_TRACE(fprintf(stderr,"%d: EWALD: 1 k_space_energy=%g\n",this_node,k_space_energy));
+
+  /* self energy correction */
+  k_space_energy -= coulomb.prefactor*(ewald_sum_q2*ewald.alpha_L*box_l_i[0] * wupii);
+  EWALD_TRACE(fprintf(stderr,"%d: EWALD: 2 k_space_energy=%g\n",this_node,k_space_energy));
+  /* net charge correction */
+  /*    k_space_energy -= coulomb.prefactor*(ewald_square_sum_q*PI / (2.0*box_l[0]*SQR(ewald.alpha_L))); */
+
 /* currently, only metallic boundary conditions are allowed
   if (ewald.epsilon != EWALD_EPSILON_METALLIC)
     k_space_energy -= calc_dipole_term(force_flag, energy_flag);
@@ -594,24 +1033,193 @@ double EWALD_calc_kspace_forces(int force_flag, int energy_flag)
   return k_space_energy;
 }
 
-void   EWALD_exit()
-{ 
-  /* free memory */
+void EWALD_invalidate_structure_factors()
+{
+  sf_valid = 0;
+}
 
-  int i;
+/** add the structure factor of a single charge \a q at \a r to
+    \ref sums and \ref sumc. \a cx, \a cy and \a cz are scratch
+    arrays for the sin/cos values in the three directions. */
+static void EWALD_add_charge_sf(double *r, double q, SCCache *cx, SCCache *cy, SCCache *cz)
+{
+  int k;
+  double sps, spc;
+  SCCache *sy = cy + ewald.kmax, *sz = cz + ewald.kmax, *sx;
+
+  cx[0].c = sy[0].c = sz[0].c = 1.0;
+  cx[0].s = sy[0].s = sz[0].s = 0.0;
+  cx[1].c = cos(C_2PI*ux*r[0]);
+  cx[1].s = sin(C_2PI*ux*r[0]);
+  sy[1].c = cos(C_2PI*uy*r[1]);
+  sy[1].s = sin(C_2PI*uy*r[1]);
+  sz[1].c = cos(C_2PI*uz*r[2]);
+  sz[1].s = sin(C_2PI*uz*r[2]);
+  for (k=2; k<=ewald.kmax; k++) {
+    cx[k].c = cx[k-1].c*cx[1].c - cx[k-1].s*cx[1].s;
+    cx[k].s = cx[k-1].s*cx[1].c + cx[k-1].c*cx[1].s;
+    sy[k].c = sy[k-1].c*sy[1].c - sy[k-1].s*sy[1].s;
+    sy[k].s = sy[k-1].s*sy[1].c + sy[k-1].c*sy[1].s;
+    sz[k].c = sz[k-1].c*sz[1].c - sz[k-1].s*sz[1].s;
+    sz[k].s = sz[k-1].s*sz[1].c + sz[k-1].c*sz[1].s;
+  }
+  for (k=1; k<=ewald.kmax; k++) {
+    sy[-k].c =  sy[k].c;
+    sy[-k].s = -sy[k].s;
+    sz[-k].c =  sz[k].c;
+    sz[-k].s = -sz[k].s;
+  }
 
-  for (i=0; i<total_kvectors; i++) {
-    free(scx[i]);
-    free(scy[i]);
-    free(scz[i]);
+  for (k=0; k<total_kvectors; k++) {
+    sx = cx + kxfield[k];
+    spc=   sx->c*sy[kyfield[k]].c*sz[kzfield[k]].c - sx->s*sy[kyfield[k]].s*sz[kzfield[k]].c 
+         - sx->c*sy[kyfield[k]].s*sz[kzfield[k]].s - sx->s*sy[kyfield[k]].c*sz[kzfield[k]].s;
+    sps= - sx->s*sy[kyfield[k]].s*sz[kzfield[k]].s + sx->c*sy[kyfield[k]].c*sz[kzfield[k]].s
+         + sx->c*sy[kyfield[k]].s*sz[kzfield[k]].c + sx->s*sy[kyfield[k]].c*sz[kzfield[k]].c;
+    sums[k] += q*sps;
+    sumc[k] += q*spc;
   }
+}
+
+#ifdef EWALD_PME
+/** square root of the B-spline moduli of k-vector \a k. */
+MDINLINE double pme_sfac(int k)
+{
+  return sqrt(pme_bmod[kxfield[k]]*
+	      pme_bmod[(kyfield[k] + pme_mesh) % pme_mesh]*
+	      pme_bmod[(kzfield[k] + pme_mesh) % pme_mesh]);
+}
+
+static void EWALD_pme_structure_factors(EwaldCharge *c, int n)
+{
+  int k, idx;
+  double b;
+
+  pme_assign_charges(c, n);
+
+  for (k=0; k<total_kvectors; k++) {
+    idx = (((kzfield[k] + pme_mesh) % pme_mesh)*pme_mesh +
+	   (kyfield[k] + pme_mesh) % pme_mesh)*(pme_mesh/2 + 1) + kxfield[k];
+    b = pme_sfac(k);
+    totsumc[k] = b*pme_ks[idx][0];
+    totsums[k] = b*pme_ks[idx][1];
+  }
+}
+
+/** same as \ref EWALD_add_charge_sf, but for the mesh structure
+    factors of \ref EWALD_pme_structure_factors. */
+static void EWALD_pme_add_charge_sf(double *r, double q, SCCache *cx, SCCache *cy, SCCache *cz)
+{
+  int d, j, k;
+  int g[3][PME_CAO];
+  double m[3][PME_CAO], dm[3][PME_CAO], arg, re, im, b;
+  SCCache *s[3], *sx, *sy, *sz;
+
+  s[0] = cx;
+  s[1] = cy + ewald.kmax;
+  s[2] = cz + ewald.kmax;
+
+  /* 1d transforms of the assignment weights, with the sign of the
+     forward FFT */
+  pme_weights(r, m, dm, g);
+  for (d = 0; d < 3; d++)
+    for (k = (d == 0) ? 0 : -ewald.kmax; k <= ewald.kmax; k++) {
+      s[d][k].c = s[d][k].s = 0.0;
+      for (j = 0; j < PME_CAO; j++) {
+	arg = C_2PI*k*g[d][j]/pme_mesh;
+	s[d][k].c += m[d][j]*cos(arg);
+	s[d][k].s -= m[d][j]*sin(arg);
+      }
+    }
+
+  for (k=0; k<total_kvectors; k++) {
+    sx = s[0] + kxfield[k];
+    sy = s[1] + kyfield[k];
+    sz = s[2] + kzfield[k];
+    re = sx->c*sy->c - sx->s*sy->s;
+    im = sx->c*sy->s + sx->s*sy->c;
+    b  = q*pme_sfac(k);
+    sumc[k] += b*(re*sz->c - im*sz->s);
+    sums[k] += b*(re*sz->s + im*sz->c);
+  }
+}
+#endif
+
+double EWALD_energy_change(int n, ChargeChange *c)
+{
+  int j, k, mesh = EWALD_use_mesh();
+  double energy = 0.0, dq2 = 0.0;
+  SCCache *cx, *cy, *cz;
+
+  EWALD_TRACE(fprintf(stderr,"%d: EWALD_energy_change, %d changes, cache valid %d\n",this_node,n,sf_valid));
+
+  /* collective, the structure factors are summed over all nodes. The
+     energy change has to be evaluated the same way as the energy. */
+  if (!sf_valid || sf_mesh != mesh) {
+    EWALD_gather_charges();
+#ifdef EWALD_PME
+    if (mesh)
+      EWALD_pme_structure_factors(lq, n_lq);
+    else
+#endif
+      EWALD_structure_factors(lq, n_lq);
+    sf_valid = 1;
+    sf_mesh  = mesh;
+  }
+
+  if (this_node != 0)
+    return 0.0;
+
+  /* change of the structure factors, in the scratch buffers */
+  for (k=0; k<total_kvectors; k++)
+    sums[k] = sumc[k] = 0.0;
+
+  cx = (SCCache *)malloc((5*ewald.kmax + 6)*sizeof(SCCache));
+  cy = cx + ewald.kmax + 2;
+  cz = cy + 2*ewald.kmax + 2;
+  for (j=0; j<n; j++) {
+#ifdef EWALD_PME
+    if (mesh) {
+      if (c[j].old_q != 0.0)
+	EWALD_pme_add_charge_sf(c[j].old_pos, -c[j].old_q, cx, cy, cz);
+      if (c[j].new_q != 0.0)
+	EWALD_pme_add_charge_sf(c[j].new_pos,  c[j].new_q, cx, cy, cz);
+    }
+    else
+#endif
+    {
+      if (c[j].old_q != 0.0)
+	EWALD_add_charge_sf(c[j].old_pos, -c[j].old_q, cx, cy, cz);
+      if (c[j].new_q != 0.0)
+	EWALD_add_charge_sf(c[j].new_pos,  c[j].new_q, cx, cy, cz);
+    }
+    dq2 += SQR(c[j].new_q) - SQR(c[j].old_q);
+  }
+  free(cx);
+
+  for (k=0; k<total_kvectors; k++)
+    energy += 2.0*kvec[k]*(sums[k]*(2.0*totsums[k] + sums[k]) +
+			   sumc[k]*(2.0*totsumc[k] + sumc[k]));
+
+  /* k-space part and change of the self energy */
+  return coulomb.prefactor*(energy - dq2*ewald.alpha*wupii);
+}
+
+void   EWALD_exit()
+{ 
+  /* free memory */
   free(scx);
   free(scy);
   free(scz);
+  free(lq);
+  free(lf);
   free(sums);
   free(sumc);
   free(totsums);
   free(totsumc);
+#ifdef EWALD_PME
+  EWALD_pme_free();
+#endif
 }
 
 /************************************************************/
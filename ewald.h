@@ -41,6 +41,16 @@
 /** This value for ewald.epsilon indicates metallic boundary conditions. */
 #define EWALD_EPSILON_METALLIC 0.0
 
+/** \name Values for \ref ewald_struct::method */
+/*@{*/
+/** choose between the direct sums and the particle mesh by the number of charges */
+#define EWALD_METHOD_AUTO   0
+/** always evaluate the structure factors directly */
+#define EWALD_METHOD_DIRECT 1
+/** always use the smooth particle mesh path */
+#define EWALD_METHOD_PME    2
+/*@}*/
+
 /************************************************
  * data types
  ************************************************/
@@ -61,6 +71,8 @@ typedef struct {
   int kmax;
   /** squared \ref kmax */
   int kmaxsq;
+  /** how the k-space sum is evaluated, one of the EWALD_METHOD_* values. */
+  int method;
 } ewald_struct;
 
 /** \name Exported Variables */
@@ -91,7 +103,7 @@ int EWALD_sanity_checks();
 void EWALD_init();
 
 /** Calculate number of charged particles, the sum of the squared
-    charges and the squared sum of the charges. */
+    charges and the squared sum of the charges on all nodes. */
 void EWALD_count_charged_particles();
 
 /** Reallocate memory for k-space caches */
@@ -100,7 +112,13 @@ void EWALD_on_resort_particles();
 /** Updates \ref ewald_struct::alpha and \ref ewald_struct::r_cut if \ref box_l changed. */
 void EWALD_scaleby_box_l();
 
-/** Calculate the k-space contribution to the coulomb interaction forces. */ 
+/** Calculate the k-space contribution to the coulomb interaction forces
+    and/or energy. Depending on \ref ewald_struct::method, the structure
+    factors are either summed directly or obtained from a smooth
+    particle mesh (B-spline charge assignment and FFT), which uses the
+    same k-vectors and prefactors. In automatic mode, the mesh is used
+    above the number of charges per node measured by \ref EWALD_init.
+    Returns the k-space energy on the master node. */
 double EWALD_calc_kspace_forces(int force_flag, int energy_flag);
 
 /** Calculate real space contribution of coulomb pair forces.
@@ -136,8 +154,9 @@ MDINLINE double add_ewald_coulomb_pair_force(Particle *p1, Particle *p2,
   return 0.0;
 }
 
-/** Calculate real space contribution of coulomb pair energy. */
-MDINLINE double ewald_coulomb_pair_energy(Particle *p1, Particle *p2,
+/** Calculate real space contribution of coulomb pair energy.
+    @param chgfac product of the two charges */
+MDINLINE double ewald_coulomb_pair_energy(double chgfac,
 				     double *d,double dist2,double dist)
 {
   double adist, erfc_part_ri;
@@ -146,17 +165,30 @@ MDINLINE double ewald_coulomb_pair_energy(Particle *p1, Particle *p2,
     adist = ewald.alpha * dist;
 #if USE_ERFC_APPROXIMATION
     erfc_part_ri = AS_erfc_part(adist) / dist;
-    return coulomb.prefactor*p1->p.q*p2->p.q *erfc_part_ri*exp(-adist*adist);
+    return coulomb.prefactor*chgfac*erfc_part_ri*exp(-adist*adist);
 #else
     erfc_part_ri = erfc(adist) / dist;
-    return coulomb.prefactor*p1->p.q*p2->p.q *erfc_part_ri;
+    return coulomb.prefactor*chgfac*erfc_part_ri;
 #endif
   }
   return 0.0;
 }
 
+/** Change of the k-space energy, including the self energy, if the
+    charges are changed as given. The structure factors of the current
+    configuration are cached, so that the cost is proportional to the
+    number of changes times the number of k-vectors. Has to be called
+    on all nodes, the result is only valid on the master node.
+    @param n number of changes
+    @param c the changes, see \ref ChargeChange */
+double EWALD_energy_change(int n, ChargeChange *c);
+
+/** mark the cached structure factors as outdated. Called whenever
+    particles move or their charges change. */
+void EWALD_invalidate_structure_factors();
+
 /** Clean up Ewald memory allocations. */
-void   Ewald_exit();
+void   EWALD_exit();
 
 /*@}*/
 #endif
@@ -20,22 +20,53 @@
 #include <string.h> 
 #include <math.h>
 #include "utils.h"
+#include "communication.h"
+#include "fft.h"
+
+int fft_use_alltoall = 1;
+
+int fft_alltoall_callback(Tcl_Interp *interp, void *_data)
+{
+  int data = *(int *)_data;
+  if (data != 0 && data != 1) {
+    Tcl_AppendResult(interp, "fft_alltoall must be 0 or 1", (char *) NULL);
+    return (TCL_ERROR);
+  }
+  fft_use_alltoall = data;
+  mpi_bcast_parameter(FIELD_FFTALLTOALL);
+  return (TCL_OK);
+}
+
+int fft_kspace_nodes = 0;
+
+int fft_nodes_callback(Tcl_Interp *interp, void *_data)
+{
+  int data = *(int *)_data;
+  if (data < 0 || data > n_nodes) {
+    Tcl_AppendResult(interp, "fft_nodes must be between 0 and the number of nodes", (char *) NULL);
+    return (TCL_ERROR);
+  }
+  fft_kspace_nodes = data;
+  mpi_bcast_parameter(FIELD_FFTNODES);
+  return (TCL_OK);
+}
 
 #ifdef ELP3M
 
 #if FFTW == 3
 #  include <fftw3.h>
+#  if defined(_OPENMP) && defined(FFTW_THREADS)
+#    include <omp.h>
+#  endif
 #else
 #  include <fftw.h>
 #  include <rfftw.h>
 #endif
 
-#include "communication.h"
 #include "grid.h"
 #ifdef NPT
 #include "pressure.h"
 #endif
-#include "fft.h"
 #include "p3m.h"
 
 /************************************************
@@ -49,61 +80,106 @@
 #define REQ_FFT_FORW   301
 /** Tag for communication in back_grid_comm() */
 #define REQ_FFT_BACK   302
+/** Nonblocking collectives are only available from MPI-3 on. Without
+    them, the all-to-all redistributions cannot overlap with packing. */
+#if defined(MPI_VERSION) && (MPI_VERSION >= 3)
+#define FFT_ASYNC_ALLTOALL
+#endif
 #if FFTW == 3
 /* Tag for wisdom file I/O */
 #  define FFTW_FAILURE 0
 #endif
 
+/************************************************
+ * data types
+ ************************************************/
+
+/** Plans, buffers and sizes of one distributed 3D-FFT. There is one
+    for the charge mesh and one for the dipolar mesh, the routines
+    below work on either of them. */
+typedef struct {
+  /** forward plans, \ref fft_plan or \ref Dfft_plan. */
+  fft_forw_plan *plan;
+  /** Information for Back FFTs (see plan). */
+  fft_back_plan *back;
+  /** prefix of the FFTW wisdom file names. */
+  char *wisdom_prefix;
+  /** whether the plans have been set up before. */
+  int init_tag;
+
+  /** Number of nodes performing the FFT, see \ref fft_kspace_nodes. */
+  int n_fft_nodes;
+  /** Whether this node performs the FFT. */
+  int kspace_member;
+  /** direction halved by the real to complex FFT, see \ref fft_ks_half_dim. */
+  int ks_half_dim;
+
+  /** Maximal size of the communication buffers. */
+  int max_comm_size;
+  /** Size of the communication buffers, which might be enlarged for
+      batched transforms. */
+  int max_batch_comm_size;
+  /** Maximal local mesh size. */
+  int max_mesh_size;
+  /** send buffer. */
+  double *send_buf;
+  /** receive buffer. */
+  double *recv_buf;
+  /** Buffer for receive data. */
+  double *data_buf;
+  /** Additional scratch meshes for batched transforms. */
+  double *batch_buf;
+  /** Number of meshes batch_buf is allocated for, including data_buf. */
+  int max_batch;
+
+  /** Maximal size of all blocks a node sends or receives in one
+      redistribution, see \ref alltoall_grid_comm. */
+  int max_a2a_size;
+  /** Size the all-to-all buffers are allocated for. */
+  int a2a_buf_size;
+  /** send and receive buffers of the all-to-all redistributions. Each
+      holds two slots of max_a2a_size, one for the mesh in transit
+      and one for the mesh that is packed or unpacked meanwhile. */
+  double *a2a_send_buf;
+  double *a2a_recv_buf;
+} fft_data;
 
 /************************************************
  * variables
  ************************************************/
 
 #ifdef ELECTROSTATICS
-int fft_init_tag=0;
-
 fft_forw_plan fft_plan[4];
 
 /** Information for Back FFTs (see fft_plan). */
 fft_back_plan fft_back[4];
 
-/** Maximal size of the communication buffers. */
-static int max_comm_size=0;
-/** Maximal local mesh size. */
-static int max_mesh_size=0;
-/** send buffer. */
-static double *send_buf = NULL;
-/** receive buffer. */
-static double *recv_buf = NULL;
-/** Buffer for receive data. */
-static double *data_buf = NULL;
-/** Complex data pointers. */
-static fftw_complex *c_data;
-static fftw_complex *c_data_buf;
+int fft_ks_half_dim = 0;
 
+/** The FFT of the charge mesh. */
+static fft_data fft_charges = { fft_plan, fft_back, "" };
 #endif
 
 #ifdef MAGNETOSTATICS
-int Dfft_init_tag=0;
-
 fft_forw_plan Dfft_plan[4];
 
-/** Information for Back FFTs (see fft_plan). */
+/** Information for Back FFTs (see Dfft_plan). */
 fft_back_plan Dfft_back[4];
 
-static int Dmax_comm_size=0;
-/** Maximal local mesh size. */
-static int Dmax_mesh_size=0;
-/** send buffer. */
-static double *Dsend_buf = NULL;
-/** receive buffer. */
-static double *Drecv_buf = NULL;
-/** Buffer for receive data. */
-static double *Ddata_buf = NULL;
-/** Complex data pointers. */
-static fftw_complex *Dc_data;
-static fftw_complex *Dc_data_buf;
+int Dfft_ks_half_dim = 0;
+
+/** The FFT of the dipolar meshes. */
+static fft_data fft_dipoles = { Dfft_plan, Dfft_back, "D" };
+#endif
+
+/** counts and displacements of the all-to-all redistributions, by rank
+    in the group communicator. */
+static int *a2a_send_count = NULL, *a2a_send_displ = NULL;
+static int *a2a_recv_count = NULL, *a2a_recv_displ = NULL;
 
+#if FFTW == 3 && defined(_OPENMP) && defined(FFTW_THREADS)
+/** whether fftw_init_threads has already been called. */
+static int fftw_threads_initialized = 0;
 #endif
 
 
@@ -134,7 +210,7 @@ static fftw_complex *Dc_data_buf;
  * \param pos        positions of the nodes in in grid2 (Output).
  * \param my_pos      position of this_node in  grid2.
  * \return Size of the communication group (Output of course!).  */
-int find_comm_groups(int grid1[3], int grid2[3], int *node_list1, int *node_list2, 
+int find_comm_groups(int grid1[3], int grid2[3], int *node_list1, int *node_list2,
 		     int *group, int *pos, int *my_pos);
 
 
@@ -151,7 +227,7 @@ int find_comm_groups(int grid1[3], int grid2[3], int *node_list1, int *node_list
  * \param  loc_mesh local mesh dimension (output).
  * \param  start    first point of local mesh in global mesh (output).
 */
-int calc_local_mesh(int n_pos[3], int n_grid[3], int mesh[3], double mesh_off[3], 
+int calc_local_mesh(int n_pos[3], int n_grid[3], int mesh[3], double mesh_off[3],
 		     int loc_mesh[3], int start[3]);
 
 /** Calculate a send (or recv.) block for grid communication during a
@@ -178,45 +254,90 @@ int calc_local_mesh(int n_pos[3], int n_grid[3], int mesh[3], double mesh_off[3]
  *  \param  mesh_off global mesh offset (see \ref p3m_struct).
  *  \param  block    send block specification.
 */
-int calc_send_block(int pos1[3], int grid1[3], int pos2[3], int grid2[3], 
+int calc_send_block(int pos1[3], int grid1[3], int pos2[3], int grid2[3],
 		    int mesh[3], double mesh_off[3], int block[6]);
 
-#ifdef  ELECTROSTATICS
-/** communicate the grid data according to the given fft_forw_plan. 
- * \param plan communication plan (see \ref fft_forw_plan).
- * \param in   input mesh.
- * \param out  output mesh.
-*/
-void forw_grid_comm(fft_forw_plan plan, double *in, double *out);
+/** set a block specification to an empty block.
+ *  \return 0, the size of the block.
+ *  \param block block specification.
+ */
+static int empty_block(int block[6]);
+
+/** Initialize the plans and buffers of a 3D-FFT, see \ref fft_init.
+ * \return Maximal size of local fft mesh.
+ * \param fft            the FFT to set up.
+ * \param data           Pointer Pounter to data array.
+ * \param ca_mesh_dim    Pointer to CA mesh dimensions.
+ * \param ca_mesh_margin Pointer to CA mesh margins.
+ * \param global_mesh    global mesh dimensions.
+ * \param mesh_off       global mesh offset.
+ * \param ks_pnum        Pointer to number of permutations in k-space.
+ */
+static int fft_init_data(fft_data *fft, double **data, int *ca_mesh_dim, int *ca_mesh_margin,
+			 int *global_mesh, double *mesh_off, int *ks_pnum);
 
-/** communicate the grid data according to the given fft_forw_plan/fft_bakc_plan. 
- * \param plan_f communication plan (see \ref fft_forw_plan).
- * \param plan_b additional back plan (see \ref fft_back_plan).
- * \param in     input mesh.
- * \param out    output mesh.
-*/
-void back_grid_comm(fft_forw_plan plan_f, fft_back_plan plan_b, double *in, double *out);
-#endif
+/** perform the forward 3D FFT of several meshes, see \ref fft_perform_forw.
+ * \param fft    the FFT to use.
+ * \param data   meshes.
+ * \param n_mesh number of meshes, at most \ref FFT_MAX_BATCH.
+ */
+static void fft_perform_forw_data(fft_data *fft, double **data, int n_mesh);
 
-#ifdef  MAGNETOSTATICS
-/** communicate the grid data according to the given fft_forw_plan. 
- * \param plan communication plan (see \ref fft_forw_plan).
- * \param in   input mesh.
- * \param out  output mesh.
+/** perform the backward 3D FFT of several meshes, see \ref fft_perform_back_batch.
+ * \param fft    the FFT to use.
+ * \param data   meshes.
+ * \param n_mesh number of meshes, at most \ref FFT_MAX_BATCH.
+ */
+static void fft_perform_back_data(fft_data *fft, double **data, int n_mesh);
+
+/** communicate the grid data according to the given fft_forw_plan.
+ *  All meshes are transferred together, i.e. with one message per node of the
+ *  communication group.
+ * \param fft    the FFT the plan belongs to.
+ * \param plan   communication plan (see \ref fft_forw_plan).
+ * \param in     input meshes.
+ * \param out    output meshes.
+ * \param n_mesh number of meshes.
 */
-void Dforw_grid_comm(fft_forw_plan plan, double *in, double *out);
+static void forw_grid_comm(fft_data *fft, fft_forw_plan *plan, double **in, double **out, int n_mesh);
 
-/** communicate the grid data according to the given fft_forw_plan/fft_bakc_plan. 
+/** communicate the grid data according to the given fft_forw_plan/fft_bakc_plan.
+ *  All meshes are transferred together, i.e. with one message per node of the
+ *  communication group.
+ * \param fft    the FFT the plans belong to.
  * \param plan_f communication plan (see \ref fft_forw_plan).
  * \param plan_b additional back plan (see \ref fft_back_plan).
- * \param in     input mesh.
- * \param out    output mesh.
+ * \param in     input meshes.
+ * \param out    output meshes.
+ * \param n_mesh number of meshes.
 */
-void Dback_grid_comm(fft_forw_plan plan_f, fft_back_plan plan_b, double *in, double *out);
-#endif
-
+static void back_grid_comm(fft_data *fft, fft_forw_plan *plan_f, fft_back_plan *plan_b,
+			   double **in, double **out, int n_mesh);
+
+/** redistribute the grid data with one MPI_Alltoallv per mesh in the
+ *  communicator of the communication group. Packing and unpacking of
+ *  one mesh, and the copy of the node's own block, overlap with the
+ *  exchange of the neighbouring mesh. For the back direction, the send
+ *  and receive blocks of the forward plan are given swapped.
+ * \param fft      the FFT the plan belongs to.
+ * \param plan     communication plan (see \ref fft_forw_plan).
+ * \param pack     packing function.
+ * \param s_block  send block specifications.
+ * \param s_size   send block sizes.
+ * \param s_mesh   local mesh before the communication.
+ * \param r_block  receive block specifications.
+ * \param r_size   receive block sizes.
+ * \param r_mesh   local mesh after the communication.
+ * \param in       input meshes.
+ * \param out      output meshes.
+ * \param n_mesh   number of meshes.
+*/
+static void alltoall_grid_comm(fft_data *fft, fft_forw_plan *plan, void (*pack)(),
+			       int *s_block, int *s_size, int *s_mesh,
+			       int *r_block, int *r_size, int *r_mesh,
+			       double **in, double **out, int n_mesh);
 
-/** Debug function to print fft_forw_plan structure. 
+/** Debug function to print fft_forw_plan structure.
  * \param pl fft/communication plan (see \ref fft_forw_plan).
  */
 void print_fft_plan(fft_forw_plan pl);
@@ -224,46 +345,55 @@ void print_fft_plan(fft_forw_plan pl);
 /*@}*/
 /************************************************************/
 
-void fft_pre_init()
+/** allocate the node lists of the plans of a 3D-FFT. */
+static void fft_pre_init_plans(fft_forw_plan *plan)
 {
- 
- #if defined(ELECTROSTATICS) || defined(MAGNETOSTATICS)
   int i;
- #endif
-
-  #ifdef ELECTROSTATICS
-  for(i=0;i<4;i++) {
-    fft_plan[i].group = malloc(1*n_nodes*sizeof(int));
-    fft_plan[i].send_block = NULL;
-    fft_plan[i].send_size  = NULL;
-    fft_plan[i].recv_block = NULL;
-    fft_plan[i].recv_size  = NULL;
-  }
-  #endif 
-  
-  #ifdef MAGNETOSTATICS
   for(i=0;i<4;i++) {
-    Dfft_plan[i].group = malloc(1*n_nodes*sizeof(int));
-    Dfft_plan[i].send_block = NULL;
-    Dfft_plan[i].send_size  = NULL;
-    Dfft_plan[i].recv_block = NULL;
-    Dfft_plan[i].recv_size  = NULL;
+    plan[i].group = malloc(1*n_nodes*sizeof(int));
+    plan[i].comm_rank = malloc(1*n_nodes*sizeof(int));
+    plan[i].send_block = NULL;
+    plan[i].send_size  = NULL;
+    plan[i].recv_block = NULL;
+    plan[i].recv_size  = NULL;
   }
-  #endif
-
 }
 
+void fft_pre_init()
+{
 #ifdef ELECTROSTATICS
-int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin, int *ks_pnum)
+  fft_pre_init_plans(fft_plan);
+#endif
+#ifdef MAGNETOSTATICS
+  fft_pre_init_plans(Dfft_plan);
+#endif
+  a2a_send_count = malloc(1*n_nodes*sizeof(int));
+  a2a_send_displ = malloc(1*n_nodes*sizeof(int));
+  a2a_recv_count = malloc(1*n_nodes*sizeof(int));
+  a2a_recv_displ = malloc(1*n_nodes*sizeof(int));
+}
+
+static int fft_init_data(fft_data *fft, double **data, int *ca_mesh_dim, int *ca_mesh_margin,
+			 int *global_mesh, double *mesh_off, int *ks_pnum)
 {
   int i,j;
   /* helpers */
   int mult[3];
+  fft_forw_plan *plan = fft->plan;
+  fft_back_plan *back = fft->back;
 
   int n_grid[4][3]; /* The four node grids. */
   int my_pos[4][3]; /* The position of this_node in the node grids. */
   int *n_id[4];     /* linear node identity lists for the node grids. */
   int *n_pos[4];    /* positions of nodes in the node grids. */
+  int ks_mesh[3];   /* global mesh after the first (real to complex) FFT. */
+  int *mesh;        /* global mesh of the current plan. */
+  int dims[3];
+  int n_send, n_recv, color; /* all-to-all setup */
+  fftw_complex *c_data;
+#if FFTW != 3
+  fftw_complex *c_data_buf;
+#endif
   /* FFTW WISDOM stuff. */
   char wisdom_file_name[255];
   FILE *wisdom_file;
@@ -273,10 +403,10 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin, int *ks_pnum)
   fftw_status wisdom_status;
 #endif
 
-  FFT_TRACE(fprintf(stderr,"%d: fft_init():\n",this_node));
+  FFT_TRACE(fprintf(stderr,"%d: fft_init(%s):\n",this_node,fft->wisdom_prefix));
 
 
-  max_comm_size=0; max_mesh_size=0;
+  fft->max_comm_size=0; fft->max_mesh_size=0; fft->max_a2a_size=0;
   for(i=0;i<4;i++) {
     n_id[i]  = malloc(1*n_nodes*sizeof(int));
     n_pos[i] = malloc(3*n_nodes*sizeof(int));
@@ -293,757 +423,569 @@ int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin, int *ks_pnum)
     get_grid_pos(i,&(n_pos[0][3*i+0]),&(n_pos[0][3*i+1]),&(n_pos[0][3*i+2]),
 		 n_grid[0]);
   }
-    
+
   /* FFT node grids (n_grid[1 - 3]) */
-  calc_2d_grid(n_nodes,n_grid[1]);
-  /* resort n_grid[1] dimensions if necessary */
-  fft_plan[1].row_dir = map_3don2d_grid(n_grid[0], n_grid[1], mult);
-  fft_plan[0].n_permute = 0;
-  for(i=1;i<4;i++) fft_plan[i].n_permute = (fft_plan[1].row_dir+i)%3;
+  fft->n_fft_nodes = (fft_kspace_nodes > 0) ? imin(fft_kspace_nodes, n_nodes) : n_nodes;
+  fft->kspace_member = (this_node < fft->n_fft_nodes);
+  calc_2d_grid(fft->n_fft_nodes,n_grid[1]);
+  if(fft->n_fft_nodes == n_nodes) {
+    /* resort n_grid[1] dimensions if necessary */
+    plan[1].row_dir = map_3don2d_grid(n_grid[0], n_grid[1], mult);
+  }
+  else {
+    /* the grid of the k-space nodes is unrelated to the real space
+       node grid, the first redistribution involves all nodes */
+    plan[1].row_dir = 2;
+    for(i=0;i<fft->n_fft_nodes;i++) {
+      n_id[1][i] = i;
+      get_grid_pos(i,&(n_pos[1][3*i+0]),&(n_pos[1][3*i+1]),&(n_pos[1][3*i+2]),
+		   n_grid[1]);
+    }
+    if(fft->kspace_member)
+      for(i=0;i<3;i++) my_pos[1][i] = n_pos[1][3*this_node+i];
+  }
+  plan[0].n_permute = 0;
+  for(i=1;i<4;i++) plan[i].n_permute = (plan[1].row_dir+i)%3;
   for(i=0;i<3;i++) {
     n_grid[2][i] = n_grid[1][(i+1)%3];
     n_grid[3][i] = n_grid[1][(i+2)%3];
   }
-  fft_plan[2].row_dir = (fft_plan[1].row_dir-1)%3;
-  fft_plan[3].row_dir = (fft_plan[1].row_dir-2)%3;
+  plan[2].row_dir = (plan[1].row_dir-1)%3;
+  plan[3].row_dir = (plan[1].row_dir-2)%3;
 
+  /* the mesh is real, so after the first FFT only the
+     non-negative frequencies of its row direction are kept */
+  for(i=0;i<3;i++) ks_mesh[i] = global_mesh[i];
+  ks_mesh[plan[1].row_dir] = global_mesh[plan[1].row_dir]/2 + 1;
 
 
   /* === communication groups === */
   /* copy local mesh off real space charge assignment grid */
-  for(i=0;i<3;i++) fft_plan[0].new_mesh[i] = ca_mesh_dim[i];
+  for(i=0;i<3;i++) plan[0].new_mesh[i] = ca_mesh_dim[i];
   for(i=1; i<4;i++) {
-    fft_plan[i].g_size=find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i], 
-					fft_plan[i].group, n_pos[i], my_pos[i]);
-    if(fft_plan[i].g_size==-1) {
+    mesh = (i == 1) ? global_mesh : ks_mesh;
+    if(i == 1 && fft->n_fft_nodes < n_nodes) {
+      /* every node may send to every k-space node */
+      plan[i].g_size = n_nodes;
+      for(j=0; j<n_nodes; j++) plan[i].group[j] = j;
+    }
+    else if(!fft->kspace_member)
+      plan[i].g_size = 0;
+    else
+      plan[i].g_size=find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i],
+				      plan[i].group, n_pos[i], my_pos[i]);
+    if(plan[i].g_size==-1) {
       /* try permutation */
-      j = n_grid[i][(fft_plan[i].row_dir+1)%3];
-      n_grid[i][(fft_plan[i].row_dir+1)%3] = n_grid[i][(fft_plan[i].row_dir+2)%3];
-      n_grid[i][(fft_plan[i].row_dir+2)%3] = j;
-      fft_plan[i].g_size=find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i], 
-					  fft_plan[i].group, n_pos[i], my_pos[i]);
-      if(fft_plan[i].g_size==-1) {
+      j = n_grid[i][(plan[i].row_dir+1)%3];
+      n_grid[i][(plan[i].row_dir+1)%3] = n_grid[i][(plan[i].row_dir+2)%3];
+      n_grid[i][(plan[i].row_dir+2)%3] = j;
+      plan[i].g_size=find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i],
+				      plan[i].group, n_pos[i], my_pos[i]);
+      if(plan[i].g_size==-1) {
 	fprintf(stderr,"%d: INTERNAL ERROR: find_comm_groups error\n", this_node);
 	errexit();
       }
     }
 
-    fft_plan[i].send_block = (int *)realloc(fft_plan[i].send_block, 6*fft_plan[i].g_size*sizeof(int));
-    fft_plan[i].send_size  = (int *)realloc(fft_plan[i].send_size, 1*fft_plan[i].g_size*sizeof(int));
-    fft_plan[i].recv_block = (int *)realloc(fft_plan[i].recv_block, 6*fft_plan[i].g_size*sizeof(int));
-    fft_plan[i].recv_size  = (int *)realloc(fft_plan[i].recv_size, 1*fft_plan[i].g_size*sizeof(int));
+    plan[i].send_block = (int *)realloc(plan[i].send_block, 6*plan[i].g_size*sizeof(int));
+    plan[i].send_size  = (int *)realloc(plan[i].send_size, 1*plan[i].g_size*sizeof(int));
+    plan[i].recv_block = (int *)realloc(plan[i].recv_block, 6*plan[i].g_size*sizeof(int));
+    plan[i].recv_size  = (int *)realloc(plan[i].recv_size, 1*plan[i].g_size*sizeof(int));
 
-    fft_plan[i].new_size = calc_local_mesh(my_pos[i], n_grid[i], p3m.mesh,
-					   p3m.mesh_off, fft_plan[i].new_mesh, 
-					   fft_plan[i].start);  
-    permute_ifield(fft_plan[i].new_mesh,3,-(fft_plan[i].n_permute));
-    permute_ifield(fft_plan[i].start,3,-(fft_plan[i].n_permute));
-    fft_plan[i].n_ffts = fft_plan[i].new_mesh[0]*fft_plan[i].new_mesh[1];
+    if(fft->kspace_member)
+      plan[i].new_size = calc_local_mesh(my_pos[i], n_grid[i], mesh,
+					 mesh_off, plan[i].new_mesh,
+					 plan[i].start);
+    else {
+      plan[i].new_size = 0;
+      for(j=0;j<3;j++) plan[i].new_mesh[j] = plan[i].start[j] = 0;
+    }
+    permute_ifield(plan[i].new_mesh,3,-(plan[i].n_permute));
+    permute_ifield(plan[i].start,3,-(plan[i].n_permute));
+    plan[i].n_ffts = plan[i].new_mesh[0]*plan[i].new_mesh[1];
 
     /* === send/recv block specifications === */
-    for(j=0; j<fft_plan[i].g_size; j++) {
+    for(j=0; j<plan[i].g_size; j++) {
       int k, node;
       /* send block: this_node to comm-group-node i (identity: node) */
-      node = fft_plan[i].group[j];
-      fft_plan[i].send_size[j] 
-	= calc_send_block(my_pos[i-1], n_grid[i-1], &(n_pos[i][3*node]), n_grid[i],
-			  p3m.mesh, p3m.mesh_off, &(fft_plan[i].send_block[6*j]));
-      permute_ifield(&(fft_plan[i].send_block[6*j]),3,-(fft_plan[i-1].n_permute));
-      permute_ifield(&(fft_plan[i].send_block[6*j+3]),3,-(fft_plan[i-1].n_permute));
-      if(fft_plan[i].send_size[j] > max_comm_size) 
-	max_comm_size = fft_plan[i].send_size[j];
+      node = plan[i].group[j];
+      if(node < fft->n_fft_nodes)
+	plan[i].send_size[j]
+	  = calc_send_block(my_pos[i-1], n_grid[i-1], &(n_pos[i][3*node]), n_grid[i],
+			    mesh, mesh_off, &(plan[i].send_block[6*j]));
+      else
+	plan[i].send_size[j] = empty_block(&(plan[i].send_block[6*j]));
+      permute_ifield(&(plan[i].send_block[6*j]),3,-(plan[i-1].n_permute));
+      permute_ifield(&(plan[i].send_block[6*j+3]),3,-(plan[i-1].n_permute));
+      if(plan[i].send_size[j] > fft->max_comm_size)
+	fft->max_comm_size = plan[i].send_size[j];
       /* First plan send blocks have to be adjusted, since the CA grid
 	 may have an additional margin outside the actual domain of the
 	 node */
       if(i==1) {
-	for(k=0;k<3;k++) 
-	  fft_plan[1].send_block[6*j+k  ] += ca_mesh_margin[2*k];
+	for(k=0;k<3;k++)
+	  plan[1].send_block[6*j+k  ] += ca_mesh_margin[2*k];
       }
       /* recv block: this_node from comm-group-node i (identity: node) */
-      fft_plan[i].recv_size[j] 
-	= calc_send_block(my_pos[i], n_grid[i], &(n_pos[i-1][3*node]), n_grid[i-1],
-			  p3m.mesh,p3m.mesh_off,&(fft_plan[i].recv_block[6*j]));
-      permute_ifield(&(fft_plan[i].recv_block[6*j]),3,-(fft_plan[i].n_permute));
-      permute_ifield(&(fft_plan[i].recv_block[6*j+3]),3,-(fft_plan[i].n_permute));
-      if(fft_plan[i].recv_size[j] > max_comm_size) 
-	max_comm_size = fft_plan[i].recv_size[j];
+      if(fft->kspace_member)
+	plan[i].recv_size[j]
+	  = calc_send_block(my_pos[i], n_grid[i], &(n_pos[i-1][3*node]), n_grid[i-1],
+			    mesh,mesh_off,&(plan[i].recv_block[6*j]));
+      else
+	plan[i].recv_size[j] = empty_block(&(plan[i].recv_block[6*j]));
+      permute_ifield(&(plan[i].recv_block[6*j]),3,-(plan[i].n_permute));
+      permute_ifield(&(plan[i].recv_block[6*j+3]),3,-(plan[i].n_permute));
+      if(plan[i].recv_size[j] > fft->max_comm_size)
+	fft->max_comm_size = plan[i].recv_size[j];
     }
 
-    for(j=0;j<3;j++) fft_plan[i].old_mesh[j] = fft_plan[i-1].new_mesh[j];
-    if(i==1) 
-      fft_plan[i].element = 1; 
+    for(j=0;j<3;j++) plan[i].old_mesh[j] = plan[i-1].new_mesh[j];
+    /* the rows of the first FFT are shortened by the real to complex FFT */
+    if(i==2) plan[i].old_mesh[2] = plan[1].new_mesh[2]/2 + 1;
+    if(i==1)
+      plan[i].element = 1;
     else {
-      fft_plan[i].element = 2;
-      for(j=0; j<fft_plan[i].g_size; j++) {
-	fft_plan[i].send_size[j] *= 2;
-	fft_plan[i].recv_size[j] *= 2;
+      plan[i].element = 2;
+      for(j=0; j<plan[i].g_size; j++) {
+	plan[i].send_size[j] *= 2;
+	plan[i].recv_size[j] *= 2;
       }
     }
+
+    /* === all-to-all communicator and buffer size === */
+    n_send = n_recv = 0;
+    color  = n_nodes;
+    for(j=0; j<plan[i].g_size; j++) {
+      int k;
+      n_send += plan[i].send_size[j];
+      n_recv += plan[i].recv_size[j];
+      if(plan[i].group[j] < color) color = plan[i].group[j];
+      /* the communicator ranks follow the node identities */
+      plan[i].comm_rank[j] = 0;
+      for(k=0; k<plan[i].g_size; k++)
+	if(plan[i].group[k] < plan[i].group[j]) plan[i].comm_rank[j]++;
+    }
+    if(n_send > fft->max_a2a_size) fft->max_a2a_size = n_send;
+    if(n_recv > fft->max_a2a_size) fft->max_a2a_size = n_recv;
+    if(fft->init_tag==1) MPI_Comm_free(&plan[i].comm);
+    MPI_Comm_split(MPI_COMM_WORLD, color, this_node, &plan[i].comm);
+
     /* DEBUG */
     for(j=0;j<n_nodes;j++) {
       /* MPI_Barrier(MPI_COMM_WORLD); */
-      if(j==this_node) FFT_TRACE(print_fft_plan(fft_plan[i]));
+      if(j==this_node) FFT_TRACE(print_fft_plan(plan[i]));
     }
   }
 
+  /* position of the halved direction in the k-space mesh */
+  for(i=0;i<3;i++) dims[i] = i;
+  permute_ifield(dims,3,-(plan[3].n_permute));
+  for(i=0;i<3;i++)
+    if(dims[i] == plan[1].row_dir) fft->ks_half_dim = i;
+
   /* Factor 2 for complex fields */
-  max_comm_size *= 2;
-  max_mesh_size = (ca_mesh_dim[0]*ca_mesh_dim[1]*ca_mesh_dim[2]);
-  for(i=1;i<4;i++) 
-    if(2*fft_plan[i].new_size > max_mesh_size) max_mesh_size = 2*fft_plan[i].new_size;
+  fft->max_comm_size *= 2;
+  fft->max_mesh_size = (ca_mesh_dim[0]*ca_mesh_dim[1]*ca_mesh_dim[2]);
+#if FFTW == 3
+  /* real input and half complex output of the first FFT */
+  if(plan[1].new_size > fft->max_mesh_size) fft->max_mesh_size = plan[1].new_size;
+  if(2*plan[1].n_ffts*(plan[1].new_mesh[2]/2 + 1) > fft->max_mesh_size)
+    fft->max_mesh_size = 2*plan[1].n_ffts*(plan[1].new_mesh[2]/2 + 1);
+#else
+  /* the first FFT is done as full complex FFT, see fft_perform_forw */
+  if(2*plan[1].new_size > fft->max_mesh_size) fft->max_mesh_size = 2*plan[1].new_size;
+#endif
+  for(i=2;i<4;i++)
+    if(2*plan[i].new_size > fft->max_mesh_size) fft->max_mesh_size = 2*plan[i].new_size;
+  /* the scratch meshes of a batch are stored back to back, pad them
+     to keep the alignment the FFTW plans were created with */
+  fft->max_mesh_size = (fft->max_mesh_size + 3) & ~3;
 
   FFT_TRACE(fprintf(stderr,"%d: max_comm_size = %d, max_mesh_size = %d\n",
-		    this_node,max_comm_size,max_mesh_size));
+		    this_node,fft->max_comm_size,fft->max_mesh_size));
 
   /* === pack function === */
   for(i=1;i<4;i++) {
-    fft_plan[i].pack_function = pack_block_permute2; 
+    plan[i].pack_function = pack_block_permute2;
     FFT_TRACE(fprintf(stderr,"%d: forw plan[%d] permute 2 \n",this_node,i));
   }
   (*ks_pnum)=6;
-  if(fft_plan[1].row_dir==2) {
-    fft_plan[1].pack_function = pack_block;
+  if(plan[1].row_dir==2) {
+    plan[1].pack_function = pack_block;
     FFT_TRACE(fprintf(stderr,"%d: forw plan[%d] permute 0 \n",this_node,1));
     (*ks_pnum)=4;
   }
-  else if(fft_plan[1].row_dir==1) {
-    fft_plan[1].pack_function = pack_block_permute1;
+  else if(plan[1].row_dir==1) {
+    plan[1].pack_function = pack_block_permute1;
     FFT_TRACE(fprintf(stderr,"%d: forw plan[%d] permute 1 \n",this_node,1));
     (*ks_pnum)=5;
   }
-  
+
   /* Factor 2 for complex numbers */
-  send_buf = (double *)realloc(send_buf, max_comm_size*sizeof(double));
-  recv_buf = (double *)realloc(recv_buf, max_comm_size*sizeof(double));
-  (*data)  = (double *)realloc((*data), max_mesh_size*sizeof(double));
-  data_buf = (double *)realloc(data_buf, max_mesh_size*sizeof(double));
-  if(!(*data) || !data_buf || !recv_buf || !send_buf) {
+  fft->max_batch_comm_size = fft->max_comm_size;
+  fft->send_buf = (double *)realloc(fft->send_buf, fft->max_comm_size*sizeof(double));
+  fft->recv_buf = (double *)realloc(fft->recv_buf, fft->max_comm_size*sizeof(double));
+  (*data)  = (double *)realloc((*data), fft->max_mesh_size*sizeof(double));
+  fft->data_buf = (double *)realloc(fft->data_buf, fft->max_mesh_size*sizeof(double));
+  if(fft->max_batch > 1)
+    fft->batch_buf = (double *)realloc(fft->batch_buf, (fft->max_batch-1)*fft->max_mesh_size*sizeof(double));
+  if(!(*data) || !fft->data_buf || !fft->recv_buf || !fft->send_buf) {
     fprintf(stderr,"%d: Could not allocate FFT data arays\n",this_node);
     errexit();
   }
 
   c_data     = (fftw_complex *) (*data);
-  c_data_buf = (fftw_complex *) data_buf;
+#if FFTW != 3
+  c_data_buf = (fftw_complex *) fft->data_buf;
+#endif
+
+#if FFTW == 3 && defined(_OPENMP) && defined(FFTW_THREADS)
+  /* let FFTW split the 1D transforms of a plan over the OpenMP threads */
+  if(!fftw_threads_initialized) {
+    fftw_init_threads();
+    fftw_threads_initialized = 1;
+  }
+  fftw_plan_with_nthreads(omp_get_max_threads());
+#endif
 
   /* === FFT Routines (Using FFTW / RFFTW package)=== */
   for(i=1;i<4;i++) {
-    fft_plan[i].dir = FFTW_FORWARD;   
-    /* FFT plan creation. 
+    plan[i].dir = FFTW_FORWARD;
+    if(plan[i].fft_plan) fftw_destroy_plan(plan[i].fft_plan);
+    plan[i].fft_plan = NULL;
+    /* nodes outside the k-space group only redistribute */
+    if(!fft->kspace_member) continue;
+    /* FFT plan creation.
        Attention: destroys contents of c_data/data and c_data_buf/data_buf. */
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"fftw3_1d_wisdom_forw_n%d.file",
-	    fft_plan[i].new_mesh[2]);
+    sprintf(wisdom_file_name,"%sfftw3_1d_wisdom_forw_n%d.file",
+	    fft->wisdom_prefix,plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
       wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
       fclose(wisdom_file);
     }
-    if(fft_init_tag==1) fftw_destroy_plan(fft_plan[i].fft_plan);
 #if FFTW == 3
-//printf("fft_plan[%d].n_ffts=%d\n",i,fft_plan[i].n_ffts);
-    fft_plan[i].fft_plan =
-      fftw_plan_many_dft(1,&fft_plan[i].new_mesh[2],fft_plan[i].n_ffts,
-                         c_data,NULL,1,fft_plan[i].new_mesh[2],
-                         c_data,NULL,1,fft_plan[i].new_mesh[2],
-                         fft_plan[i].dir,FFTW_PATIENT);
+    if(i==1)
+      /* real rows in data_buf to half complex rows in data */
+      plan[i].fft_plan =
+	fftw_plan_many_dft_r2c(1,&plan[i].new_mesh[2],plan[i].n_ffts,
+			       fft->data_buf,NULL,1,plan[i].new_mesh[2],
+			       c_data,NULL,1,plan[i].new_mesh[2]/2 + 1,
+			       FFTW_PATIENT);
+    else
+      plan[i].fft_plan =
+	fftw_plan_many_dft(1,&plan[i].new_mesh[2],plan[i].n_ffts,
+			   c_data,NULL,1,plan[i].new_mesh[2],
+			   c_data,NULL,1,plan[i].new_mesh[2],
+			   plan[i].dir,FFTW_PATIENT);
 #else
-    fft_plan[i].fft_plan = 
-      fftw_create_plan_specific(fft_plan[i].new_mesh[2], fft_plan[i].dir,
+    plan[i].fft_plan =
+      fftw_create_plan_specific(plan[i].new_mesh[2], plan[i].dir,
 				FFTW_MEASURE | FFTW_IN_PLACE | FFTW_USE_WISDOM,
 				c_data, 1,c_data_buf, 1);
 #endif
-    if( wisdom_status == FFTW_FAILURE && 
+    if( wisdom_status == FFTW_FAILURE &&
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
       fftw_export_wisdom_to_file(wisdom_file);
       fclose(wisdom_file);
     }
 #if FFTW == 3
-    fft_plan[i].fft_function = fftw_execute;       
+    plan[i].fft_function = fftw_execute;
 #else
-    fft_plan[i].fft_function = fftw;       
+    plan[i].fft_function = fftw;
 #endif
   }
 
   /* === The BACK Direction === */
   /* this is needed because slightly different functions are used */
   for(i=1;i<4;i++) {
-    fft_back[i].dir = FFTW_BACKWARD;
+    back[i].dir = FFTW_BACKWARD;
+    back[i].pack_function = pack_block_permute1;
+    FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 1 \n",this_node,i));
+    if(back[i].fft_plan) fftw_destroy_plan(back[i].fft_plan);
+    back[i].fft_plan = NULL;
+    if(!fft->kspace_member) continue;
     wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"fftw3_1d_wisdom_back_n%d.file",
-	    fft_plan[i].new_mesh[2]);
+    sprintf(wisdom_file_name,"%sfftw3_1d_wisdom_back_n%d.file",
+	    fft->wisdom_prefix,plan[i].new_mesh[2]);
     if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
       wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
       fclose(wisdom_file);
-    }    
-    if(fft_init_tag==1) fftw_destroy_plan(fft_back[i].fft_plan);
+    }
 #if FFTW == 3
-    fft_back[i].fft_plan =
-      fftw_plan_many_dft(1,&fft_plan[i].new_mesh[2],fft_plan[i].n_ffts,
-                         c_data,NULL,1,fft_plan[i].new_mesh[2],
-                         c_data,NULL,1,fft_plan[i].new_mesh[2],
-                         fft_back[i].dir,FFTW_PATIENT);
+    if(i==1)
+      /* half complex rows in data to real rows in data_buf */
+      back[i].fft_plan =
+	fftw_plan_many_dft_c2r(1,&plan[i].new_mesh[2],plan[i].n_ffts,
+			       c_data,NULL,1,plan[i].new_mesh[2]/2 + 1,
+			       fft->data_buf,NULL,1,plan[i].new_mesh[2],
+			       FFTW_PATIENT);
+    else
+      back[i].fft_plan =
+	fftw_plan_many_dft(1,&plan[i].new_mesh[2],plan[i].n_ffts,
+			   c_data,NULL,1,plan[i].new_mesh[2],
+			   c_data,NULL,1,plan[i].new_mesh[2],
+			   back[i].dir,FFTW_PATIENT);
 #else
-    fft_back[i].fft_plan = 
-      fftw_create_plan_specific(fft_plan[i].new_mesh[2], fft_back[i].dir,
+    back[i].fft_plan =
+      fftw_create_plan_specific(plan[i].new_mesh[2], back[i].dir,
 				FFTW_MEASURE | FFTW_IN_PLACE | FFTW_USE_WISDOM,
 				c_data, 1,c_data_buf, 1);
 #endif
-    if( wisdom_status == FFTW_FAILURE && 
+    if( wisdom_status == FFTW_FAILURE &&
 	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
       fftw_export_wisdom_to_file(wisdom_file);
       fclose(wisdom_file);
     }
 #if FFTW == 3
-    fft_back[i].fft_function = fftw_execute;
+    back[i].fft_function = fftw_execute;
 #else
-    fft_back[i].fft_function = fftw;
+    back[i].fft_function = fftw;
 #endif
-    fft_back[i].pack_function = pack_block_permute1;
-    FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 1 \n",this_node,i));
   }
-  if(fft_plan[1].row_dir==2) {
-    fft_back[1].pack_function = pack_block;
+  if(plan[1].row_dir==2) {
+    back[1].pack_function = pack_block;
     FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 0 \n",this_node,1));
   }
-  else if(fft_plan[1].row_dir==1) {
-    fft_back[1].pack_function = pack_block_permute2;
+  else if(plan[1].row_dir==1) {
+    back[1].pack_function = pack_block_permute2;
     FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 2 \n",this_node,1));
   }
-  fft_init_tag=1;
+  fft->init_tag=1;
   /* free(data); */
   for(i=0;i<4;i++) { free(n_id[i]); free(n_pos[i]); }
-  return max_mesh_size; 
+  return fft->max_mesh_size;
 }
 
-void fft_perform_forw(double *data)
+/** set up one scratch mesh per transformed mesh of a batch.
+    \param fft    the FFT.
+    \param buf    scratch meshes (output).
+    \param n_mesh number of meshes. */
+static void fft_batch_buffers(fft_data *fft, double **buf, int n_mesh)
 {
-  int i;
-  /* int m,n,o; */
-  /* ===== first direction  ===== */
-  FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 1:\n",this_node));
-
-  c_data     = (fftw_complex *) data;
-  c_data_buf = (fftw_complex *) data_buf;
+  int k;
 
-  /* communication to current dir row format (in is data) */
-  forw_grid_comm(fft_plan[1], data, data_buf);
-
-
-  /*
-    fprintf(stderr,"%d: start grid \n",this_node);
-    i=0;
-    for(m=0;m<8;m++) {
-    for(n=0;n<8;n++) {
-    for(o=0;o<8;o++) {
-    fprintf(stderr,"%.3f ",data_buf[i++]);
-    }
-    fprintf(stderr,"\n");
-    }
-    fprintf(stderr,"\n");
-    }
-  */
-
-  /* complexify the real data array (in is data_buf) */
-  for(i=0;i<fft_plan[1].new_size;i++) {
-    data[2*i]     = data_buf[i];     /* real value */
-    data[(2*i)+1] = 0;       /* complex value */
+  if(n_mesh > FFT_MAX_BATCH) {
+    fprintf(stderr,"%d: INTERNAL ERROR: FFT batch of %d meshes\n",this_node,n_mesh);
+    errexit();
   }
-  /* perform FFT (in/out is data)*/
-#if FFTW == 3
-  fftw_execute_dft(fft_plan[1].fft_plan,c_data,c_data);
-#else
-  fft_plan[1].fft_function(fft_plan[1].fft_plan, fft_plan[1].n_ffts,
-  			   c_data, 1, fft_plan[1].new_mesh[2],
-  			   c_data_buf, 1, fft_plan[1].new_mesh[2]);
-#endif
-  /* ===== second direction ===== */
-  FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 2:\n",this_node));
-  /* communication to current dir row format (in is data) */
-  forw_grid_comm(fft_plan[2], data, data_buf);
-  /* perform FFT (in/out is data_buf)*/
-#if FFTW == 3
-  fftw_execute_dft(fft_plan[2].fft_plan,c_data_buf,c_data_buf);
-#else
-  fft_plan[2].fft_function(fft_plan[2].fft_plan, fft_plan[2].n_ffts,
-  			   c_data_buf, 1, fft_plan[2].new_mesh[2],
-  			   c_data, 1, fft_plan[2].new_mesh[2]);
-#endif
-  /* ===== third direction  ===== */
-  FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 3:\n",this_node));
-  /* communication to current dir row format (in is data_buf) */
-  forw_grid_comm(fft_plan[3], data_buf, data);
-  /* perform FFT (in/out is data)*/
-#if FFTW == 3
-  fftw_execute_dft(fft_plan[3].fft_plan,c_data,c_data);
-#else
-  fft_plan[3].fft_function(fft_plan[3].fft_plan, fft_plan[3].n_ffts,
-  			   c_data, 1, fft_plan[3].new_mesh[2],
-  			   c_data_buf, 1, fft_plan[3].new_mesh[2]);
-#endif
-  //print_global_fft_mesh(fft_plan[3],data,1,0);
-
-  /* REMARK: Result has to be in data. */
+  if(n_mesh > 1 && n_mesh > fft->max_batch) {
+    fft->max_batch = n_mesh;
+    fft->batch_buf = (double *)realloc(fft->batch_buf, (fft->max_batch-1)*fft->max_mesh_size*sizeof(double));
+  }
+  buf[0] = fft->data_buf;
+  for(k=1;k<n_mesh;k++) buf[k] = fft->batch_buf + (k-1)*fft->max_mesh_size;
 }
 
-void fft_perform_back(double *data)
+/** perform the real to complex FFT of the first direction.
+    \param fft  the FFT.
+    \param in   real input mesh.
+    \param data complex output mesh. */
+static void fft_forw_first_dir(fft_data *fft, double *in, double *data)
 {
-  int i;
-  
-//The next 4 lines were added by Vincent:
-
-  c_data     = (fftw_complex *) data;
-  c_data_buf = (fftw_complex *) data_buf;
-  
-  /* ===== third direction  ===== */
-  FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 3:\n",this_node));
-
-
-  /* perform FFT (in is data) */
-#if FFTW == 3
-  fftw_execute_dft(fft_back[3].fft_plan,c_data,c_data);
-#else
-  fft_back[3].fft_function(fft_back[3].fft_plan, fft_plan[3].n_ffts,
-  			   c_data, 1, fft_plan[3].new_mesh[2],
-  			   c_data_buf, 1, fft_plan[3].new_mesh[2]);
-#endif
-  /* communicate (in is data)*/
-  back_grid_comm(fft_plan[3],fft_back[3],data,data_buf);
- 
-  /* ===== second direction ===== */
-  FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 2:\n",this_node));
-  /* perform FFT (in is data_buf) */
+  /* Only the new_mesh[2]/2+1 non-negative frequencies of each row are
+     stored, the others follow from the hermitian symmetry. */
 #if FFTW == 3
-  fftw_execute_dft(fft_back[2].fft_plan,c_data_buf,c_data_buf);
+  fftw_execute_dft_r2c(fft->plan[1].fft_plan,in,(fftw_complex *)data);
 #else
-  fft_back[2].fft_function(fft_back[2].fft_plan, fft_plan[2].n_ffts,
-  			   c_data_buf, 1, fft_plan[2].new_mesh[2],
-  			   c_data, 1, fft_plan[2].new_mesh[2]);
-#endif
-  /* communicate (in is data_buf) */
-  back_grid_comm(fft_plan[2],fft_back[2],data_buf,data);
+  fft_forw_plan *plan = &fft->plan[1];
+  int i, r, n_row, n_half;
 
-  /* ===== first direction  ===== */
-  FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 1:\n",this_node));
-  /* perform FFT (in is data) */
-#if FFTW == 3
-  fftw_execute_dft(fft_back[1].fft_plan,c_data,c_data);
-#else
-  fft_back[1].fft_function(fft_back[1].fft_plan, fft_plan[1].n_ffts,
-  			   c_data, 1, fft_plan[1].new_mesh[2],
-  			   c_data_buf, 1, fft_plan[1].new_mesh[2]);
-#endif
-  /* throw away the (hopefully) empty complex component (in is data)*/
-  for(i=0;i<fft_plan[1].new_size;i++) {
-    data_buf[i] = data[2*i]; /* real value */
-    //Vincent:
-    if (data[2*i+1]>1e-5) {
-      printf("Complex value is not zero (i=%d,data=%g)!!!\n",i,data[2*i+1]);
-      if (i>100) exit(-1);
-    }
+  /* complexify the real data array (in is in) */
+  for(i=0;i<plan->new_size;i++) {
+    data[2*i]     = in[i];     /* real value */
+    data[(2*i)+1] = 0;       /* complex value */
   }
-  /* communicate (in is data_buf) */
-  back_grid_comm(fft_plan[1],fft_back[1],data_buf,data);
-
-
-  /* REMARK: Result has to be in data. */
-}
-
+  plan->fft_function(plan->fft_plan, plan->n_ffts,
+		     (fftw_complex *)data, 1, plan->new_mesh[2],
+		     (fftw_complex *)in, 1, plan->new_mesh[2]);
+  /* and shorten the rows in place */
+  n_row  = plan->new_mesh[2];
+  n_half = n_row/2 + 1;
+  for(r=1;r<plan->n_ffts;r++)
+    memmove(&data[2*r*n_half], &data[2*r*n_row], 2*n_half*sizeof(double));
 #endif
+}
 
-
-#ifdef MAGNETOSTATICS
-int Dfft_init(double **Ddata, int *Dca_mesh_dim, int *Dca_mesh_margin, int *ks_pnum)
+/** perform the complex to real FFT of the first direction backwards.
+    \param fft  the FFT.
+    \param data complex input mesh (overwritten).
+    \param out  real output mesh. */
+static void fft_back_first_dir(fft_data *fft, double *data, double *out)
 {
-  int i,j;
-  /* helpers */
-  int mult[3];
-
-  int n_grid[4][3]; /* The four node grids. */
-  int my_pos[4][3]; /* The position of this_node in the node grids. */
-  int *n_id[4];     /* linear node identity lists for the node grids. */
-  int *n_pos[4];    /* positions of nodes in the node grids. */
-  /* FFTW WISDOM stuff. */
-  char wisdom_file_name[255];
-  FILE *wisdom_file;
-#if FFTW == 3
-  int wisdom_status;
-#else
-  fftw_status wisdom_status;
-#endif
-
-  FFT_TRACE(fprintf(stderr,"%d: dipolar Dfft_init():\n",this_node));
-
-
-  Dmax_comm_size=0; Dmax_mesh_size=0;
-  for(i=0;i<4;i++) {
-    n_id[i]  = malloc(1*n_nodes*sizeof(int));
-    n_pos[i] = malloc(3*n_nodes*sizeof(int));
-  }
-
-  /* === node grids === */
-  /* real space node grid (n_grid[0]) */
-  for(i=0;i<3;i++) {
-    n_grid[0][i] = node_grid[i];
-    my_pos[0][i] = node_pos[i];
-  }
-  for(i=0;i<n_nodes;i++) {
-    n_id[0][i] = i;
-    get_grid_pos(i,&(n_pos[0][3*i+0]),&(n_pos[0][3*i+1]),&(n_pos[0][3*i+2]),
-		 n_grid[0]);
-  }
-    
-  /* FFT node grids (n_grid[1 - 3]) */
-  calc_2d_grid(n_nodes,n_grid[1]);
-  /* resort n_grid[1] dimensions if necessary */
-  Dfft_plan[1].row_dir = map_3don2d_grid(n_grid[0], n_grid[1], mult);
-  Dfft_plan[0].n_permute = 0;
-  for(i=1;i<4;i++) Dfft_plan[i].n_permute = (Dfft_plan[1].row_dir+i)%3;
-  for(i=0;i<3;i++) {
-    n_grid[2][i] = n_grid[1][(i+1)%3];
-    n_grid[3][i] = n_grid[1][(i+2)%3];
-  }
-  Dfft_plan[2].row_dir = (Dfft_plan[1].row_dir-1)%3;
-  Dfft_plan[3].row_dir = (Dfft_plan[1].row_dir-2)%3;
-
-
-
-  /* === communication groups === */
-  /* copy local mesh off real space charge assignment grid */
-  for(i=0;i<3;i++) Dfft_plan[0].new_mesh[i] = Dca_mesh_dim[i];
-  for(i=1; i<4;i++) {
-    Dfft_plan[i].g_size=find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i], 
-					Dfft_plan[i].group, n_pos[i], my_pos[i]);
-    if(Dfft_plan[i].g_size==-1) {
-      /* try permutation */
-      j = n_grid[i][(Dfft_plan[i].row_dir+1)%3];
-      n_grid[i][(Dfft_plan[i].row_dir+1)%3] = n_grid[i][(Dfft_plan[i].row_dir+2)%3];
-      n_grid[i][(Dfft_plan[i].row_dir+2)%3] = j;
-      Dfft_plan[i].g_size=find_comm_groups(n_grid[i-1], n_grid[i], n_id[i-1], n_id[i], 
-					  Dfft_plan[i].group, n_pos[i], my_pos[i]);
-      if(Dfft_plan[i].g_size==-1) {
-	fprintf(stderr,"%d: dipolar INTERNAL ERROR: find_comm_groups error\n", this_node);
-	errexit();
-      }
-    }
-
-    Dfft_plan[i].send_block = (int *)realloc(Dfft_plan[i].send_block, 6*Dfft_plan[i].g_size*sizeof(int));
-    Dfft_plan[i].send_size  = (int *)realloc(Dfft_plan[i].send_size, 1*Dfft_plan[i].g_size*sizeof(int));
-    Dfft_plan[i].recv_block = (int *)realloc(Dfft_plan[i].recv_block, 6*Dfft_plan[i].g_size*sizeof(int));
-    Dfft_plan[i].recv_size  = (int *)realloc(Dfft_plan[i].recv_size, 1*Dfft_plan[i].g_size*sizeof(int));
-
-    Dfft_plan[i].new_size = calc_local_mesh(my_pos[i], n_grid[i], p3m.Dmesh,
-					   p3m.Dmesh_off, Dfft_plan[i].new_mesh, 
-					   Dfft_plan[i].start);  
-    permute_ifield(Dfft_plan[i].new_mesh,3,-(Dfft_plan[i].n_permute));
-    permute_ifield(Dfft_plan[i].start,3,-(Dfft_plan[i].n_permute));
-    Dfft_plan[i].n_ffts = Dfft_plan[i].new_mesh[0]*Dfft_plan[i].new_mesh[1];
-
-    /* === send/recv block specifications === */
-    for(j=0; j<Dfft_plan[i].g_size; j++) {
-      int k, node;
-      /* send block: this_node to comm-group-node i (identity: node) */
-      node = Dfft_plan[i].group[j];
-      Dfft_plan[i].send_size[j] 
-	= calc_send_block(my_pos[i-1], n_grid[i-1], &(n_pos[i][3*node]), n_grid[i],
-			  p3m.Dmesh, p3m.Dmesh_off, &(Dfft_plan[i].send_block[6*j]));
-      permute_ifield(&(Dfft_plan[i].send_block[6*j]),3,-(Dfft_plan[i-1].n_permute));
-      permute_ifield(&(Dfft_plan[i].send_block[6*j+3]),3,-(Dfft_plan[i-1].n_permute));
-      if(Dfft_plan[i].send_size[j] > Dmax_comm_size) 
-	Dmax_comm_size = Dfft_plan[i].send_size[j];
-      /* First plan send blocks have to be adjusted, since the CA grid
-	 may have an additional margin outside the actual domain of the
-	 node */
-      if(i==1) {
-	for(k=0;k<3;k++) 
-	  Dfft_plan[1].send_block[6*j+k  ] += Dca_mesh_margin[2*k];
-      }
-      /* recv block: this_node from comm-group-node i (identity: node) */
-      Dfft_plan[i].recv_size[j] 
-	= calc_send_block(my_pos[i], n_grid[i], &(n_pos[i-1][3*node]), n_grid[i-1],
-			  p3m.Dmesh,p3m.Dmesh_off,&(Dfft_plan[i].recv_block[6*j]));
-      permute_ifield(&(Dfft_plan[i].recv_block[6*j]),3,-(Dfft_plan[i].n_permute));
-      permute_ifield(&(Dfft_plan[i].recv_block[6*j+3]),3,-(Dfft_plan[i].n_permute));
-      if(Dfft_plan[i].recv_size[j] > Dmax_comm_size) 
-	Dmax_comm_size = Dfft_plan[i].recv_size[j];
-    }
-
-    for(j=0;j<3;j++) Dfft_plan[i].old_mesh[j] = Dfft_plan[i-1].new_mesh[j];
-    if(i==1) 
-      Dfft_plan[i].element = 1; 
-    else {
-      Dfft_plan[i].element = 2;
-      for(j=0; j<Dfft_plan[i].g_size; j++) {
-	Dfft_plan[i].send_size[j] *= 2;
-	Dfft_plan[i].recv_size[j] *= 2;
-      }
-    }
-    /* DEBUG */
-    for(j=0;j<n_nodes;j++) {
-      /* MPI_Barrier(MPI_COMM_WORLD); */
-      if(j==this_node) FFT_TRACE(print_fft_plan(Dfft_plan[i]));
-    }
-  }
-
-  /* Factor 2 for complex fields */
-  Dmax_comm_size *= 2;
-  Dmax_mesh_size = (Dca_mesh_dim[0]*Dca_mesh_dim[1]*Dca_mesh_dim[2]);
-  for(i=1;i<4;i++) 
-    if(2*Dfft_plan[i].new_size > Dmax_mesh_size) Dmax_mesh_size = 2*Dfft_plan[i].new_size;
-
-  FFT_TRACE(fprintf(stderr,"%d: Dmax_comm_size = %d, Dmax_mesh_size = %d\n",
-		    this_node,Dmax_comm_size,Dmax_mesh_size));
-
-  /* === pack function === */
-  for(i=1;i<4;i++) {
-    Dfft_plan[i].pack_function = pack_block_permute2; 
-    FFT_TRACE(fprintf(stderr,"%d: forw plan[%d] permute 2 \n",this_node,i));
-  }
-  (*ks_pnum)=6;
-  if(Dfft_plan[1].row_dir==2) {
-    Dfft_plan[1].pack_function = pack_block;
-    FFT_TRACE(fprintf(stderr,"%d: forw plan[%d] permute 0 \n",this_node,1));
-    (*ks_pnum)=4;
-  }
-  else if(Dfft_plan[1].row_dir==1) {
-    Dfft_plan[1].pack_function = pack_block_permute1;
-    FFT_TRACE(fprintf(stderr,"%d: forw plan[%d] permute 1 \n",this_node,1));
-    (*ks_pnum)=5;
-  }
-  
-  /* Factor 2 for complex numbers */
-  Dsend_buf = (double *)realloc(Dsend_buf, Dmax_comm_size*sizeof(double));
-  Drecv_buf = (double *)realloc(Drecv_buf, Dmax_comm_size*sizeof(double));
-  (*Ddata)  = (double *)realloc((*Ddata), Dmax_mesh_size*sizeof(double));
-  Ddata_buf = (double *)realloc(Ddata_buf, Dmax_mesh_size*sizeof(double));
-  if(!(*Ddata) || !Ddata_buf || !Drecv_buf || !Dsend_buf) {
-    fprintf(stderr,"%d: Could not allocate FFT data arays\n",this_node);
-    errexit();
-  }
-
-  Dc_data     = (fftw_complex *) (*Ddata);
-  Dc_data_buf = (fftw_complex *) Ddata_buf;
-
-  /* === FFT Routines (Using FFTW / RFFTW package)=== */
-  for(i=1;i<4;i++) {
-    Dfft_plan[i].dir = FFTW_FORWARD;   
-    /* FFT plan creation. 
-       Attention: destroys contents of c_data/data and c_data_buf/data_buf. */
-    wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"Dfftw3_1d_wisdom_forw_n%d.file",
-	    Dfft_plan[i].new_mesh[2]);
-    if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
-      wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
-      fclose(wisdom_file);
-    }
-    if(Dfft_init_tag==1) fftw_destroy_plan(Dfft_plan[i].fft_plan);
 #if FFTW == 3
-//printf("Dfft_plan[%d].n_ffts=%d\n",i,Dfft_plan[i].n_ffts);
-    Dfft_plan[i].fft_plan =
-      fftw_plan_many_dft(1,&Dfft_plan[i].new_mesh[2],Dfft_plan[i].n_ffts,
-                         Dc_data,NULL,1,Dfft_plan[i].new_mesh[2],
-                         Dc_data,NULL,1,Dfft_plan[i].new_mesh[2],
-                         Dfft_plan[i].dir,FFTW_PATIENT);
+  fftw_execute_dft_c2r(fft->back[1].fft_plan,(fftw_complex *)data,out);
 #else
-    Dfft_plan[i].fft_plan = 
-      fftw_create_plan_specific(Dfft_plan[i].new_mesh[2], Dfft_plan[i].dir,
-				FFTW_MEASURE | FFTW_IN_PLACE | FFTW_USE_WISDOM,
-				Dc_data, 1,Dc_data_buf, 1);
-#endif
-    if( wisdom_status == FFTW_FAILURE && 
-	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
-      fftw_export_wisdom_to_file(wisdom_file);
-      fclose(wisdom_file);
+  fft_forw_plan *plan = &fft->plan[1];
+  int i, k, r, n_row, n_half;
+
+  /* restore the full rows from the hermitian symmetry */
+  n_row  = plan->new_mesh[2];
+  n_half = n_row/2 + 1;
+  for(r=plan->n_ffts-1;r>0;r--)
+    memmove(&data[2*r*n_row], &data[2*r*n_half], 2*n_half*sizeof(double));
+  for(r=0;r<plan->n_ffts;r++)
+    for(k=n_half;k<n_row;k++) {
+      data[2*(r*n_row+k)]   =  data[2*(r*n_row+n_row-k)];
+      data[2*(r*n_row+k)+1] = -data[2*(r*n_row+n_row-k)+1];
     }
-#if FFTW == 3
-    Dfft_plan[i].fft_function = fftw_execute;        
-#else
-    Dfft_plan[i].fft_function = fftw;        
+  fft->back[1].fft_function(fft->back[1].fft_plan, plan->n_ffts,
+			    (fftw_complex *)data, 1, plan->new_mesh[2],
+			    (fftw_complex *)out, 1, plan->new_mesh[2]);
+  /* throw away the empty complex component (in is data)*/
+  for(i=0;i<plan->new_size;i++)
+    out[i] = data[2*i]; /* real value */
 #endif
-  }
+}
 
-  /* === The BACK Direction === */
-  /* this is needed because slightly different functions are used */
-  for(i=1;i<4;i++) {
-    Dfft_back[i].dir = FFTW_BACKWARD;
-    wisdom_status   = FFTW_FAILURE;
-    sprintf(wisdom_file_name,"Dfftw3_1d_wisdom_back_n%d.file",
-	    Dfft_plan[i].new_mesh[2]);
-    if( (wisdom_file=fopen(wisdom_file_name,"r"))!=NULL ) {
-      wisdom_status = fftw_import_wisdom_from_file(wisdom_file);
-      fclose(wisdom_file);
-    }    
-    if(Dfft_init_tag==1) fftw_destroy_plan(Dfft_back[i].fft_plan);
-#if FFTW == 3
-    Dfft_back[i].fft_plan =
-      fftw_plan_many_dft(1,&Dfft_plan[i].new_mesh[2],Dfft_plan[i].n_ffts,
-                         Dc_data,NULL,1,Dfft_plan[i].new_mesh[2],
-                         Dc_data,NULL,1,Dfft_plan[i].new_mesh[2],
-                         Dfft_back[i].dir,FFTW_PATIENT);
-#else
-    Dfft_back[i].fft_plan = 
-      fftw_create_plan_specific(Dfft_plan[i].new_mesh[2], Dfft_back[i].dir,
-				FFTW_MEASURE | FFTW_IN_PLACE | FFTW_USE_WISDOM,
-				Dc_data, 1,Dc_data_buf, 1);
-#endif
-    if( wisdom_status == FFTW_FAILURE && 
-	(wisdom_file=fopen(wisdom_file_name,"w"))!=NULL ) {
-      fftw_export_wisdom_to_file(wisdom_file);
-      fclose(wisdom_file);
-    }
+/** perform a complex 1D FFT of the second or third direction in place.
+    \param fplan plan of the direction.
+    \param bplan back plan of the direction, NULL for the forward FFT.
+    \param data  complex mesh.
+    \param buf   scratch mesh (only used by FFTW 2). */
+static void fft_complex_dir(fft_forw_plan *fplan, fft_back_plan *bplan, double *data, double *buf)
+{
+  void *plan = bplan ? bplan->fft_plan : fplan->fft_plan;
 #if FFTW == 3
-    Dfft_back[i].fft_function = fftw_execute;
+  fftw_execute_dft(plan,(fftw_complex *)data,(fftw_complex *)data);
 #else
-    Dfft_back[i].fft_function = fftw;
+  void (*function)() = bplan ? bplan->fft_function : fplan->fft_function;
+  function(plan, fplan->n_ffts,
+	   (fftw_complex *)data, 1, fplan->new_mesh[2],
+	   (fftw_complex *)buf, 1, fplan->new_mesh[2]);
 #endif
-    Dfft_back[i].pack_function = pack_block_permute1;
-    FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 1 \n",this_node,i));
-  }
-  if(Dfft_plan[1].row_dir==2) {
-    Dfft_back[1].pack_function = pack_block;
-    FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 0 \n",this_node,1));
-  }
-  else if(Dfft_plan[1].row_dir==1) {
-    Dfft_back[1].pack_function = pack_block_permute2;
-    FFT_TRACE(fprintf(stderr,"%d: back plan[%d] permute 2 \n",this_node,1));
-  }
-  Dfft_init_tag=1;
-  /* free(data); */
-  for(i=0;i<4;i++) { free(n_id[i]); free(n_pos[i]); }
-  return Dmax_mesh_size; 
 }
 
-
-void Dfft_perform_forw(double *Ddata)
+static void fft_perform_forw_data(fft_data *fft, double **data, int n_mesh)
 {
-  int i;
-  /* int m,n,o; */
-  /* ===== first direction  ===== */
-  FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_forw: dir 1:\n",this_node));
+  int k;
+  double *buf[FFT_MAX_BATCH];
 
-  Dc_data     = (fftw_complex *) Ddata;
-  Dc_data_buf = (fftw_complex *) Ddata_buf;
+  fft_batch_buffers(fft, buf, n_mesh);
 
+  /* ===== first direction  ===== */
+  FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 1, %d meshes:\n",this_node,n_mesh));
   /* communication to current dir row format (in is data) */
-  Dforw_grid_comm(Dfft_plan[1], Ddata, Ddata_buf);
-
-
-  /*
-    fprintf(stderr,"%d: start grid \n",this_node);
-    i=0;
-    for(m=0;m<8;m++) {
-    for(n=0;n<8;n++) {
-    for(o=0;o<8;o++) {
-    fprintf(stderr,"%.3f ",data_buf[i++]);
-    }
-    fprintf(stderr,"\n");
-    }
-    fprintf(stderr,"\n");
-    }
-  */
+  forw_grid_comm(fft, &fft->plan[1], data, buf, n_mesh);
+  /* nodes outside the k-space group are done with sending their meshes */
+  if(!fft->kspace_member) return;
+  /* perform real to complex FFT (in is buf, out is data) */
+  for(k=0;k<n_mesh;k++)
+    fft_forw_first_dir(fft, buf[k], data[k]);
 
-  /* complexify the real data array (in is data_buf) */
-  for(i=0;i<Dfft_plan[1].new_size;i++) {
-    Ddata[2*i]     = Ddata_buf[i];     /* real value */
-    Ddata[(2*i)+1] = 0;       /* complex value */
-  }
-  /* perform FFT (in/out is data)*/
-#if FFTW == 3
-  fftw_execute_dft(Dfft_plan[1].fft_plan,Dc_data,Dc_data);
-#else
-  Dfft_plan[1].fft_function(Dfft_plan[1].fft_plan, Dfft_plan[1].n_ffts,
-  			   Dc_data, 1, Dfft_plan[1].new_mesh[2],
-  			   Dc_data_buf, 1, Dfft_plan[1].new_mesh[2]);
-#endif
   /* ===== second direction ===== */
-  FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_forw: dir 2:\n",this_node));
+  FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 2:\n",this_node));
   /* communication to current dir row format (in is data) */
-  Dforw_grid_comm(Dfft_plan[2], Ddata, Ddata_buf);
-  /* perform FFT (in/out is data_buf)*/
-#if FFTW == 3
-  fftw_execute_dft(Dfft_plan[2].fft_plan,Dc_data_buf,Dc_data_buf);
-#else
-  Dfft_plan[2].fft_function(Dfft_plan[2].fft_plan, Dfft_plan[2].n_ffts,
-  			   Dc_data_buf, 1, Dfft_plan[2].new_mesh[2],
-  			   Dc_data, 1, Dfft_plan[2].new_mesh[2]);
-#endif
+  forw_grid_comm(fft, &fft->plan[2], data, buf, n_mesh);
+  /* perform FFT (in/out is buf)*/
+  for(k=0;k<n_mesh;k++)
+    fft_complex_dir(&fft->plan[2], NULL, buf[k], data[k]);
+
   /* ===== third direction  ===== */
-  FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_forw: dir 3:\n",this_node));
-  /* communication to current dir row format (in is data_buf) */
-  Dforw_grid_comm(Dfft_plan[3], Ddata_buf, Ddata);
+  FFT_TRACE(fprintf(stderr,"%d: fft_perform_forw: dir 3:\n",this_node));
+  /* communication to current dir row format (in is buf) */
+  forw_grid_comm(fft, &fft->plan[3], buf, data, n_mesh);
   /* perform FFT (in/out is data)*/
-#if FFTW == 3
-  fftw_execute_dft(Dfft_plan[3].fft_plan,Dc_data,Dc_data);
-#else
-  Dfft_plan[3].fft_function(Dfft_plan[3].fft_plan, Dfft_plan[3].n_ffts,
-  			   Dc_data, 1, Dfft_plan[3].new_mesh[2],
-  			   Dc_data_buf, 1, Dfft_plan[3].new_mesh[2]);
-#endif
-  //print_global_fft_mesh(Dfft_plan[3],data,1,0);
+  for(k=0;k<n_mesh;k++)
+    fft_complex_dir(&fft->plan[3], NULL, data[k], buf[k]);
 
   /* REMARK: Result has to be in data. */
 }
 
-void Dfft_perform_back(double *Ddata)
+static void fft_perform_back_data(fft_data *fft, double **data, int n_mesh)
 {
-  int i;
+  int k;
+  double *buf[FFT_MAX_BATCH];
 
-  Dc_data     = (fftw_complex *) Ddata;
-  Dc_data_buf = (fftw_complex *) Ddata_buf;
-  
-  /* ===== third direction  ===== */
-  FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_back: dir 3:\n",this_node));
+  fft_batch_buffers(fft, buf, n_mesh);
 
+  /* nodes outside the k-space group only receive their meshes */
+  if(!fft->kspace_member) {
+    back_grid_comm(fft, &fft->plan[1], &fft->back[1], buf, data, n_mesh);
+    return;
+  }
 
+  /* ===== third direction  ===== */
+  FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 3, %d meshes:\n",this_node,n_mesh));
   /* perform FFT (in is data) */
-#if FFTW == 3
-  fftw_execute_dft(Dfft_back[3].fft_plan,Dc_data,Dc_data);
-#else
-  Dfft_back[3].fft_function(Dfft_back[3].fft_plan, Dfft_plan[3].n_ffts,
-  			   Dc_data, 1, Dfft_plan[3].new_mesh[2],
-  			   Dc_data_buf, 1, Dfft_plan[3].new_mesh[2]);
-#endif
+  for(k=0;k<n_mesh;k++)
+    fft_complex_dir(&fft->plan[3], &fft->back[3], data[k], buf[k]);
   /* communicate (in is data)*/
-  Dback_grid_comm(Dfft_plan[3],Dfft_back[3],Ddata,Ddata_buf);
- 
+  back_grid_comm(fft, &fft->plan[3], &fft->back[3], data, buf, n_mesh);
+
   /* ===== second direction ===== */
-  FFT_TRACE(fprintf(stderr,"%d: dipolar fft_perform_back: dir 2:\n",this_node));
-  /* perform FFT (in is data_buf) */
-#if FFTW == 3
-  fftw_execute_dft(Dfft_back[2].fft_plan,Dc_data_buf,Dc_data_buf);
-#else
-  Dfft_back[2].fft_function(Dfft_back[2].fft_plan, Dfft_plan[2].n_ffts,
-  			   Dc_data_buf, 1, Dfft_plan[2].new_mesh[2],
-  			   Dc_data, 1, Dfft_plan[2].new_mesh[2]);
-#endif
-  /* communicate (in is data_buf) */
-  Dback_grid_comm(Dfft_plan[2],Dfft_back[2],Ddata_buf,Ddata);
+  FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 2:\n",this_node));
+  /* perform FFT (in is buf) */
+  for(k=0;k<n_mesh;k++)
+    fft_complex_dir(&fft->plan[2], &fft->back[2], buf[k], data[k]);
+  /* communicate (in is buf) */
+  back_grid_comm(fft, &fft->plan[2], &fft->back[2], buf, data, n_mesh);
 
   /* ===== first direction  ===== */
   FFT_TRACE(fprintf(stderr,"%d: fft_perform_back: dir 1:\n",this_node));
-  /* perform FFT (in is data) */
-#if FFTW == 3
-  fftw_execute_dft(Dfft_back[1].fft_plan,Dc_data,Dc_data);
-#else
-  Dfft_back[1].fft_function(Dfft_back[1].fft_plan, Dfft_plan[1].n_ffts,
-  			   Dc_data, 1, Dfft_plan[1].new_mesh[2],
-  			   Dc_data_buf, 1, Dfft_plan[1].new_mesh[2]);
+  /* perform complex to real FFT (in is data, out is buf) */
+  for(k=0;k<n_mesh;k++)
+    fft_back_first_dir(fft, data[k], buf[k]);
+  /* communicate (in is buf) */
+  back_grid_comm(fft, &fft->plan[1], &fft->back[1], buf, data, n_mesh);
+
+  /* REMARK: Result has to be in data. */
+}
+
+#ifdef ELECTROSTATICS
+int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin, int *ks_pnum)
+{
+  int size = fft_init_data(&fft_charges, data, ca_mesh_dim, ca_mesh_margin,
+			   p3m.mesh, p3m.mesh_off, ks_pnum);
+  fft_ks_half_dim = fft_charges.ks_half_dim;
+  return size;
+}
+
+void fft_perform_forw(double *data)
+{
+  fft_perform_forw_data(&fft_charges, &data, 1);
+}
+
+void fft_perform_back(double *data)
+{
+  fft_perform_back_data(&fft_charges, &data, 1);
+}
+
+void fft_perform_back_batch(double **data, int n_mesh)
+{
+  fft_perform_back_data(&fft_charges, data, n_mesh);
+}
 #endif
-  /* throw away the (hopefully) empty complex component (in is data)*/
-  for(i=0;i<Dfft_plan[1].new_size;i++) {
-    Ddata_buf[i] = Ddata[2*i]; /* real value */
-    //Vincent:
-    if (Ddata[2*i+1]>1e-5) {
-      printf("dipoar fft - Complex value is not zero (i=%d,data=%g)!!!\n",i,Ddata[2*i+1]);
-      if (i>100) exit(-1);
-    }
-  }
-  /* communicate (in is data_buf) */
-  Dback_grid_comm(Dfft_plan[1],Dfft_back[1],Ddata_buf,Ddata);
 
+#ifdef MAGNETOSTATICS
+int Dfft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin, int *ks_pnum)
+{
+  int size = fft_init_data(&fft_dipoles, data, ca_mesh_dim, ca_mesh_margin,
+			   p3m.Dmesh, p3m.Dmesh_off, ks_pnum);
+  Dfft_ks_half_dim = fft_dipoles.ks_half_dim;
+  return size;
+}
 
-  /* REMARK: Result has to be in data. */
+void Dfft_perform_forw(double *data)
+{
+  fft_perform_forw_data(&fft_dipoles, &data, 1);
 }
 
-#endif /*of MAGNETOSTATICS */
+void Dfft_perform_back(double *data)
+{
+  fft_perform_back_data(&fft_dipoles, &data, 1);
+}
+
+void Dfft_perform_forw_batch(double **data, int n_mesh)
+{
+  fft_perform_forw_data(&fft_dipoles, data, n_mesh);
+}
+
+void Dfft_perform_back_batch(double **data, int n_mesh)
+{
+  fft_perform_back_data(&fft_dipoles, data, n_mesh);
+}
+#endif
 
 void pack_block(double *in, double *out, int start[3], int size[3], int dim[3], int element)
 {
@@ -1288,47 +1230,79 @@ int calc_send_block(int pos1[3], int grid1[3], int pos2[3], int grid2[3],
     last2[i] = first2[i] + mesh2[i] -1;
     block[i  ] = imax(first1[i],first2[i]) - first1[i];
     block[i+3] = (imin(last1[i], last2[i] ) - first1[i])-block[i]+1;
+    /* the local meshes do not overlap */
+    if(block[i+3] < 0) block[i+3] = 0;
     size *= block[i+3];
   }
   return size;
 }
 
-#ifdef ELECTROSTATICS
-void forw_grid_comm(fft_forw_plan plan, double *in, double *out)
+static int empty_block(int block[6])
 {
   int i;
+  for(i=0;i<6;i++) block[i] = 0;
+  return 0;
+}
+
+/** make sure the send and receive buffers of the pairwise
+    redistributions hold n_mesh meshes. */
+static void fft_batch_comm_buffers(fft_data *fft, int n_mesh)
+{
+  if(n_mesh*fft->max_comm_size > fft->max_batch_comm_size) {
+    fft->max_batch_comm_size = n_mesh*fft->max_comm_size;
+    fft->send_buf = (double *)realloc(fft->send_buf, fft->max_batch_comm_size*sizeof(double));
+    fft->recv_buf = (double *)realloc(fft->recv_buf, fft->max_batch_comm_size*sizeof(double));
+  }
+}
+
+static void forw_grid_comm(fft_data *fft, fft_forw_plan *plan, double **in, double **out, int n_mesh)
+{
+  int i, k;
   MPI_Status status;
   double *tmp_ptr;
 
-  for(i=0;i<plan.g_size;i++) {   
-    plan.pack_function(in, send_buf, &(plan.send_block[6*i]), 
-		       &(plan.send_block[6*i+3]), plan.old_mesh, plan.element);
+  if(fft_use_alltoall || fft->n_fft_nodes < n_nodes) {
+    alltoall_grid_comm(fft, plan, plan->pack_function,
+		       plan->send_block, plan->send_size, plan->old_mesh,
+		       plan->recv_block, plan->recv_size, plan->new_mesh,
+		       in, out, n_mesh);
+    return;
+  }
+
+  fft_batch_comm_buffers(fft, n_mesh);
 
-    if(plan.group[i]<this_node) {       /* send first, receive second */
-      MPI_Send(send_buf, plan.send_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD);
-      MPI_Recv(recv_buf, plan.recv_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status); 	
+  for(i=0;i<plan->g_size;i++) {
+    for(k=0;k<n_mesh;k++)
+      plan->pack_function(in[k], fft->send_buf + k*plan->send_size[i], &(plan->send_block[6*i]),
+			  &(plan->send_block[6*i+3]), plan->old_mesh, plan->element);
+
+    if(plan->group[i]<this_node) {       /* send first, receive second */
+      MPI_Send(fft->send_buf, n_mesh*plan->send_size[i], MPI_DOUBLE,
+	       plan->group[i], REQ_FFT_FORW, MPI_COMM_WORLD);
+      MPI_Recv(fft->recv_buf, n_mesh*plan->recv_size[i], MPI_DOUBLE,
+	       plan->group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status);
     }
-    else if(plan.group[i]>this_node) {  /* receive first, send second */
-      MPI_Recv(recv_buf, plan.recv_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status); 	
-      MPI_Send(send_buf, plan.send_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD);      
+    else if(plan->group[i]>this_node) {  /* receive first, send second */
+      MPI_Recv(fft->recv_buf, n_mesh*plan->recv_size[i], MPI_DOUBLE,
+	       plan->group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status);
+      MPI_Send(fft->send_buf, n_mesh*plan->send_size[i], MPI_DOUBLE,
+	       plan->group[i], REQ_FFT_FORW, MPI_COMM_WORLD);
     }
-    else {                              /* Self communication... */   
-      tmp_ptr  = send_buf;
-      send_buf = recv_buf;
-      recv_buf = tmp_ptr;
+    else {                              /* Self communication... */
+      tmp_ptr       = fft->send_buf;
+      fft->send_buf = fft->recv_buf;
+      fft->recv_buf = tmp_ptr;
     }
-    unpack_block(recv_buf, out, &(plan.recv_block[6*i]), 
-		 &(plan.recv_block[6*i+3]), plan.new_mesh, plan.element);
+    for(k=0;k<n_mesh;k++)
+      unpack_block(fft->recv_buf + k*plan->recv_size[i], out[k], &(plan->recv_block[6*i]),
+		   &(plan->recv_block[6*i+3]), plan->new_mesh, plan->element);
   }
 }
 
-void back_grid_comm(fft_forw_plan plan_f,  fft_back_plan plan_b, double *in, double *out)
+static void back_grid_comm(fft_data *fft, fft_forw_plan *plan_f, fft_back_plan *plan_b,
+			   double **in, double **out, int n_mesh)
 {
-  int i;
+  int i, k;
   MPI_Status status;
   double *tmp_ptr;
 
@@ -1336,106 +1310,127 @@ void back_grid_comm(fft_forw_plan plan_f,  fft_back_plan plan_b, double *in, dou
      replace the recieve blocks by the send blocks and vice
      versa. Attention then also new_mesh and old_mesh are exchanged */
 
-  for(i=0;i<plan_f.g_size;i++) {
-    
-    plan_b.pack_function(in, send_buf, &(plan_f.recv_block[6*i]), 
-		       &(plan_f.recv_block[6*i+3]), plan_f.new_mesh, plan_f.element);
-
-    if(plan_f.group[i]<this_node) {       /* send first, receive second */
-      MPI_Send(send_buf, plan_f.recv_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD);
-      MPI_Recv(recv_buf, plan_f.send_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status); 	
-    }
-    else if(plan_f.group[i]>this_node) {  /* receive first, send second */
-      MPI_Recv(recv_buf, plan_f.send_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status); 	
-      MPI_Send(send_buf, plan_f.recv_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD);      
-    }
-    else {                                /* Self communication... */   
-      tmp_ptr  = send_buf;
-      send_buf = recv_buf;
-      recv_buf = tmp_ptr;
-    }
-    unpack_block(recv_buf, out, &(plan_f.send_block[6*i]), 
-		 &(plan_f.send_block[6*i+3]), plan_f.old_mesh, plan_f.element);
+  if(fft_use_alltoall || fft->n_fft_nodes < n_nodes) {
+    alltoall_grid_comm(fft, plan_f, plan_b->pack_function,
+		       plan_f->recv_block, plan_f->recv_size, plan_f->new_mesh,
+		       plan_f->send_block, plan_f->send_size, plan_f->old_mesh,
+		       in, out, n_mesh);
+    return;
   }
-}
 
-#endif
+  fft_batch_comm_buffers(fft, n_mesh);
 
-#ifdef MAGNETOSTATICS
-void Dforw_grid_comm(fft_forw_plan plan, double *in, double *out)
-{
-  int i;
-  MPI_Status status;
-  double *tmp_ptr;
+  for(i=0;i<plan_f->g_size;i++) {
 
-  for(i=0;i<plan.g_size;i++) {   
-    plan.pack_function(in, Dsend_buf, &(plan.send_block[6*i]), 
-		       &(plan.send_block[6*i+3]), plan.old_mesh, plan.element);
+    for(k=0;k<n_mesh;k++)
+      plan_b->pack_function(in[k], fft->send_buf + k*plan_f->recv_size[i], &(plan_f->recv_block[6*i]),
+			    &(plan_f->recv_block[6*i+3]), plan_f->new_mesh, plan_f->element);
 
-    if(plan.group[i]<this_node) {       /* send first, receive second */
-      MPI_Send(Dsend_buf, plan.send_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD);
-      MPI_Recv(Drecv_buf, plan.recv_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status); 	
+    if(plan_f->group[i]<this_node) {       /* send first, receive second */
+      MPI_Send(fft->send_buf, n_mesh*plan_f->recv_size[i], MPI_DOUBLE,
+	       plan_f->group[i], REQ_FFT_BACK, MPI_COMM_WORLD);
+      MPI_Recv(fft->recv_buf, n_mesh*plan_f->send_size[i], MPI_DOUBLE,
+	       plan_f->group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status);
     }
-    else if(plan.group[i]>this_node) {  /* receive first, send second */
-      MPI_Recv(Drecv_buf, plan.recv_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD, &status); 	
-      MPI_Send(Dsend_buf, plan.send_size[i], MPI_DOUBLE, 
-	       plan.group[i], REQ_FFT_FORW, MPI_COMM_WORLD);      
+    else if(plan_f->group[i]>this_node) {  /* receive first, send second */
+      MPI_Recv(fft->recv_buf, n_mesh*plan_f->send_size[i], MPI_DOUBLE,
+	       plan_f->group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status);
+      MPI_Send(fft->send_buf, n_mesh*plan_f->recv_size[i], MPI_DOUBLE,
+	       plan_f->group[i], REQ_FFT_BACK, MPI_COMM_WORLD);
     }
-    else {                              /* Self communication... */   
-      tmp_ptr  = Dsend_buf;
-      Dsend_buf = Drecv_buf;
-      Drecv_buf = tmp_ptr;
+    else {                                /* Self communication... */
+      tmp_ptr       = fft->send_buf;
+      fft->send_buf = fft->recv_buf;
+      fft->recv_buf = tmp_ptr;
     }
-    unpack_block(Drecv_buf, out, &(plan.recv_block[6*i]), 
-		 &(plan.recv_block[6*i+3]), plan.new_mesh, plan.element);
+    for(k=0;k<n_mesh;k++)
+      unpack_block(fft->recv_buf + k*plan_f->send_size[i], out[k], &(plan_f->send_block[6*i]),
+		   &(plan_f->send_block[6*i+3]), plan_f->old_mesh, plan_f->element);
   }
 }
 
-void Dback_grid_comm(fft_forw_plan plan_f,  fft_back_plan plan_b, double *in, double *out)
+
+static void alltoall_grid_comm(fft_data *fft, fft_forw_plan *plan, void (*pack)(),
+			       int *s_block, int *s_size, int *s_mesh,
+			       int *r_block, int *r_size, int *r_mesh,
+			       double **in, double **out, int n_mesh)
 {
-  int i;
+  int i, k, r, self=-1, n_remote=0;
+  int max_a2a_size = fft->max_a2a_size;
+  double *s_buf, *r_buf;
+#ifdef FFT_ASYNC_ALLTOALL
+  MPI_Request request[2];
   MPI_Status status;
-  double *tmp_ptr;
-
-  /* Back means: Use the send/recieve stuff from the forward plan but
-     replace the recieve blocks by the send blocks and vice
-     versa. Attention then also new_mesh and old_mesh are exchanged */
+#endif
 
-  for(i=0;i<plan_f.g_size;i++) {
-    
-    plan_b.pack_function(in, Dsend_buf, &(plan_f.recv_block[6*i]), 
-		       &(plan_f.recv_block[6*i+3]), plan_f.new_mesh, plan_f.element);
+  if(2*max_a2a_size > fft->a2a_buf_size) {
+    fft->a2a_buf_size = 2*max_a2a_size;
+    fft->a2a_send_buf = (double *)realloc(fft->a2a_send_buf, fft->a2a_buf_size*sizeof(double));
+    fft->a2a_recv_buf = (double *)realloc(fft->a2a_recv_buf, fft->a2a_buf_size*sizeof(double));
+  }
 
-    if(plan_f.group[i]<this_node) {       /* send first, receive second */
-      MPI_Send(Dsend_buf, plan_f.recv_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD);
-      MPI_Recv(Drecv_buf, plan_f.send_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status); 	
+  /* the blocks are stored in group order, the counts by communicator
+     rank. The own block is copied locally. */
+  for(i=0;i<plan->g_size;i++) {
+    r = plan->comm_rank[i];
+    if(i==0)
+      a2a_send_displ[r] = a2a_recv_displ[r] = 0;
+    else {
+      a2a_send_displ[r] = a2a_send_displ[plan->comm_rank[i-1]] + s_size[i-1];
+      a2a_recv_displ[r] = a2a_recv_displ[plan->comm_rank[i-1]] + r_size[i-1];
     }
-    else if(plan_f.group[i]>this_node) {  /* receive first, send second */
-      MPI_Recv(Drecv_buf, plan_f.send_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD, &status); 	
-      MPI_Send(Dsend_buf, plan_f.recv_size[i], MPI_DOUBLE, 
-	       plan_f.group[i], REQ_FFT_BACK, MPI_COMM_WORLD);      
+    if(plan->group[i] == this_node) {
+      self = i;
+      a2a_send_count[r] = a2a_recv_count[r] = 0;
     }
-    else {                                /* Self communication... */   
-      tmp_ptr  = Dsend_buf;
-      Dsend_buf = Drecv_buf;
-      Drecv_buf = tmp_ptr;
+    else {
+      a2a_send_count[r] = s_size[i];
+      a2a_recv_count[r] = r_size[i];
+      n_remote++;
     }
-    unpack_block(Drecv_buf, out, &(plan_f.send_block[6*i]), 
-		 &(plan_f.send_block[6*i+3]), plan_f.old_mesh, plan_f.element);
   }
-}
 
+  for(k=0;k<=n_mesh;k++) {
+    if(k<n_mesh) {
+      /* pack and send off mesh k */
+      s_buf = fft->a2a_send_buf + (k%2)*max_a2a_size;
+      r_buf = fft->a2a_recv_buf + (k%2)*max_a2a_size;
+      for(i=0;i<plan->g_size;i++)
+	if(i != self && s_size[i] > 0)
+	  pack(in[k], s_buf + a2a_send_displ[plan->comm_rank[i]], &(s_block[6*i]),
+	       &(s_block[6*i+3]), s_mesh, plan->element);
+      if(n_remote > 0) {
+#ifdef FFT_ASYNC_ALLTOALL
+	MPI_Ialltoallv(s_buf, a2a_send_count, a2a_send_displ, MPI_DOUBLE,
+		       r_buf, a2a_recv_count, a2a_recv_displ, MPI_DOUBLE,
+		       plan->comm, &request[k%2]);
+#else
+	MPI_Alltoallv(s_buf, a2a_send_count, a2a_send_displ, MPI_DOUBLE,
+		      r_buf, a2a_recv_count, a2a_recv_displ, MPI_DOUBLE,
+		      plan->comm);
+#endif
+      }
+      /* own block of mesh k, while it is in transit */
+      if(self >= 0) {
+	s_buf += a2a_send_displ[plan->comm_rank[self]];
+	pack(in[k], s_buf, &(s_block[6*self]), &(s_block[6*self+3]), s_mesh, plan->element);
+	unpack_block(s_buf, out[k], &(r_block[6*self]), &(r_block[6*self+3]), r_mesh, plan->element);
+      }
+    }
+    if(k>0) {
+      /* receive and unpack mesh k-1 */
+      r_buf = fft->a2a_recv_buf + ((k-1)%2)*max_a2a_size;
+#ifdef FFT_ASYNC_ALLTOALL
+      if(n_remote > 0)
+	MPI_Wait(&request[(k-1)%2], &status);
 #endif
+      for(i=0;i<plan->g_size;i++)
+	if(i != self && r_size[i] > 0)
+	  unpack_block(r_buf + a2a_recv_displ[plan->comm_rank[i]], out[k-1], &(r_block[6*i]),
+		       &(r_block[6*i+3]), r_mesh, plan->element);
+    }
+  }
+}
 
 void print_fft_plan(fft_forw_plan pl)
 {
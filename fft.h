@@ -18,9 +18,21 @@
  *  1D-FFT. After performing the FFT on theat direction the data is
  *  redistributed.
  *
- *  For simplicity at the moment I have implemented a full complex to
- *  complex FFT (even though a real to complex FFT would be
- *  sufficient)
+ *  The node grids of the three 1D-FFTs are two dimensional (pencil
+ *  decomposition), and a node only exchanges data with the nodes in
+ *  its row or column of the grid. By default, each redistribution is
+ *  one MPI_Alltoallv in the communicator of this group, see \ref
+ *  fft_use_alltoall.
+ *
+ *  The first 1D-FFT is a real to complex FFT, so that for its row
+ *  direction only the non-negative frequencies are stored and
+ *  communicated (see \ref fft_ks_half_dim). The other two are full
+ *  complex FFTs.
+ *
+ *  The charge mesh (fft_*) and the dipolar meshes (Dfft_*) have
+ *  separate plans and buffers, but share the same implementation.
+ *  Several meshes can be transformed in one batch, then each
+ *  redistribution moves all of them together.
  *
  *  \todo Combine the forward and backward structures.
  *  \todo The packing routines could be moved to utils.h when they are needed elsewhere.
@@ -28,10 +40,38 @@
  *  For more information about FFT usage, see \ref fft.c "fft.c".  
 */
 
+#include <mpi.h>
+#include <tcl.h>
 #include "utils.h"
 
+/** Whether the redistributions of the 3D-FFT are done with one
+    all-to-all exchange in the communicator of each node group (1) or
+    with pairwise send/receive between the group members (0). Set via
+    setmd fft_alltoall, callback is \ref fft_alltoall_callback. */
+extern int fft_use_alltoall;
+
+/** Callback for setmd fft_alltoall. */
+int fft_alltoall_callback(Tcl_Interp *interp, void *_data);
+
+/** Number of nodes performing the 3D-FFTs of P3M, for the charge as
+    well as for the dipolar mesh. 0 means all nodes.
+    If smaller than the number of nodes, the first nodes form the
+    k-space group. All nodes still assign their charges, and receive
+    the force meshes back, but the FFTs and their redistributions only
+    involve the k-space group. Set via setmd fft_nodes, callback is
+    \ref fft_nodes_callback. */
+extern int fft_kspace_nodes;
+
+/** Callback for setmd fft_nodes. */
+int fft_nodes_callback(Tcl_Interp *interp, void *_data);
+
 #ifdef ELP3M
 
+/** maximal number of meshes for the batched transforms, e.g. \ref
+    fft_perform_back_batch. The dipolar P3M transforms three torque and
+    six force meshes together. */
+#define FFT_MAX_BATCH 9
+
 /************************************************
  * data types
  ************************************************/
@@ -68,6 +108,10 @@ typedef struct {
   int g_size;
   /** group of nodes which have to communicate with each other. */ 
   int *group;
+  /** communicator of the nodes in \ref group. */
+  MPI_Comm comm;
+  /** rank of the group members in \ref comm. */
+  int *comm_rank;
 
   /** packing function for send blocks. */
   void (*pack_function)();
@@ -110,10 +154,20 @@ typedef struct {
 
 #ifdef ELECTROSTATICS
 extern fft_forw_plan fft_plan[4];
+
+/** Direction of the k-space mesh (in the index order of fft_plan[3])
+    which is halved by the real to complex FFT. For this direction, only
+    the frequencies 0 to mesh/2 are stored, the negative ones follow from
+    the hermitian symmetry of the transformed real charge mesh. */
+extern int fft_ks_half_dim;
 #endif
 
 #ifdef MAGNETOSTATICS
 extern fft_forw_plan Dfft_plan[4];
+
+/** Direction of the dipolar k-space mesh which is halved by the real
+    to complex FFT, see \ref fft_ks_half_dim. */
+extern int Dfft_ks_half_dim;
 #endif
 
 
@@ -138,18 +192,30 @@ void  fft_pre_init();
 int fft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin, int *ks_pnum);
 
 /** perform the forward 3D FFT.
-    The assigned charges are in \a data. The result is also stored in \a data.
+    The assigned charges are in \a data. The result is also stored in \a data,
+    as half spectrum in direction \ref fft_ks_half_dim.
     \warning The content of \a data is overwritten.
     \param data Mesh.
 */
 void fft_perform_forw(double *data);
 
-/** perform the backward 3D FFT.
+/** perform the backward 3D FFT. The input is the half spectrum as
+    returned by \ref fft_perform_forw, the result is real.
     \warning The content of \a data is overwritten.
     \param data Mesh.
 */
 void fft_perform_back(double *data);
 
+/** perform the backward 3D FFT for several meshes at once, e.g. the
+    three force components of P3M. The meshes are moved through each
+    redistribution together, which saves messages and latency. Each
+    mesh has to be of the size returned by \ref fft_init.
+    \warning The content of the meshes is overwritten.
+    \param data   Meshes.
+    \param n_mesh Number of meshes, at most \ref FFT_MAX_BATCH.
+*/
+void fft_perform_back_batch(double **data, int n_mesh);
+
 #endif
 
 #ifdef MAGNETOSTATICS
@@ -164,18 +230,37 @@ void fft_perform_back(double *data);
 int Dfft_init(double **data, int *ca_mesh_dim, int *ca_mesh_margin, int *ks_pnum);
 
 /** perform the forward 3D FFT for meshes related to the magnetic dipole-dipole interaction.
-    The assigned charges are in \a data. The result is also stored in \a data.
+    The assigned dipoles are in \a data. The result is also stored in \a data,
+    as half spectrum in direction \ref Dfft_ks_half_dim.
     \warning The content of \a data is overwritten.
     \param data DMesh.
 */
 void Dfft_perform_forw(double *data);
 
 /** perform the backward 3D FFT for meshes related to the magnetic dipole-dipole interaction.
+    The input is the half spectrum as returned by \ref Dfft_perform_forw, the result is real.
     \warning The content of \a data is overwritten.
     \param data DMesh.
 */
 void Dfft_perform_back(double *data);
 
+/** perform the forward 3D FFT for several dipolar meshes at once,
+    e.g. the three dipole components. As for \ref
+    fft_perform_back_batch, the meshes are moved through each
+    redistribution together.
+    \warning The content of the meshes is overwritten.
+    \param data   Meshes of the size returned by \ref Dfft_init.
+    \param n_mesh Number of meshes, at most \ref FFT_MAX_BATCH.
+*/
+void Dfft_perform_forw_batch(double **data, int n_mesh);
+
+/** perform the backward 3D FFT for several dipolar meshes at once.
+    \warning The content of the meshes is overwritten.
+    \param data   Meshes of the size returned by \ref Dfft_init.
+    \param n_mesh Number of meshes, at most \ref FFT_MAX_BATCH.
+*/
+void Dfft_perform_back_batch(double **data, int n_mesh);
+
 #endif
 
 
@@ -38,6 +38,15 @@
 #include "virtual_sites.h"
 #include "constraint.h"
 
+/************************************************************/
+/* local variables                                          */
+/************************************************************/
+
+/** forces of the local particles saved by \ref save_and_clear_forces. */
+static double *saved_forces = NULL;
+/** number of particles \ref saved_forces has room for. */
+static int saved_forces_size = 0;
+
 /************************************************************/
 /* local prototypes                                         */
 /************************************************************/
@@ -45,6 +54,18 @@
 /** Calculate long range forces (P3M, MMM2d...). */
 void calc_long_range_forces();
 
+/** Calculate the long range electrostatic forces. */
+void calc_long_range_charge_forces();
+
+/** Store the forces of the local particles and set them to zero, so that
+    the following force contributions can be scaled separately by \ref
+    add_saved_forces. */
+void save_and_clear_forces();
+
+/** Scale the forces of the local particles by scale and add the forces
+    stored by \ref save_and_clear_forces. */
+void add_saved_forces(double scale);
+
 /** initialize real particle forces with thermostat forces and
     ghost particle forces with zero. */
 void init_forces();
@@ -100,6 +121,77 @@ void force_calc()
 
 void calc_long_range_forces()
 {
+#ifdef ELECTROSTATICS  
+#ifdef ELP3M
+  /* the particles have moved since the charge mesh was last cached */
+  P3M_invalidate_charge_cache();
+#endif
+  EWALD_invalidate_structure_factors();
+  /* With r-RESPA, the long range forces are calculated only every
+     respa_steps steps, and then act as an impulse respa_steps times as
+     strong. MAGGS propagates its fields with the particles and has to
+     run every step. The MMM1D tree yields the complete force, including
+     the near field, and therefore also has to run every step. */
+  if (respa_steps == 1 || coulomb.method == COULOMB_MAGGS
+      || (coulomb.method == COULOMB_MMM1D && mmm1d_params.tree_theta > 0))
+    calc_long_range_charge_forces();
+  else if (respa_step == 0) {
+    save_and_clear_forces();
+    calc_long_range_charge_forces();
+    add_saved_forces(respa_steps);
+  }
+#endif
+
+#ifdef MAGNETOSTATICS  
+  /* calculate k-space part of the magnetostatic interaction. */
+  switch (coulomb.Dmethod) {
+#ifdef ELP3M
+#ifdef MDLC
+  case DIPOLAR_MDLC_P3M:
+     add_mdlc_force_corrections();
+    //fall through 
+#endif
+  case DIPOLAR_P3M:
+    P3M_dipole_assign();
+#ifdef NPT
+    if(integ_switch == INTEG_METHOD_NPT_ISO) {
+      nptiso.p_vir[0] += P3M_calc_kspace_forces_for_dipoles(1,1);
+      fprintf(stderr,"dipolar_P3M at this moment is added to p_vir[0]\n");    
+    } else
+#endif
+      P3M_calc_kspace_forces_for_dipoles(1,0);
+
+      break;
+#endif
+#ifdef DAWAANR
+  case DIPOLAR_ALL_WITH_ALL_AND_NO_REPLICA: 
+      dawaanr_calculations(1,0);
+      break;
+#endif
+#ifdef MAGNETIC_DIPOLAR_DIRECT_SUM
+#ifdef MDLC
+  case DIPOLAR_MDLC_DS:
+     add_mdlc_force_corrections();
+    //fall through 
+#endif
+  case DIPOLAR_DS: 
+        magnetic_dipolar_direct_sum_calculations(1,0);
+      break;
+#endif
+#ifdef DIPOLAR_BARNES_HUT
+  case DIPOLAR_BH:
+      dipolar_bh_calculations(1,0);
+      break;
+#endif
+
+  }
+#endif  /*ifdef MAGNETOSTATICS */
+}
+
+/************************************************************/
+
+void calc_long_range_charge_forces()
+{
 #ifdef ELECTROSTATICS  
   /* calculate k-space part of electrostatic interaction. */
   switch (coulomb.method) {
@@ -145,48 +237,56 @@ void calc_long_range_forces()
   case COULOMB_MMM2D:
     MMM2D_add_far_force();
     MMM2D_dielectric_layers_force_contribution();
+    break;
+  case COULOMB_MMM1D:
+    if (mmm1d_params.tree_theta > 0)
+      MMM1D_tree_add_forces();
   }
 #endif  /*ifdef ELECTROSTATICS */
+}
 
-#ifdef MAGNETOSTATICS  
-  /* calculate k-space part of the magnetostatic interaction. */
-  switch (coulomb.Dmethod) {
-#ifdef ELP3M
-#ifdef MDLC
-  case DIPOLAR_MDLC_P3M:
-     add_mdlc_force_corrections();
-    //fall through 
-#endif
-  case DIPOLAR_P3M:
-    P3M_dipole_assign();
-#ifdef NPT
-    if(integ_switch == INTEG_METHOD_NPT_ISO) {
-      nptiso.p_vir[0] += P3M_calc_kspace_forces_for_dipoles(1,1);
-      fprintf(stderr,"dipolar_P3M at this moment is added to p_vir[0]\n");    
-    } else
-#endif
-      P3M_calc_kspace_forces_for_dipoles(1,0);
+/************************************************************/
 
-      break;
-#endif
-#ifdef DAWAANR
-  case DIPOLAR_ALL_WITH_ALL_AND_NO_REPLICA: 
-      dawaanr_calculations(1,0);
-      break;
-#endif
-#ifdef MAGNETIC_DIPOLAR_DIRECT_SUM
-#ifdef MDLC
-  case DIPOLAR_MDLC_DS:
-     add_mdlc_force_corrections();
-    //fall through 
-#endif
-  case DIPOLAR_DS: 
-        magnetic_dipolar_direct_sum_calculations(1,0);
-      break;
-#endif
+void save_and_clear_forces()
+{
+  Cell *cell;
+  Particle *p;
+  int c, i, np, n = 0;
 
+  for (c = 0; c < local_cells.n; c++)
+    n += local_cells.cell[c]->n;
+  if (n > saved_forces_size) {
+    saved_forces_size = n;
+    saved_forces = realloc(saved_forces, 3*n*sizeof(double));
+  }
+
+  n = 0;
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for (i = 0; i < np; i++) {
+      saved_forces[n++] = p[i].f.f[0]; p[i].f.f[0] = 0;
+      saved_forces[n++] = p[i].f.f[1]; p[i].f.f[1] = 0;
+      saved_forces[n++] = p[i].f.f[2]; p[i].f.f[2] = 0;
+    }
+  }
+}
+
+void add_saved_forces(double scale)
+{
+  Cell *cell;
+  Particle *p;
+  int c, i, j, np, n = 0;
+
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for (i = 0; i < np; i++)
+      for (j = 0; j < 3; j++)
+	p[i].f.f[j] = saved_forces[n++] + scale*p[i].f.f[j];
   }
-#endif  /*ifdef MAGNETOSTATICS */
 }
 
 /************************************************************/
@@ -62,9 +62,13 @@ void prepare_comm(GhostCommunicator *comm, int data_parts, int num)
   GHOST_TRACE(fprintf(stderr, "%d: prepare_comm, data_parts = %d\n", this_node, comm->data_parts));
 
   comm->num = num;
+  comm->persistent = 0;
   comm->comm = malloc(num*sizeof(GhostCommunication));
   for(i=0; i<num; i++) {
     comm->comm[i].shift[0]=comm->comm[i].shift[1]=comm->comm[i].shift[2]=0.0;
+    comm->comm[i].request  = MPI_REQUEST_NULL;
+    comm->comm[i].buffer   = NULL;
+    comm->comm[i].n_buffer = -1;
   }
 }
 
@@ -72,7 +76,13 @@ void free_comm(GhostCommunicator *comm)
 {
   int n;
   GHOST_TRACE(fprintf(stderr,"%d: free_comm: %p has %d ghost communications\n",this_node,comm,comm->num));
-  for (n = 0; n < comm->num; n++) free(comm->comm[n].part_lists);
+  for (n = 0; n < comm->num; n++) {
+    free(comm->comm[n].part_lists);
+    if (comm->comm[n].n_buffer >= 0) {
+      MPI_Request_free(&comm->comm[n].request);
+      free(comm->comm[n].buffer);
+    }
+  }
   free(comm->comm);
 }
 
@@ -105,24 +115,15 @@ int calc_transmit_size(GhostCommunication *gc, int data_parts)
   return n_buffer_new;
 }
 
-void prepare_send_buffer(GhostCommunication *gc, int data_parts)
+/** put the data to send into buffer, which has to be of size n_buffer as given by \ref calc_transmit_size. */
+static void fill_send_buffer(GhostCommunication *gc, int data_parts, char *buffer, int n_buffer)
 {
   char *insert;
   int pl, p, np;
   Particle *part, *pt;
 
-  GHOST_TRACE(fprintf(stderr, "%d: prepare sending to/bcast from %d\n", this_node, gc->node));
-
-  /* reallocate send buffer */
-  n_s_buffer = calc_transmit_size(gc, data_parts);
-  if (n_s_buffer > max_s_buffer) {
-    max_s_buffer = n_s_buffer;
-    s_buffer = realloc(s_buffer, max_s_buffer);
-  }
-  GHOST_TRACE(fprintf(stderr, "%d: will send %d\n", this_node, n_s_buffer));
-
   /* put in data */
-  insert = s_buffer;
+  insert = buffer;
   for (pl = 0; pl < gc->n_part_lists; pl++) {
     np   = gc->part_lists[pl]->n;
     if (data_parts == GHOSTTRANS_PARTNUM) {
@@ -171,13 +172,28 @@ void prepare_send_buffer(GhostCommunication *gc, int data_parts)
     }
   }
 #ifdef ADDITIONAL_CHECKS
-  if (insert - s_buffer != n_s_buffer) {
-    fprintf(stderr, "%d: INTERNAL ERROR: send buffer size %d differs from what I put in %d\n", this_node, n_s_buffer, insert - s_buffer);
+  if (insert - buffer != n_buffer) {
+    fprintf(stderr, "%d: INTERNAL ERROR: send buffer size %d differs from what I put in %d\n", this_node, n_buffer, insert - buffer);
     errexit();
   }
 #endif
 }
 
+void prepare_send_buffer(GhostCommunication *gc, int data_parts)
+{
+  GHOST_TRACE(fprintf(stderr, "%d: prepare sending to/bcast from %d\n", this_node, gc->node));
+
+  /* reallocate send buffer */
+  n_s_buffer = calc_transmit_size(gc, data_parts);
+  if (n_s_buffer > max_s_buffer) {
+    max_s_buffer = n_s_buffer;
+    s_buffer = realloc(s_buffer, max_s_buffer);
+  }
+  GHOST_TRACE(fprintf(stderr, "%d: will send %d\n", this_node, n_s_buffer));
+
+  fill_send_buffer(gc, data_parts, s_buffer, n_s_buffer);
+}
+
 void prepare_recv_buffer(GhostCommunication *gc, int data_parts)
 {
   GHOST_TRACE(fprintf(stderr, "%d: prepare receiving from %d\n", this_node, gc->node));
@@ -190,14 +206,14 @@ void prepare_recv_buffer(GhostCommunication *gc, int data_parts)
   GHOST_TRACE(fprintf(stderr, "%d: will get %d\n", this_node, n_r_buffer));
 }
 
-void put_recv_buffer(GhostCommunication *gc, int data_parts)
+void put_recv_buffer(GhostCommunication *gc, int data_parts, char *buffer, int n_buffer)
 {
   int pl, p, np;
   Particle *part, *pt;
   char *retrieve;
 
   /* put back data */
-  retrieve = r_buffer;
+  retrieve = buffer;
   for (pl = 0; pl < gc->n_part_lists; pl++) {
     if (data_parts == GHOSTTRANS_PARTNUM) {
       GHOST_TRACE(fprintf(stderr, "%d: reallocating cell %p to size %d, assigned to node %d\n",
@@ -253,21 +269,21 @@ void put_recv_buffer(GhostCommunication *gc, int data_parts)
     }
   }
 #ifdef ADDITIONAL_CHECKS
-  if (retrieve - r_buffer != n_r_buffer) {
-    fprintf(stderr, "%d: recv buffer size %d differs from what I put in %d\n", this_node, n_r_buffer, retrieve - r_buffer);
+  if (retrieve - buffer != n_buffer) {
+    fprintf(stderr, "%d: recv buffer size %d differs from what I put in %d\n", this_node, n_buffer, retrieve - buffer);
     errexit();
   }
 #endif
 }
 
-void add_forces_from_recv_buffer(GhostCommunication *gc)
+void add_forces_from_recv_buffer(GhostCommunication *gc, char *buffer, int n_buffer)
 {
   int pl, p, np;
   Particle *part, *pt;
   char *retrieve;
 
   /* put back data */
-  retrieve = r_buffer;
+  retrieve = buffer;
   for (pl = 0; pl < gc->n_part_lists; pl++) {
     np   = gc->part_lists[pl]->n;
     part = gc->part_lists[pl]->part;
@@ -278,8 +294,8 @@ void add_forces_from_recv_buffer(GhostCommunication *gc)
     }
   }
 #ifdef ADDITIONAL_CHECKS
-  if (retrieve - r_buffer != n_r_buffer) {
-    fprintf(stderr, "%d: recv buffer size %d differs from what I put in %d\n", this_node, n_r_buffer, retrieve - r_buffer);
+  if (retrieve - buffer != n_buffer) {
+    fprintf(stderr, "%d: recv buffer size %d differs from what I put in %d\n", this_node, n_buffer, retrieve - buffer);
     errexit();
   }
 #endif
@@ -359,12 +375,132 @@ static int is_recv_op(int comm_type, int node)
 	  (comm_type == GHOST_RDCE && node == this_node));
 }
 
+/** (re)create the persistent request of a send or receive operation
+    if the size of the transfer has changed since the last call. */
+static void update_persistent_request(GhostCommunication *gcn, int comm_type, int data_parts)
+{
+  int n_buffer = calc_transmit_size(gcn, data_parts);
+
+  if (n_buffer == gcn->n_buffer)
+    return;
+
+  GHOST_TRACE(fprintf(stderr, "%d: ghost_comm new persistent request with %d, size %d\n", this_node, gcn->node, n_buffer));
+
+  if (gcn->n_buffer >= 0)
+    MPI_Request_free(&gcn->request);
+  /* the buffer is bound to the request, so it may only be reallocated here */
+  gcn->buffer = realloc(gcn->buffer, n_buffer);
+  gcn->n_buffer = n_buffer;
+  if (comm_type == GHOST_SEND)
+    MPI_Send_init(gcn->buffer, n_buffer, MPI_BYTE, gcn->node, REQ_GHOST_SEND, MPI_COMM_WORLD, &gcn->request);
+  else
+    MPI_Recv_init(gcn->buffer, n_buffer, MPI_BYTE, gcn->node, REQ_GHOST_SEND, MPI_COMM_WORLD, &gcn->request);
+}
+
+/** write back received data of a persistent receive operation. */
+static void store_persistent_recv(GhostCommunication *gcn, int data_parts)
+{
+  if (data_parts == GHOSTTRANS_FORCE)
+    add_forces_from_recv_buffer(gcn, gcn->buffer, gcn->n_buffer);
+  else
+    put_recv_buffer(gcn, data_parts, gcn->buffer, gcn->n_buffer);
+}
+
+/** Variant of \ref ghost_communicator for communicators which have
+    \ref GhostCommunicator::persistent set. Since every send and
+    receive has its own buffer, all receives can be posted in the
+    beginning, and sends are only waited for in the end. The order in
+    which data is packed and unpacked, including prefetches and
+    poststores, is the same as for the blocking communication, so that
+    data received in one round can still be forwarded in the next. */
+static void ghost_communicator_persistent(GhostCommunicator *gc)
+{
+  MPI_Status status;
+  int n, n2;
+  int data_parts = gc->data_parts;
+
+  GHOST_TRACE(fprintf(stderr, "%d: ghost_comm %p persistent, data_parts %d\n", this_node, gc, data_parts));
+
+  /* check the requests and post all receives. Messages from the same
+     node are matched in the order of the receives, which is the order
+     of the rounds, exactly as for the blocking communication. */
+  for (n = 0; n < gc->num; n++) {
+    GhostCommunication *gcn = &gc->comm[n];
+    int comm_type = gcn->type & GHOST_JOBMASK;
+    if (comm_type == GHOST_LOCL)
+      continue;
+    update_persistent_request(gcn, comm_type, data_parts);
+    if (comm_type == GHOST_RECV)
+      MPI_Start(&gcn->request);
+  }
+
+  for (n = 0; n < gc->num; n++) {
+    GhostCommunication *gcn = &gc->comm[n];
+    int comm_type = gcn->type & GHOST_JOBMASK;
+    int prefetch  = gcn->type & GHOST_PREFETCH;
+    int poststore = gcn->type & GHOST_PSTSTORE;
+
+    GHOST_TRACE(fprintf(stderr, "%d: ghost_comm round %d, job %x\n", this_node, n, gc->comm[n].type));
+    switch (comm_type) {
+    case GHOST_LOCL:
+      cell_cell_transfer(gcn, data_parts);
+      break;
+    case GHOST_SEND:
+      if (!prefetch)
+	fill_send_buffer(gcn, data_parts, gcn->buffer, gcn->n_buffer);
+      MPI_Start(&gcn->request);
+      /* write back delayed data from the last recv */
+      if (poststore) {
+	for (n2 = n-1; n2 >= 0; n2--) {
+	  GhostCommunication *gcn2 = &gc->comm[n2];
+	  if ((gcn2->type & GHOST_JOBMASK) == GHOST_RECV && (gcn2->type & GHOST_PSTSTORE)) {
+	    store_persistent_recv(gcn2, data_parts);
+	    break;
+	  }
+	}
+      }
+      break;
+    case GHOST_RECV:
+      /* prepare the next send with prefetch */
+      if (prefetch) {
+	for (n2 = n+1; n2 < gc->num; n2++) {
+	  GhostCommunication *gcn2 = &gc->comm[n2];
+	  if ((gcn2->type & GHOST_JOBMASK) == GHOST_SEND && (gcn2->type & GHOST_PREFETCH)) {
+	    fill_send_buffer(gcn2, data_parts, gcn2->buffer, gcn2->n_buffer);
+	    break;
+	  }
+	}
+      }
+      MPI_Wait(&gcn->request, &status);
+      if (!poststore)
+	store_persistent_recv(gcn, data_parts);
+      break;
+    default:
+      fprintf(stderr, "%d: INTERNAL ERROR: ghost communication type %d cannot use persistent requests\n",
+	      this_node, comm_type);
+      errexit();
+    }
+  }
+
+  /* the send buffers are reused in the next call */
+  for (n = 0; n < gc->num; n++) {
+    GhostCommunication *gcn = &gc->comm[n];
+    if ((gcn->type & GHOST_JOBMASK) == GHOST_SEND)
+      MPI_Wait(&gcn->request, &status);
+  }
+}
+
 void ghost_communicator(GhostCommunicator *gc)
 {
   MPI_Status status;
   int n, n2;
   int data_parts = gc->data_parts;
 
+  if (gc->persistent) {
+    ghost_communicator_persistent(gc);
+    return;
+  }
+
   GHOST_TRACE(fprintf(stderr, "%d: ghost_comm %p, data_parts %d\n", this_node, gc, data_parts));
 
   for (n = 0; n < gc->num; n++) {
@@ -451,9 +587,9 @@ void ghost_communicator(GhostCommunicator *gc)
 	  /* forces have to be added, the rest overwritten. Exception is RDCE, where the addition
 	     is integrated into the communication. */
 	  if (data_parts == GHOSTTRANS_FORCE && comm_type != GHOST_RDCE)
-	    add_forces_from_recv_buffer(gcn);
+	    add_forces_from_recv_buffer(gcn, r_buffer, n_r_buffer);
 	  else
-	    put_recv_buffer(gcn, data_parts);
+	    put_recv_buffer(gcn, data_parts, r_buffer, n_r_buffer);
 	}
 	else {
 	  GHOST_TRACE(fprintf(stderr, "%d: ghost_comm delaying operation %d, recv from %d\n", this_node, n, node));
@@ -478,9 +614,9 @@ void ghost_communicator(GhostCommunicator *gc)
 #endif
 	      /* as above */
 	      if (data_parts == GHOSTTRANS_FORCE && comm_type != GHOST_RDCE)
-		add_forces_from_recv_buffer(gcn2);
+		add_forces_from_recv_buffer(gcn2, r_buffer, n_r_buffer);
 	      else
-		put_recv_buffer(gcn2, data_parts);
+		put_recv_buffer(gcn2, data_parts, r_buffer, n_r_buffer);
 	      break;
 	    }
 	  }
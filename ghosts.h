@@ -145,6 +145,15 @@ typedef struct {
   /** if \ref GhostCommunicator::data_parts has \ref GHOSTTRANS_POSSHFTD, then this is the shift vector.
       Normally this a integer multiple of the box length. The shift is done on the sender side */
   double shift[3];
+
+  /** persistent MPI request for \ref GHOST_SEND and \ref GHOST_RECV,
+      only used if \ref GhostCommunicator::persistent is set. */
+  MPI_Request request;
+  /** transfer buffer the persistent request is bound to. */
+  char *buffer;
+  /** size of the transfer in bytes that the persistent request was
+      created for, or -1 if there is no request yet. */
+  int n_buffer;
 } GhostCommunication;
 
 /** Properties for a ghost communication. A ghost communication is defined */
@@ -159,6 +168,14 @@ typedef struct {
   /** List of ghost communications. */
   GhostCommunication *comm;
 
+  /** if set, point-to-point transfers use persistent MPI requests
+      with separate buffers per communication. The requests are only
+      recreated if the number of particles to transfer changes, and
+      all receives are posted in advance. Only reasonable for
+      communicators that are called many times between two particle
+      resorts, like the position update and the force collection. */
+  int persistent;
+
 } GhostCommunicator;
 
 /*@}*/
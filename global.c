@@ -25,6 +25,7 @@
 #include "forces.h"
 #include "verlet.h"
 #include "p3m.h"
+#include "fft.h"
 #include "imd.h"
 #include "tuning.h"
 #include "domain_decomposition.h"
@@ -90,6 +91,10 @@ const Datafield fields[] = {
   {&dpd_twf,            TYPE_INT, 1, "dpd_twf",    ro_callback,     6 },         /* 40 from thermostat.c */
   {&dpd_wf,             TYPE_INT, 1, "dpd_wf",    ro_callback,     5 },         /* 41 from thermostat.c */
   {adress_vars,      TYPE_DOUBLE, 7, "adress_vars",ro_callback,  1 },         /* 42  from adresso.c */
+  {&dd_sort_interval,   TYPE_INT, 1, "sort_interval", sort_interval_callback, 2 }, /* 43 from domain_decomposition.c */
+  {&fft_use_alltoall,   TYPE_INT, 1, "fft_alltoall", fft_alltoall_callback, 5 }, /* 44 from fft.c */
+  {&fft_kspace_nodes,   TYPE_INT, 1, "fft_nodes", fft_nodes_callback, 5 }, /* 45 from fft.c */
+  {&respa_steps,        TYPE_INT, 1, "respa_steps", ro_callback,     3 },        /* 46 from integrate.c */
   { NULL, 0, 0, NULL, NULL, 0 }
 };
 
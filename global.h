@@ -160,6 +160,14 @@ extern const Datafield fields[];
 #define FIELD_DPD_WF           41
 /** index of \ref address_var in \ref #fields */
 #define FIELD_ADRESS           42
+/** index of \ref dd_sort_interval in \ref #fields */
+#define FIELD_SORTINTERVAL     43
+/** index of \ref fft_use_alltoall in \ref #fields */
+#define FIELD_FFTALLTOALL      44
+/** index of \ref fft_kspace_nodes in \ref #fields */
+#define FIELD_FFTNODES         45
+/** index of \ref respa_steps in \ref #fields */
+#define FIELD_RESPASTEPS       46
 /*@}*/
 
 /**********************************************
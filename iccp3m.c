@@ -59,6 +59,7 @@ CellPList me_do_ghosts_icc;
 
 /* other icc*  functions */
 static int parse_vector(Tcl_Interp *interp,int normal_args, char *string, int flag);
+static void iccp3m_alloc_history();
 int imod(int x,int y);
 void iccp3m_revive_forces();
 void iccp3m_store_forces();
@@ -66,6 +67,31 @@ void iccp3m_store_forces();
 /** Granularity of the verlet list */
 #define LIST_INCREMENT 20
 
+/** Maximal number of previous iterates used for Anderson mixing */
+#define ICCP3M_MAX_MIXING 20
+
+/** \name Anderson mixing and extrapolation of the induced charges.
+    The surface charge densities are stored by the id of the surface element,
+    only the entries of the local elements are used. */
+/*@{*/
+/** number of surface elements the arrays are allocated for */
+static int icc_n_alloc = 0;
+/** densities and target densities (i. e. fixed point map) of the current iterate */
+static double *icc_x = NULL, *icc_g = NULL;
+/** densities and residuals of the previous iterate */
+static double *icc_x_old = NULL, *icc_f_old = NULL;
+/** differences of the densities and residuals of the last iterates,
+    a ring buffer of \ref iccp3m_struct::mixing columns */
+static double *icc_dx = NULL, *icc_df = NULL;
+/** ids of the local surface elements */
+static int *icc_local_ids = NULL;
+static int icc_n_local = 0;
+/** converged densities of the last iterations, newest first, on all nodes */
+static double *icc_prev[3] = { NULL, NULL, NULL };
+/** number of valid entries in icc_prev */
+static int icc_n_prev = 0;
+/*@}*/
+
 void iccp3m_init(void){
    iccp3m_cfg.set_flag=0;
    iccp3m_cfg.areas = NULL;
@@ -79,27 +105,53 @@ void iccp3m_init(void){
    iccp3m_cfg.fx = NULL;
    iccp3m_cfg.fy = NULL;
    iccp3m_cfg.fz = NULL;
+   iccp3m_cfg.mixing = 5;
+   iccp3m_cfg.extrapolation = 1;
 }
 
 /** Parses the ICCP3M command.
  */
 int iccp3m(ClientData data, Tcl_Interp *interp, int argc, char **argv) {
-  int last_ind_id,num_iteration,normal_args,area_args;
+  int last_ind_id,num_iteration,normal_args,area_args,value;
   char buffer[TCL_DOUBLE_SPACE];
   double e1,convergence,relax;
 
-  Tcl_AppendResult(interp, "The ICCP3M algorithm is still experimental. Function can not be guaranteed, therefore it is still disabled.\n", (char *)NULL);
-  return (TCL_ERROR);
-
   if(iccp3m_initialized==0){
       iccp3m_init();
       iccp3m_initialized=1;
   }
 
-  if(argc != 9 && argc != 2 && argc != 10) { 
-         Tcl_AppendResult(interp, "Wrong # of args! Usage: iccp3m { iterate | <last_ind_id> <e1> <num_iteration> <convergence> <relaxation> <area> <normal_components> <e_in/e_out>  [<ext_field>] }", (char *)NULL); 
+  if(argc != 9 && argc != 2 && argc != 10 && argc != 3) { 
+         Tcl_AppendResult(interp, "Wrong # of args! Usage: iccp3m { iterate | mixing <m> | extrapolation <order> | <last_ind_id> <e1> <num_iteration> <convergence> <relaxation> <area> <normal_components> <e_in/e_out>  [<ext_field>] }", (char *)NULL); 
          return (TCL_ERROR); 
    }
+   if (argc == 3) {
+      if(ARG_IS_S(1,"mixing")) {
+         if(!ARG_IS_I(2, value) || value < 0 || value > ICCP3M_MAX_MIXING) {
+            Tcl_ResetResult(interp);
+            sprintf(buffer, "%d", ICCP3M_MAX_MIXING);
+            Tcl_AppendResult(interp, "Number of mixed iterates must be an integer between 0 and ", buffer, " (got: ", argv[2],")!", (char *)NULL);
+            return (TCL_ERROR);
+         }
+         iccp3m_cfg.mixing = value;
+      }
+      else if(ARG_IS_S(1,"extrapolation")) {
+         if(!ARG_IS_I(2, value) || value < 0 || value > 2) {
+            Tcl_ResetResult(interp);
+            Tcl_AppendResult(interp, "Extrapolation order must be 0, 1 or 2 (got: ", argv[2],")!", (char *)NULL);
+            return (TCL_ERROR);
+         }
+         iccp3m_cfg.extrapolation = value;
+      }
+      else {
+         Tcl_AppendResult(interp, "Unknown iccp3m option ", argv[1], (char *)NULL);
+         return (TCL_ERROR);
+      }
+      /* the parameters are broadcast with the surface, if it is not set up yet */
+      if (iccp3m_cfg.set_flag)
+         mpi_iccp3m_init(0);
+      return TCL_OK;
+   }
    if (argc == 2 ){
       if(ARG_IS_S(1,"iterate")) { 
            if (iccp3m_cfg.set_flag==0) {
@@ -107,7 +159,9 @@ int iccp3m(ClientData data, Tcl_Interp *interp, int argc, char **argv) {
                  return (TCL_ERROR);
            }
            else{ 
-              Tcl_PrintDouble(interp,mpi_iccp3m_iteration(0),buffer); 
+              if (mpi_iccp3m_iteration(0))
+                return mpi_gather_runtime_errors(interp, TCL_OK);
+              sprintf(buffer, "%d", iccp3m_cfg.citeration);
               Tcl_AppendResult(interp, buffer, (char *) NULL);
               return TCL_OK;
 	   }
@@ -187,7 +241,9 @@ int iccp3m(ClientData data, Tcl_Interp *interp, int argc, char **argv) {
        }
       
        mpi_iccp3m_init(0);
-       Tcl_PrintDouble(interp,mpi_iccp3m_iteration(0),buffer); 
+       if (mpi_iccp3m_iteration(0))
+         return mpi_gather_runtime_errors(interp, TCL_OK);
+       sprintf(buffer, "%d", iccp3m_cfg.citeration);
        Tcl_AppendResult(interp, buffer, (char *) NULL);
        return TCL_OK;
    } /* else (argc==10) */
@@ -221,6 +277,8 @@ int bcast_iccp3m_cfg(void){
   MPI_Bcast((double*)&iccp3m_cfg.eout, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
   MPI_Bcast((double*)&iccp3m_cfg.relax, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
   MPI_Bcast((int*)&iccp3m_cfg.update, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&iccp3m_cfg.mixing, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&iccp3m_cfg.extrapolation, 1, MPI_INT, 0, MPI_COMM_WORLD);
   
   /* broadcast the vectors element by element. This is slow
    * but safe and only performed at the beginning of each simulation*/
@@ -235,20 +293,167 @@ int bcast_iccp3m_cfg(void){
     MPI_Bcast((double*)&iccp3m_cfg.extz[i], 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
   }
 
-  MPI_Bcast(&iccp3m_cfg.citeration, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-  MPI_Bcast(&iccp3m_cfg.set_flag, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&iccp3m_cfg.citeration, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&iccp3m_cfg.set_flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  iccp3m_alloc_history();
 
   printf("node %d: no iterations: %d\n", this_node, iccp3m_cfg.num_iteration);
   return 0 ;
     
 }
 
+/** (re)allocate the arrays for the mixing and the extrapolation, which
+    also discards the previous solutions. */
+static void iccp3m_alloc_history()
+{
+  int i, n = iccp3m_cfg.last_ind_id + 1, m = iccp3m_cfg.mixing;
+
+  icc_n_alloc   = n;
+  icc_x         = (double *) realloc(icc_x, n*sizeof(double));
+  icc_g         = (double *) realloc(icc_g, n*sizeof(double));
+  icc_x_old     = (double *) realloc(icc_x_old, n*sizeof(double));
+  icc_f_old     = (double *) realloc(icc_f_old, n*sizeof(double));
+  icc_dx        = (double *) realloc(icc_dx, (m > 0 ? m : 1)*n*sizeof(double));
+  icc_df        = (double *) realloc(icc_df, (m > 0 ? m : 1)*n*sizeof(double));
+  icc_local_ids = (int *)    realloc(icc_local_ids, n*sizeof(int));
+  for (i = 0; i < 3; i++)
+    icc_prev[i] = (double *) realloc(icc_prev[i], n*sizeof(double));
+  icc_n_prev = 0;
+}
+
+/** set the start values of the induced charges by polynomial extrapolation
+    from the results of the previous iterations. */
+static void iccp3m_extrapolate_charges()
+{
+  Cell *cell;
+  Particle *part;
+  int c, np, i, id, order;
+  double h;
+
+  order = iccp3m_cfg.extrapolation;
+  if (order > icc_n_prev - 1) order = icc_n_prev - 1;
+  if (order < 1) return;
+
+  for(c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    part = cell->part;
+    np   = cell->n;
+    for(i=0 ; i < np; i++) {
+      id = part[i].p.identity;
+      if(id > iccp3m_cfg.last_ind_id) continue;
+      if (order == 1)
+	h = 2*icc_prev[0][id] - icc_prev[1][id];
+      else
+	h = 3*icc_prev[0][id] - 3*icc_prev[1][id] + icc_prev[2][id];
+      part[i].p.q = h*iccp3m_cfg.areas[id];
+    }
+  }
+}
+
+/** keep the converged surface charge densities for the extrapolation.
+    The densities are collected on all nodes, since the surface elements
+    may change the node until the next iteration. */
+static void iccp3m_store_solution()
+{
+  Cell *cell;
+  Particle *part;
+  int c, np, i, id;
+  double *tmp;
+
+  if (iccp3m_cfg.extrapolation == 0) return;
+
+  tmp = icc_prev[2];
+  icc_prev[2] = icc_prev[1];
+  icc_prev[1] = icc_prev[0];
+  icc_prev[0] = tmp;
+  
+  memset(icc_x, 0, icc_n_alloc*sizeof(double));
+  for(c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    part = cell->part;
+    np   = cell->n;
+    for(i=0 ; i < np; i++) {
+      id = part[i].p.identity;
+      if(id <= iccp3m_cfg.last_ind_id)
+	icc_x[id] = part[i].p.q/iccp3m_cfg.areas[id];
+    }
+  }
+  MPI_Allreduce(icc_x, icc_prev[0], icc_n_alloc, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  if (icc_n_prev < 3) icc_n_prev++;
+}
+
+/** Anderson mixing: update the differences of the last iterates and
+    determine the coefficients gamma, which minimize the norm of the
+    residual f - sum_a gamma_a df_a over the last iterates. The densities
+    and target densities of iterate k have to be in icc_x and icc_g.
+    @return the number of coefficients, i. e. of columns in icc_dx and icc_df.
+*/
+static int iccp3m_anderson_coefficients(int k, double *gamma)
+{
+  int m = iccp3m_cfg.mixing, n = icc_n_alloc;
+  int nc, col, a, b, l, id;
+  int perms[ICCP3M_MAX_MIXING];
+  double f, *A[ICCP3M_MAX_MIXING];
+  double sum[ICCP3M_MAX_MIXING*(ICCP3M_MAX_MIXING+1)], gsum[ICCP3M_MAX_MIXING*(ICCP3M_MAX_MIXING+1)];
+  double reg;
+
+  if (m == 0) return 0;
+
+  /* update the differences to the previous iterate */
+  col = (k - 1) % m;
+  for (l = 0; l < icc_n_local; l++) {
+    id = icc_local_ids[l];
+    f  = icc_g[id] - icc_x[id];
+    if (k > 0) {
+      icc_dx[col*n + id] = icc_x[id] - icc_x_old[id];
+      icc_df[col*n + id] = f - icc_f_old[id];
+    }
+    icc_x_old[id] = icc_x[id];
+    icc_f_old[id] = f;
+  }
+
+  nc = (k < m) ? k : m;
+  if (nc == 0) return 0;
+
+  /* normal equations of the least squares problem, the first nc*nc
+     entries are the matrix, the last nc the right hand side */
+  for (a = 0; a < nc*(nc+1); a++) sum[a] = 0;
+  for (l = 0; l < icc_n_local; l++) {
+    id = icc_local_ids[l];
+    for (a = 0; a < nc; a++) {
+      for (b = 0; b <= a; b++)
+	sum[a*nc + b] += icc_df[a*n + id]*icc_df[b*n + id];
+      sum[nc*nc + a] += icc_df[a*n + id]*icc_f_old[id];
+    }
+  }
+  MPI_Allreduce(sum, gsum, nc*(nc+1), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+  /* small regularization, since the differences become almost linearly
+     dependent close to convergence */
+  reg = 0;
+  for (a = 0; a < nc; a++) if (gsum[a*nc + a] > reg) reg = gsum[a*nc + a];
+  reg *= 1e-10;
+  if (reg == 0) return 0;
+  for (a = 0; a < nc; a++) {
+    A[a] = &gsum[a*nc];
+    for (b = 0; b < a; b++) A[b][a] = A[a][b];
+    A[a][a] += reg;
+    gamma[a] = gsum[nc*nc + a];
+  }
+  if (lu_decompose_matrix(A, nc, perms) != 0) return 0;
+  lu_solve_system(A, nc, perms, gamma);
+
+  return nc;
+}
+
 int iccp3m_iteration() {
-   double fdot,hold,hnew,hmax,del_eps,diff=0.0,difftemp=0.0,qold, ex, ey, ez, l_b;
+   double fdot,hold,hnew,hmax,del_eps,diff=0.0,difftemp=0.0, ex, ey, ez, l_b;
+   double gamma[ICCP3M_MAX_MIXING];
    Cell *cell;
    int c,np;
    Particle *part;
-   int i, j,id;
+   int i, j, id, a, nc;
    char* errtxt;
    double globalmax;
 
@@ -258,12 +463,17 @@ int iccp3m_iteration() {
 	    ERROR_SPRINTF(errtxt, "ICCP3M: nonpositive dielectric constant is not allowed. Put a decent tcl error here\n");
    }
 
-   
+   if (icc_n_alloc != iccp3m_cfg.last_ind_id + 1)
+     iccp3m_alloc_history();
+
+   iccp3m_extrapolate_charges();
+
    iccp3m_cfg.citeration=0;
    for(j=0;j<iccp3m_cfg.num_iteration;j++) {
        hmax=0.;
        force_calc_iccp3m(); /* Calculate electrostatic forces (SR+LR) excluding source source interaction*/
-       diff=0;
+       /* determine the new target charge densities */
+       icc_n_local = 0;
        for(c = 0; c < local_cells.n; c++) {
             cell = local_cells.cell[c];
             part = cell->part;
@@ -292,13 +502,32 @@ int iccp3m_iteration() {
                              ey*iccp3m_cfg.nvectory[id]+
                              ez*iccp3m_cfg.nvectorz[id];
 
-           /* recalculate the old charge density */
-                      hold=part[i].p.q/iccp3m_cfg.areas[id];
-                      qold=part[i].p.q;
+                      icc_local_ids[icc_n_local++] = id;
+                      icc_x[id] = part[i].p.q/iccp3m_cfg.areas[id];
+                      icc_g[id] = del_eps*fdot/l_b;
+                 }
+            }
+       }
+
+       nc = iccp3m_anderson_coefficients(j, gamma);
+
+       diff=0;
+       for(c = 0; c < local_cells.n; c++) {
+            cell = local_cells.cell[c];
+            part = cell->part;
+            np   = cell->n;
+            for(i=0 ; i < np; i++) {
+                id = part[i].p.identity ;
+                if( id <= iccp3m_cfg.last_ind_id) {
+           /* the old charge density */
+                      hold=icc_x[id];
           /* determine if it is higher than the previously highest charge density */            
                       if(hold>fabs(hmax))hmax=fabs(hold); 
 
-                      hnew=(1.-iccp3m_cfg.relax)*hold + (iccp3m_cfg.relax)*del_eps*fdot/l_b;
+                      hnew=(1.-iccp3m_cfg.relax)*hold + (iccp3m_cfg.relax)*icc_g[id];
+          /* Anderson mixing with the previous iterates */
+                      for (a = 0; a < nc; a++)
+                        hnew -= gamma[a]*(icc_dx[a*icc_n_alloc + id] + iccp3m_cfg.relax*icc_df[a*icc_n_alloc + id]);
                       difftemp=fabs( 2.*(hnew - hold)/(hold+hnew) ); /* relative variation: never use 
                                                                               an estimator which can be negative
                                                                               here */
@@ -327,13 +556,16 @@ int iccp3m_iteration() {
 
        if (globalmax < iccp3m_cfg.convergence) 
          break; 
-       if ( diff > 1e89 ) /* Error happened */
-         return iccp3m_cfg.citeration++;
+       if ( globalmax > 1e89 ) { /* Error happened */
+         icc_n_prev = 0;
+         return iccp3m_cfg.citeration;
+       }
 
   } /* iteration */
 
+  iccp3m_store_solution();
   on_particle_change();
-  return iccp3m_cfg.citeration++;
+  return iccp3m_cfg.citeration;
 }
 
 void force_calc_iccp3m() {
@@ -680,6 +912,10 @@ void calc_long_range_forces_iccp3m()
                 errtxt = runtime_error(128);
                 ERROR_SPRINTF(errtxt, "{ICCP3M implemented only for MMM1D,MMM2D,ELC or P3M ");
      }
+  if (coulomb.method == COULOMB_MMM1D && mmm1d_params.tree_theta > 0) {
+                errtxt = runtime_error(128);
+                ERROR_SPRINTF(errtxt, "{ICCP3M does not work with the MMM1D tree ");
+     }
   switch (coulomb.method) {
 #ifdef ELC_P3M
     case COULOMB_ELC_P3M:
@@ -69,6 +69,8 @@ typedef struct {
   double *extx,*exty,*extz;             /* External field                              */
   int selection;                        /* by default it is not selected, WHO KNOWS WHAT THAT MEANS?*/
   double relax;                         /* relaxation parameter for iterative                       */
+  int mixing;                           /* number of previous iterates used for Anderson mixing, 0 = plain relaxation */
+  int extrapolation;                    /* order of the extrapolation of the start charges from previous runs */
   int update;                           /* iccp3m update interval, currently not used */
   double *fx,*fy,*fz;                   /* forces iccp3m will use*/ 
   int citeration ;                      /* current number of iterations*/
@@ -95,6 +97,13 @@ int bcast_iccp3m_cfg(void);
 
 
                  iterate         = Indicates that a previous surface discretization shall be used. T
+
+    Further forms: <br>
+                 mixing \<m\>   = Use the last \<m\> iterates for Anderson mixing of the induced charges 
+                                 (default 5). 0 gives the plain relaxation scheme.
+                 extrapolation \<order\> = Start each iteration from the induced charges of the previous 
+                                 iterations extrapolated with the given order 0, 1 or 2 (default 1). 0 starts
+                                 from the current charges.
 */
 int iccp3m(ClientData data, Tcl_Interp *interp, int argc, char **argv);
 
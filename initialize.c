@@ -277,6 +277,12 @@ void on_particle_change()
   rebuild_verletlist = 1;
 
   invalidate_obs();
+#ifdef ELP3M
+  P3M_invalidate_charge_cache();
+#endif
+#ifdef ELECTROSTATICS
+  EWALD_invalidate_structure_factors();
+#endif
 
   /* the particle information is no longer valid */
   freePartCfg();
@@ -479,6 +485,10 @@ void on_parameter_change(int field)
     on_parameter_change(FIELD_MAXRANGE);
   }
 
+  /* the stored forces contain the scaled long range impulse */
+  if (field == FIELD_RESPASTEPS)
+    recalc_forces = 1;
+
   if (field == FIELD_NODEGRID)
     grid_changed_n_nodes();
   if (field == FIELD_BOXL || field == FIELD_NODEGRID)
@@ -505,7 +515,8 @@ void on_parameter_change(int field)
       cc = 1;
     // fall through
   case COULOMB_P3M:
-    if (field == FIELD_TEMPERATURE || field == FIELD_NODEGRID || field == FIELD_SKIN)
+    if (field == FIELD_TEMPERATURE || field == FIELD_NODEGRID || field == FIELD_SKIN
+	|| field == FIELD_FFTNODES)
       cc = 1;
     else if (field == FIELD_BOXL) {
       P3M_scaleby_box_l_charges();
@@ -555,13 +566,20 @@ void on_parameter_change(int field)
        cc = 1;
       // fall through
     case DIPOLAR_P3M:
-      if (field == FIELD_TEMPERATURE || field == FIELD_NODEGRID || field == FIELD_SKIN)
+      if (field == FIELD_TEMPERATURE || field == FIELD_NODEGRID || field == FIELD_SKIN
+	  || field == FIELD_FFTNODES)
         cc = 1;
       else if (field == FIELD_BOXL) {
         P3M_scaleby_box_l_dipoles();
         integrate_vv_recalc_maxrange(); 
       }
       break;
+#endif
+#ifdef DIPOLAR_BARNES_HUT
+    case DIPOLAR_BH:
+      if (field == FIELD_TEMPERATURE)
+        cc = 1;
+      break;
 #endif
   default: break;
   }
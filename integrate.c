@@ -72,6 +72,13 @@ int    recalc_forces    = 1;
 
 double verlet_reuse     = 0.0;
 
+int    respa_steps      = 1;
+int    respa_step       = 0;
+
+/** set by \ref integrate_vv if \ref rescale_forces_propagate_vel_pos
+    can be used, see \ref check_fused_sweep. */
+static int use_fused_sweep = 0;
+
 #ifdef ADDITIONAL_CHECKS
 double db_max_force = 0.0, db_max_vel = 0.0;
 int    db_maxf_id   = 0,   db_maxv_id = 0;
@@ -98,6 +105,16 @@ void propagate_vel_pos();
     Integration step 4 of the Velocity Verletintegrator:<br> 
     \f[ v(t+\Delta t) = v(t+0.5 \Delta t) + 0.5 \Delta t f(t+\Delta t) \f] */
 void rescale_forces_propagate_vel();
+/** Step 4 of one step of the Velocity Verlet integrator fused with the
+    steps 1 and 2 of the next one, for NVT without fixed coordinates:<br>
+    \f[ v(t+1.5 \Delta t) = v(t+0.5 \Delta t) + \Delta t f(t+\Delta t) \f] <br>
+    \f[ p(t+2\Delta t) = p(t+\Delta t) + \Delta t  v(t+1.5 \Delta t) \f] <br>
+    The forces are rescaled as in \ref rescale_forces_propagate_vel, and the
+    Verlet criterion is checked like in \ref propagate_vel_pos. */
+void rescale_forces_propagate_vel_pos();
+/** Determine whether \ref rescale_forces_propagate_vel_pos can be used
+    instead of the separate steps for the current integration. */
+void check_fused_sweep();
 
 /** Integrator stability check (see compile flag ADDITIONAL_CHECKS). */
 void force_and_velocity_check(Particle *p); 
@@ -127,7 +144,7 @@ int integrate_usage(Tcl_Interp *interp)
   Tcl_AppendResult(interp, "Usage of tcl-command integrate:\n", (char *)NULL);
   Tcl_AppendResult(interp, "'integrate <INT n steps>' for integrating n steps \n", (char *)NULL);
   Tcl_AppendResult(interp, "'integrate set' for printing integrator status \n", (char *)NULL);
-  Tcl_AppendResult(interp, "'integrate set nvt' for enabling NVT integration or \n" , (char *)NULL);
+  Tcl_AppendResult(interp, "'integrate set nvt [respa <INT steps>]' for enabling NVT integration, optionally with the long range forces evaluated every <steps> steps, or \n" , (char *)NULL);
 #ifdef NPT
   Tcl_AppendResult(interp, "'integrate set npt_isotropic <DOUBLE p_ext> [<DOUBLE piston>] [<INT, INT, INT system_geometry>] [-cubic_box]' for enabling isotropic NPT integration \n" , (char *)NULL);
 #endif
@@ -141,7 +158,12 @@ int integrate_print_status(Tcl_Interp *interp)
   char buffer[TCL_INTEGER_SPACE+TCL_DOUBLE_SPACE];
   switch (integ_switch) {
   case INTEG_METHOD_NVT:
-    Tcl_AppendResult(interp, "{ set nvt }", (char *)NULL);
+    if (respa_steps > 1) {
+      sprintf(buffer, "%d", respa_steps);
+      Tcl_AppendResult(interp, "{ set nvt respa ", buffer, " }", (char *)NULL);
+    }
+    else
+      Tcl_AppendResult(interp, "{ set nvt }", (char *)NULL);
     return (TCL_OK);
   case INTEG_METHOD_NPT_ISO:
     Tcl_PrintDouble(interp, nptiso.p_ext, buffer);
@@ -170,8 +192,19 @@ int integrate_print_status(Tcl_Interp *interp)
 /** Parse integrate nvt command */
 int integrate_parse_nvt(Tcl_Interp *interp, int argc, char **argv)
 {
+  int steps = 1;
+
+  if (argc > 3) {
+    if (argc != 5 || !ARG_IS_S(3, "respa") || !ARG_IS_I(4, steps) || steps < 1) {
+      Tcl_AppendResult(interp, "respa expects a positive number of steps \n", (char *)NULL);
+      return integrate_usage(interp);
+    }
+  }
+
   integ_switch = INTEG_METHOD_NVT;
   mpi_bcast_parameter(FIELD_INTEG_SWITCH);
+  respa_steps = steps;
+  mpi_bcast_parameter(FIELD_RESPASTEPS);
   return (TCL_OK);
 }
 
@@ -265,9 +298,12 @@ int integrate_parse_npt_isotropic(Tcl_Interp *interp, int argc, char **argv)
     return (TCL_ERROR);
   }
 
-  /* set integrator switch */
+  /* set integrator switch. The pressure needs the long range virial
+     in every step, so no multiple time stepping. */
   integ_switch = INTEG_METHOD_NPT_ISO;
   mpi_bcast_parameter(FIELD_INTEG_SWITCH);
+  respa_steps = 1;
+  mpi_bcast_parameter(FIELD_RESPASTEPS);
 
   /* broadcast npt geometry information to all nodes */
   mpi_bcast_nptiso_geom();
@@ -395,6 +431,8 @@ void integrate_vv(int n_steps)
 #endif
 
    
+   /* the first step of a RESPA cycle */
+   respa_step = 0;
    force_calc();
    
    //VIRTUAL_SITES distribute forces
@@ -427,6 +465,8 @@ void integrate_vv(int n_steps)
   if (check_runtime_errors())
     return;
 
+  check_fused_sweep();
+
   n_verlet_updates = 0;
 
   /* Integration loop */
@@ -449,8 +489,9 @@ void integrate_vv(int n_steps)
     */
     if(integ_switch == INTEG_METHOD_NPT_ISO || nemd_method != NEMD_METHOD_OFF) {
       propagate_vel();  propagate_pos(); }
-    else
+    else if(!use_fused_sweep || i == 0)
       propagate_vel_pos();
+    /* otherwise already done by rescale_forces_propagate_vel_pos */
 #ifdef ROTATION
     propagate_omega_quat();
 #endif
@@ -493,6 +534,8 @@ void integrate_vv(int n_steps)
     transfer_momentum = 1;
 #endif
 
+    if (++respa_step >= respa_steps)
+      respa_step = 0;
     force_calc();
 
 //VIRTUAL_SITES distribute forces
@@ -515,8 +558,14 @@ void integrate_vv(int n_steps)
       break;
 
     /* Integration Step: Step 4 of Velocity Verlet scheme:
-       v(t+dt) = v(t+0.5*dt) + 0.5*dt * f(t+dt) */
-    rescale_forces_propagate_vel();
+       v(t+dt) = v(t+0.5*dt) + 0.5*dt * f(t+dt)
+       If possible, fused with step 1 and 2 of the next step, except
+       for the last step, so that the velocities are synchronized at
+       the end. */
+    if(use_fused_sweep && i < n_steps - 1)
+      rescale_forces_propagate_vel_pos();
+    else
+      rescale_forces_propagate_vel();
 
 #ifdef LB
   if (lattice_switch & LATTICE_LB) lattice_boltzmann_update();
@@ -556,6 +605,10 @@ void integrate_vv(int n_steps)
     if(this_node==0) sim_time += time_step;
   }
 
+  /* the loop might have been left before the verlet criterion was
+     collected */
+  announce_rebuild_vlist_wait();
+
   /* after simulating the forces are necessarily set. Necessary since
      resort_particles sets recalc_forces to 1 */
   recalc_forces = 0;
@@ -724,6 +777,101 @@ void rescale_forces_propagate_vel()
 #endif
 }
 
+void check_fused_sweep()
+{
+  int fixed = 0;
+
+  use_fused_sweep = 0;
+
+  /* these need the synchronized velocities or positions after step 4 */
+#if !defined(VIRTUAL_SITES) && !defined(BOND_CONSTRAINT)
+  if(integ_switch != INTEG_METHOD_NVT || nemd_method != NEMD_METHOD_OFF)
+    return;
+#ifdef LB
+  if(lattice_switch & LATTICE_LB)
+    return;
+#endif
+#ifdef ELECTROSTATICS
+  if(coulomb.method == COULOMB_MAGGS)
+    return;
+#endif
+
+#ifdef EXTERNAL_FORCES
+  {
+    Cell *cell;
+    Particle *p;
+    int c, i, np, local_fixed = 0;
+    for (c = 0; c < local_cells.n; c++) {
+      cell = local_cells.cell[c];
+      p  = cell->part;
+      np = cell->n;
+      for(i = 0; i < np; i++)
+	if (p[i].l.ext_flag & COORDS_FIX_MASK)
+	  local_fixed = 1;
+    }
+    /* fixed particles might migrate here during the integration */
+    MPI_Allreduce(&local_fixed, &fixed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  }
+#endif
+
+  use_fused_sweep = !fixed;
+#endif
+
+  INTEG_TRACE(fprintf(stderr,"%d: check_fused_sweep: %d\n",this_node,use_fused_sweep));
+}
+
+void rescale_forces_propagate_vel_pos()
+{
+  Cell *cell;
+  Particle *p;
+  int i, np, c;
+  double scale, s;
+
+  INTEG_TRACE(fprintf(stderr,"%d: rescale_forces_propagate_vel_pos:\n",this_node));
+
+  scale = 0.5 * time_step * time_step;
+  rebuild_verletlist = 0;
+
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for(i = 0; i < np; i++) {
+      /* Rescale forces: f_rescaled = 0.5*dt*dt * f_calculated * (1/mass) */
+      s = scale/PMASS(p[i]);
+      p[i].f.f[0] *= s;
+      p[i].f.f[1] *= s;
+      p[i].f.f[2] *= s;
+
+      /* Propagate velocities by two half steps: v(t+1.5*dt) = v(t+0.5*dt) + dt * f(t+dt) */
+      p[i].m.v[0] += 2.0*p[i].f.f[0];
+      p[i].m.v[1] += 2.0*p[i].f.f[1];
+      p[i].m.v[2] += 2.0*p[i].f.f[2];
+
+      /* Propagate positions: p(t + 2*dt) = p(t + dt) + dt * v(t+1.5*dt) */
+      p[i].r.p[0] += p[i].m.v[0];
+      p[i].r.p[1] += p[i].m.v[1];
+      p[i].r.p[2] += p[i].m.v[2];
+
+      ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: PV_F v_new = (%.3e,%.3e,%.3e)\n",this_node,p[i].m.v[0],p[i].m.v[1],p[i].m.v[2]));
+      ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: PPOS p = (%.3f,%.3f,%.3f)\n",this_node,p[i].r.p[0],p[i].r.p[1],p[i].r.p[2]));
+
+#ifdef ADDITIONAL_CHECKS
+      force_and_velocity_check(&p[i]);
+#endif
+
+      /* Verlet criterion check, without a branch */
+      rebuild_verletlist |= (distance2(p[i].r.p,p[i].l.p_old) > skin2);
+    }
+  }
+
+  if(dd.use_vList) announce_rebuild_vlist_start();
+
+#ifdef ADDITIONAL_CHECKS
+  force_and_velocity_display();
+#endif
+}
+
 void finalize_p_inst_npt()
 {
 #ifdef NPT
@@ -973,7 +1121,9 @@ void propagate_vel_pos()
     }
   }
 
-  if(dd.use_vList) announce_rebuild_vlist();
+  /* the result is only needed in cells_update_ghosts, which overlaps
+     the reduction with the ghost position update */
+  if(dd.use_vList) announce_rebuild_vlist_start();
 
 #ifdef ADDITIONAL_CHECKS
   force_and_velocity_display();
@@ -58,6 +58,13 @@ extern int    recalc_forces;
     used. */
 extern double verlet_reuse;
 
+/** Number of integration steps per evaluation of the long range
+    electrostatic forces (r-RESPA). 1 means plain velocity Verlet. */
+extern int respa_steps;
+/** Position of the current force calculation within the \ref
+    respa_steps steps; the long range forces are calculated if 0. */
+extern int respa_step;
+
 /*@}*/
 
 /** \name Exported Functions */
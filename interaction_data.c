@@ -1411,6 +1411,10 @@ int inter_parse_dipolar(Tcl_Interp * interp, int argc, char ** argv)
   REGISTER_DIPOLAR("mdds", Dinter_parse_magnetic_dipolar_direct_sum);
 #endif
 
+#ifdef DIPOLAR_BARNES_HUT
+  REGISTER_DIPOLAR("bh", Dinter_parse_dipolar_bh);
+#endif
+
 
   /* fallback */
   coulomb.Dmethod  = DIPOLAR_NONE;
@@ -1736,6 +1740,9 @@ int printDipolarIAToResult(Tcl_Interp *interp)
  #endif
  #ifdef MAGNETIC_DIPOLAR_DIRECT_SUM
     case DIPOLAR_DS: printMagnetic_dipolar_direct_sum_ToResult(interp); break;
+#endif
+#ifdef DIPOLAR_BARNES_HUT
+    case DIPOLAR_BH: printDipolarBHToResult(interp); break;
 #endif
     default: break;
   }
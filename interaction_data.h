@@ -124,6 +124,8 @@
    #define DIPOLAR_DS  4
    /** Dipolar method is direct sum plus DLC. */
    #define DIPOLAR_MDLC_DS  5
+   /** Dipolar method is a Barnes-Hut tree without replicas */
+   #define DIPOLAR_BH  6
 
    /*@}*/
 #endif 
@@ -465,6 +467,19 @@ typedef struct {
 
 } Coulomb_parameters;
 
+#ifdef ELECTROSTATICS
+/** a trial change of one charge, as used for the incremental energy
+    of Monte Carlo moves, see \ref mpi_coulomb_energy_change. */
+typedef struct {
+  /** identity of the particle, -1 for an inserted charge. */
+  int identity;
+  /** current position and charge, a zero charge for an insertion. */
+  double old_pos[3], old_q;
+  /** trial position and charge, a zero charge for a deletion. */
+  double new_pos[3], new_q;
+} ChargeChange;
+#endif
+
 /*@}*/
 
 /** Defines parameters for a bonded interaction. */
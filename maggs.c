@@ -13,6 +13,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "utils.h"
 #include "global.h"
 #include "grid.h"
@@ -30,6 +33,9 @@
 /** Tag for communication in Maggs_init() -> calc_glue_patch(). */
 #define REQ_MAGGS_SPREAD 300
 #define REQ_MAGGS_EQUIL  301
+/** Tags for the overlapped surface exchange, one per direction
+    (\ref REQ_MAGGS_OVERLAP + direction). */
+#define REQ_MAGGS_OVERLAP 310
 
 #ifdef ELECTROSTATICS // later to remove!!!!
 
@@ -103,6 +109,9 @@ static double* Bfield;
 static double* psi;
 /** site neighbors */
 static t_dirs* neighbor;
+/** index offsets of the next site in positive x, y and z direction,
+    i. e. the strides of the local lattice. */
+static int lstride[SPACE_DIM];
 
 
 /** Array to store glue_patch data to send. */
@@ -167,17 +176,15 @@ MDINLINE int maggs_get_linear_index(int a, int b, int c, int adim[3])
   return (c + adim[2]*(b + adim[1]*a));
 }
 
-/*
- * The first index iz z!!!!
- */
-MDINLINE int get_offset(int index_shift, int index_base, int axes, int adim[3])
+/** index offsets from site \a index to its next neighbours in positive
+    x, y and z direction. At the upper boundary of the local lattice the
+    offset is the lattice volume, so that the resulting index is out of
+    range. */
+MDINLINE void get_neighbor_strides(int index, int help_index[3])
 {
-  int dif;
-  dif = index_shift - index_base;
-  if(axes <= 1) dif *= adim[2];
-  if(axes == 0) dif *= adim[1]; 
-  
-  return (dif);
+  int i;
+  FOR3D(i)
+    help_index[i] = (lattice[index].r[i] + 1 < lparam.dim[i]) ? lstride[i] : lparam.volume;
 }
 
 MDINLINE double interpol1D(double x)
@@ -216,39 +223,13 @@ MDINLINE void calc_directions(int j, int* dir1, int*dir2)
   }  
 }
 
-MDINLINE double calc_dual_curl(int mue, int nue, int* neighbor, int index)
-{
-  /*****************************************/
-  /* calculation of the plaquette lying    */
-  /* in mue-nue plane.                     */
-  /*****************************************/
-
-  double res;
-
-  res = Efield[index+mue] + Efield[3*neighbor[mue]+nue] -
-        Efield[3*neighbor[nue]+mue] - Efield[index+nue];
-
-  return res;
-}
-
-MDINLINE double calc_curl(int mue, int nue, int* neighbor, int index)
-  /* calculation of the plaquette lying in mue-nue plane of dual space */
-{
-  double result;
-  
-  result = Bfield[index+mue] + Bfield[3*neighbor[OPP_DIR(mue)]+nue] -
-    Bfield[3*neighbor[OPP_DIR(nue)]+mue] - Bfield[index+nue];
-
-  return result;
-}
-
-void update_plaquette(int mue, int nue, int* neighb, int index, double delta)
+void update_plaquette(int mue, int nue, int index, double delta)
 {
   int i = 3*index;
-  Efield[i+mue]             += delta;
-  Efield[3*neighb[mue]+nue] += delta;
-  Efield[3*neighb[nue]+mue] -= delta;
-  Efield[i+nue]             -= delta;  
+  Efield[i+mue]                  += delta;
+  Efield[i+3*lstride[mue]+nue]   += delta;
+  Efield[i+3*lstride[nue]+mue]   -= delta;
+  Efield[i+nue]                  -= delta;  
 }
 
 double check_curl_E()
@@ -283,7 +264,6 @@ void perform_rot_move_inplane(int i, int n)
 {
   /* coord n is normal to the plaquette */
   int mue, nue;
-  int * anchor_neighb;
   double delta;
   double ROUND_ERR = 0.01*ROUND_ERROR_PREC;
   
@@ -305,13 +285,11 @@ void perform_rot_move_inplane(int i, int n)
     break;
   }
   
-  anchor_neighb = &neighbor[i][0];
-
-  delta = Efield[3*i+mue] + Efield[3*anchor_neighb[mue]+nue] 
-    - Efield[3*anchor_neighb[nue]+mue] - Efield[3*i+nue];
+  delta = Efield[3*i+mue] + Efield[3*(i+lstride[mue])+nue] 
+    - Efield[3*(i+lstride[nue])+mue] - Efield[3*i+nue];
   if(fabs(delta)>=ROUND_ERR) {
     delta = -delta/4.; 
-    update_plaquette(mue, nue, anchor_neighb, i, delta);
+    update_plaquette(mue, nue, i, delta);
   }
 }
 
@@ -403,17 +381,9 @@ void calc_part_yukawa_force(double *grad, double *force, int index)
 {
   int i, j, k, l, m;
   int help_index[3];
-  int temp;
   double local_f[SPACE_DIM];
-  t_site* anchor_site;
 
-  anchor_site = &lattice[index];
-  FOR3D(i) {
-    temp = neighbor[index][i];
-    if(temp == NOWHERE) help_index[i] = lparam.volume; /* force huge index */
-    else  /* incr. for x-neighbor */
-      help_index[i] = get_offset(lattice[neighbor[index][i]].r[i], anchor_site->r[i], i, lparam.dim);    
-  }
+  get_neighbor_strides(index, help_index);
 	
   i = 0;
   FOR3D(k) local_f[k] = 0.;
@@ -561,6 +531,9 @@ void calc_local_lattice() {
   
   lparam.volume    = xyzcube;
   lparam.inner_vol = lparam.size[0]*lparam.size[1]*lparam.size[2];
+  lstride[2] = 1;
+  lstride[1] = lparam.dim[2];
+  lstride[0] = lparam.dim[1]*lparam.dim[2];
   /* allocate memory for sites and neighbors */
   lattice  = (t_site*) malloc(xyzcube*sizeof(t_site));
   neighbor = (t_dirs*) malloc(xyzcube*sizeof(t_dirs));
@@ -763,6 +736,28 @@ int unpack_surface_patch(int doffset, int skip, int stride, int *coord, int nblo
 }
 *******************/
 
+/** datatypes of the planes containing only the field components tangential
+    to the plane, used for the dynamic update of the fields. */
+void prepare_surface_planes_2D(int dim, MPI_Datatype *xy, MPI_Datatype *xz, MPI_Datatype *yz, 
+			       t_surf_patch *surface_patch)
+{
+  MPI_Datatype xz_plaq, oneslice;
+
+  MPI_Type_vector(surface_patch[0].stride, 2, 3, MPI_DOUBLE,yz);    
+  MPI_Type_commit(yz);
+
+  /* create data type for xz plaquette */
+  MPI_Type_hvector(2,1*sizeof(double),2*sizeof(double), MPI_BYTE, &xz_plaq);
+  /* create data type for a 1D section */
+  MPI_Type_contiguous(surface_patch[2].stride, xz_plaq, &oneslice); 
+  /* create data type for a 2D xz plane */
+  MPI_Type_hvector(surface_patch[2].nblocks, 1, dim*surface_patch[2].skip*sizeof(double), oneslice, xz);
+  MPI_Type_commit(xz);    
+  /* create data type for a 2D xy plane */
+  MPI_Type_vector(surface_patch[4].nblocks, 2, dim*surface_patch[4].skip, MPI_DOUBLE, xy);
+  MPI_Type_commit(xy); 
+}
+
 void prepare_surface_planes(int dim, MPI_Datatype *xy, MPI_Datatype *xz, MPI_Datatype *yz, 
 			    t_surf_patch *surface_patch)
 {
@@ -793,24 +788,9 @@ void exchange_surface_patch(double *field, int dim, int e_equil)
   static t_surf_patch  surface_patch[6];
 
   if(init) {
-    MPI_Datatype xz_plaq, oneslice;
-
     calc_surface_patches(surface_patch);
     prepare_surface_planes(dim, &xyPlane, &xzPlane, &yzPlane, surface_patch);
- 
-    MPI_Type_vector(surface_patch[0].stride, 2, 3, MPI_DOUBLE,&yzPlane2D);    
-    MPI_Type_commit(&yzPlane2D);
-
-    /* create data type for xz plaquette */
-    MPI_Type_hvector(2,1*sizeof(double),2*sizeof(double), MPI_BYTE, &xz_plaq);
-    /* create data type for a 1D section */
-    MPI_Type_contiguous(surface_patch[2].stride, xz_plaq, &oneslice); 
-    /* create data type for a 2D xz plane */
-    MPI_Type_hvector(surface_patch[2].nblocks, 1, dim*surface_patch[2].skip*sizeof(double), oneslice, &xzPlane2D);
-    MPI_Type_commit(&xzPlane2D);    
-    /* create data type for a 2D xy plane */
-    MPI_Type_vector(surface_patch[4].nblocks, 2, dim*surface_patch[4].skip, MPI_DOUBLE, &xyPlane2D);
-    MPI_Type_commit(&xyPlane2D); 
+    prepare_surface_planes_2D(dim, &xyPlane2D, &xzPlane2D, &yzPlane2D, surface_patch);
     
     init = 0;
   }
@@ -908,6 +888,155 @@ void exchange_surface_patch(double *field, int dim, int e_equil)
   }
 }
 
+/************************************************
+ * overlapped surface exchange
+ ************************************************/
+
+/** Fields with persistent surface exchange requests. */
+enum { SURF_EFIELD, SURF_BFIELD, SURF_NFIELDS };
+
+/** surface patches of the overlapped exchange. */
+static t_surf_patch surf_patch[6];
+/** tangential plane datatypes of the overlapped exchange. */
+static MPI_Datatype surf_xy, surf_xz, surf_yz;
+/** persistent requests for the exchange of the tangential field
+    components, per field and axis (receive and send for both directions). */
+static MPI_Request surf_request[SURF_NFIELDS][SPACE_DIM][4];
+/** number of requests per field and axis, zero if the axis is not split. */
+static int surf_nrequest[SURF_NFIELDS][SPACE_DIM];
+/** whether the persistent requests are set up. */
+static int surf_requests_init = 0;
+
+/** free the persistent requests and datatypes of the overlapped exchange. */
+void free_surface_requests()
+{
+  int f, d, j;
+
+  if(!surf_requests_init) return;
+  for(f=0; f<SURF_NFIELDS; f++)
+    FOR3D(d) {
+      for(j=0; j<surf_nrequest[f][d]; j++)
+	MPI_Request_free(&surf_request[f][d][j]);
+      surf_nrequest[f][d] = 0;
+    }
+  MPI_Type_free(&surf_xy);
+  MPI_Type_free(&surf_xz);
+  MPI_Type_free(&surf_yz);
+  surf_requests_init = 0;
+}
+
+/** set up the persistent requests for the exchange of the tangential components
+    of the E and B fields, which are bound to the current field arrays. Called by
+    \ref Maggs_init after the lattice is set up. */
+void init_surface_requests()
+{
+  int f, d, s_dir, r_dir, n, add;
+  double *field;
+  MPI_Datatype type[SPACE_DIM];
+
+  free_surface_requests();
+
+  calc_surface_patches(surf_patch);
+  prepare_surface_planes_2D(3, &surf_xy, &surf_xz, &surf_yz, surf_patch);
+  type[0] = surf_yz; type[1] = surf_xz; type[2] = surf_xy;
+
+  for(f=0; f<SURF_NFIELDS; f++) {
+    field = (f == SURF_EFIELD) ? Efield : Bfield;
+    FOR3D(d) {
+      n = 0;
+      /* the yz planes start with the y component */
+      add = (d == 0) ? 1 : 0;
+      for(s_dir=2*d; s_dir<2*d+2; s_dir++) {
+	if(node_neighbors[s_dir] == this_node) continue;
+	r_dir = (s_dir%2 == 0) ? s_dir+1 : s_dir-1;
+	MPI_Recv_init(&field[3*surf_patch[s_dir].doffset+add], 1, type[d], node_neighbors[s_dir],
+		      REQ_MAGGS_OVERLAP+s_dir, MPI_COMM_WORLD, &surf_request[f][d][n++]);
+	MPI_Send_init(&field[3*surf_patch[s_dir].offset+add], 1, type[d], node_neighbors[r_dir],
+		      REQ_MAGGS_OVERLAP+s_dir, MPI_COMM_WORLD, &surf_request[f][d][n++]);
+      }
+      surf_nrequest[f][d] = n;
+    }
+  }
+  surf_requests_init = 1;
+}
+
+/** start the exchange of the surface patches of one field along axis d.
+    Directions without a neighbour node are copied locally. */
+void start_surface_exchange(int f, int d)
+{
+  int l, s_dir, offset, doffset, skip, stride, nblocks;
+  double *field = (f == SURF_EFIELD) ? Efield : Bfield;
+
+  for(s_dir=2*d; s_dir<2*d+2; s_dir++) {
+    if(node_neighbors[s_dir] != this_node) continue;
+    offset  = 3 * surf_patch[s_dir].offset;
+    doffset = 3 * surf_patch[s_dir].doffset;
+    skip    = 3 * surf_patch[s_dir].skip;
+    stride  = 3 * surf_patch[s_dir].stride * sizeof(double);
+    nblocks = surf_patch[s_dir].nblocks;
+    for(l=0; l<nblocks; l++){
+      memcpy(&(field[doffset]), &(field[offset]), stride);
+      offset  += skip;
+      doffset += skip;
+    }
+  }
+  if(surf_nrequest[f][d] > 0)
+    MPI_Startall(surf_nrequest[f][d], surf_request[f][d]);
+}
+
+/** complete the exchange of the surface patches of one field along axis d. */
+void finish_surface_exchange(int f, int d)
+{
+  MPI_Status status[4];
+
+  if(surf_nrequest[f][d] > 0)
+    MPI_Waitall(surf_nrequest[f][d], surf_request[f][d], status);
+}
+
+/** Update the inner sites of a field with a local stencil and exchange its
+    surface patches, overlapping the communication with the update.
+
+    The exchange along an axis sends planes that include the halo of the
+    previously exchanged axes, so the axes are exchanged one after the other
+    as in \ref exchange_surface_patch. The two surface layers perpendicular
+    to the next axis are updated while the previous exchange is in flight,
+    and the interior sites while the last exchange is in flight. The update
+    must not read the halo of the field it writes.
+
+    @param update  updates the inner sites in the box [lo, hi) (inner coordinates)
+    @param help    prefactor passed to update
+    @param f       field written by update
+*/
+void update_and_exchange_surface(void (*update)(double help, int *lo, int *hi), double help, int f)
+{
+  int d, lo[3], hi[3];
+  /* remaining box of sites that are not yet updated */
+  int in_lo[3] = {0, 0, 0}, in_hi[3];
+
+  FOR3D(d) in_hi[d] = lparam.size[d];
+
+  FOR3D(d) {
+    /* update the lower and upper surface layer of the remaining box */
+    memcpy(lo, in_lo, sizeof(lo));
+    memcpy(hi, in_hi, sizeof(hi));
+    hi[d] = in_lo[d] + 1;
+    update(help, lo, hi);
+    if(in_hi[d] - 1 > in_lo[d]) {
+      lo[d] = in_hi[d] - 1;
+      hi[d] = in_hi[d];
+      update(help, lo, hi);
+    }
+    in_lo[d]++;
+    in_hi[d]--;
+    if(in_hi[d] < in_lo[d]) in_hi[d] = in_lo[d];
+
+    if(d > 0) finish_surface_exchange(f, d-1);
+    start_surface_exchange(f, d);
+  }
+  update(help, in_lo, in_hi);
+  finish_surface_exchange(f, 2);
+}
+
 void  accumulate_charge_density() {
   /******************************************
    For each particle finds apropriate cube
@@ -969,14 +1098,8 @@ void accumulate_charge_from_rho(int *first, double *rho, int index)
 {
   int i, k, l, m;
   int help_index[3];
-  int temp;
 
-  FOR3D(i) {
-    temp = neighbor[index][i];
-    if(temp == NOWHERE) help_index[i] = lparam.volume; /* force huge index */
-    else  /* incr. for x-neighbor */
-      help_index[i] = get_offset(lattice[neighbor[index][i]].r[i], first[i], i, lparam.dim);    
-  }
+  get_neighbor_strides(index, help_index);
 
   i = 0;
   for(k=0;k<2;k++){   /* jumps from x- to x+ */
@@ -1107,50 +1230,40 @@ void minimize_transverse_field()
   /* checkerboard for the minimization of the energy */
   int k, l, m;
   int i, d;
-  int ind_i, ind_j;
   int size[2]={0,0};
-  int index = -1; // force allocation error
+  /* strides of the plane index k and the in-plane indices l, m */
+  int sk = 0, sl = 0, sm = 0;
   
   FOR3D(d) {
     switch(d) {
     case 0 :
       size[0] = lparam.size[2];
       size[1] = lparam.size[1];
+      sk = lstride[0]; sl = lstride[1]; sm = lstride[2];
       break;
     case 1 :
       size[0] = lparam.size[2];
       size[1] = lparam.size[0];
+      sk = lstride[1]; sl = lstride[0]; sm = lstride[2];
       break;
     case 2 :
       size[0] = lparam.size[1];
       size[1] = lparam.size[0];
+      sk = lstride[2]; sl = lstride[0]; sm = lstride[1];
       break;
     }
     for(i=0;i<2;i++) {
-      /* at first even sites (i==0) then odd */
+      /* at first even sites (i==0) then odd. Plaquettes of the same
+	 colour share no links, neither within a plane nor between
+	 planes, so that they can be relaxed in parallel. */
+#ifdef _OPENMP
+#pragma omp parallel for private(l,m)
+#endif
       for(k=1;k<=lparam.size[d];k++) {
 	/* update every plane in direction d */
-	ind_i=0;
-	for(l=0; l<=size[1]; l++){
-	  ind_j=0;
-	  for(m=0;m<=size[0]; m++) {
-	    switch(d) {
-	    case 0 :
-	      index=maggs_get_linear_index(k,l,m,lparam.dim);
-	      break;
-	    case 1 :
-	      index=maggs_get_linear_index(l,k,m,lparam.dim); 
-	      break;
-	    case 2 :
-	      index=maggs_get_linear_index(l,m,k,lparam.dim); 
-	      break;
-	    }
-	    if((ind_i+ind_j)%2==i)
-	      perform_rot_move_inplane(index, d);
-	    ind_j++;
-	  }
-	  ind_i++;
-	}   
+	for(l=0; l<=size[1]; l++)
+	  for(m=(l+i)%2; m<=size[0]; m+=2)
+	    perform_rot_move_inplane(k*sk + l*sl + m*sm, d);
       }
       /* update boundaries - update halo regions */
       exchange_surface_patch(Efield, 3, 0);
@@ -1478,7 +1591,7 @@ void print_e_field() {
 /*************************************************************/
 void interpolate_charge(int *first, double *rel, double q)
 {
-  int i, k, l, m, index, temp_ind;
+  int i, k, l, m, index;
   int help_index[3];
   double temp;
   double help[SPACE_DIM];
@@ -1489,12 +1602,7 @@ void interpolate_charge(int *first, double *rel, double q)
   index = maggs_get_linear_index(first[0],first[1],first[2],lparam.dim);
   //  ret_index = index; 
 
-  FOR3D(i) {
-    temp_ind = neighbor[index][i];
-    if(temp_ind == NOWHERE) help_index[i] = lparam.volume; /* force huge index */
-    else  /* incr. for x-neighbor */
-      help_index[i] = get_offset(lattice[neighbor[index][i]].r[i], first[i], i, lparam.dim);    
-  }
+  get_neighbor_strides(index, help_index);
 
   for(k=0;k<2;k++){   /* jumps from x- to x+ */
     for(l=0;l<2;l++){  /* jumps from y- to y+ */
@@ -1562,21 +1670,14 @@ void interpolate_part_charge(double q, double *rel, double *rho)
 
 void interpolate_charges_from_grad(int index, double q, double* rel, double *grad)
 {
-  int i, k, l, m;
-  int temp_ind, grad_ind;
+  int k, l, m;
+  int grad_ind;
   double help_x;
   int help_index[SPACE_DIM];
-  t_site* anchor_site;
 
   help_x = 1. - rel[0];     /* relative pos. w.r.t. first */  
 
-  anchor_site = &lattice[index];
-  FOR3D(i) {
-    temp_ind = neighbor[index][i];
-    if(temp_ind == NOWHERE) help_index[i] = lparam.volume;
-    else  /* incr. for x-neighbor */
-      help_index[i] = get_offset(lattice[temp_ind].r[i], anchor_site->r[i], i, lparam.dim);    
-  }  
+  get_neighbor_strides(index, help_index);
 
   grad_ind = 0;
   for(k=0;k<2;k++){   /* jumps from x- to x+ */
@@ -1879,24 +1980,13 @@ void  calc_e_field_on_link_1D(int index, double *flux, double v, int dir)
    * Force is multiplied by the time_step
    */
   int l, m, ind_flux, dir1, dir2;
-  int temp_ind;
-  int help_index[2];
-  int* anchor_neighb;
-  t_site* anchor_site;
+  int help_index[2], strides[3];
 
   calc_directions(dir, &dir1, &dir2);
 
-  anchor_neighb = &neighbor[index][0]; 
-  anchor_site = &lattice[index];
-
-  temp_ind = anchor_neighb[dir1];
-  if(temp_ind == NOWHERE) help_index[0] = lparam.volume;
-  else
-    help_index[0] = get_offset(lattice[temp_ind].r[dir1], anchor_site->r[dir1], dir1, lparam.dim);
-  temp_ind = anchor_neighb[dir2];
-  if(temp_ind == NOWHERE) help_index[1] = lparam.volume;
-  else
-    help_index[1] = get_offset(lattice[temp_ind].r[dir2], anchor_site->r[dir2], dir2, lparam.dim);
+  get_neighbor_strides(index, strides);
+  help_index[0] = strides[dir1];
+  help_index[1] = strides[dir2];
 
 
   ind_flux = 0;
@@ -1926,10 +2016,7 @@ void calc_part_link_forces(Particle *p, int index, double *grad)
   double local_force[SPACE_DIM];
 
   if(init) {
-    t_site* anchor_site;
-    anchor_site = &lattice[index];
-    FOR3D(j)
-      help_index[j] = get_offset(lattice[neighbor[index][j]].r[j], anchor_site->r[j], j, lparam.dim);    
+    FOR3D(j) help_index[j] = lstride[j];
     init = 0;
   }
 
@@ -1956,39 +2043,44 @@ void calc_part_link_forces(Particle *p, int index, double *grad)
   FOR3D(j) p->f.f[j] += maggs.prefactor * local_force[j];
 }
 
+/** E += help * curl B on the inner sites in the box [lo, hi). The curl in
+    the dual space takes the B field on the links of the lower neighbours,
+    which are found by the lattice strides. The rows along z are independent. */
+void add_curl_B_box(double help, int *lo, int *hi)
+{
+  int r, i, x, y, z;
+  int sx = 3*lstride[0], sy = 3*lstride[1];
+  int ny = hi[1] - lo[1], nrows = (hi[0] - lo[0])*(hi[1] - lo[1]);
+  double *E, *B;
+
+  if(hi[2] <= lo[2]) return;
+#ifdef _OPENMP
+#pragma omp parallel for private(i,x,y,z,E,B)
+#endif
+  for(r=0;r<nrows;r++) {
+    x = lo[0] + r/ny;
+    y = lo[1] + r%ny;
+    E = Efield + 3*maggs_get_linear_index(x+1, y+1, 1, lparam.dim);
+    B = Bfield + 3*maggs_get_linear_index(x+1, y+1, 1, lparam.dim);
+    for(z=lo[2];z<hi[2];z++) {
+      i = 3*z;
+      E[i  ] += help * (B[i+2] + B[i-3+1]  - B[i-sy+2] - B[i+1]);
+      E[i+1] += help * (B[i  ] + B[i-sx+2] - B[i-3]    - B[i+2]);
+      E[i+2] += help * (B[i+1] + B[i-sy]   - B[i-sx+1] - B[i  ]);
+    }
+  }
+}
+
 void add_transverse_field_to_e_field(double dt)
 {
-  int i, index;
   double invasq; 
-  int x, y, z;
-  int offset, xoffset, yoffset;
   double help;
 
   invasq = SQR(maggs.inva);
   help = dt * invasq * maggs.invsqrt_f_mass;
 
   /***calculate e-field***/ 
-  offset = maggs_get_linear_index(1,1,1, lparam.dim);
-  yoffset = lparam.dim[2];
-  xoffset = 2*lparam.dim[2];
-  
-  for(x=0;x<lparam.size[0];x++) {
-    for(y=0;y<lparam.size[1];y++) {
-      for(z=0;z<lparam.size[2];z++) {
-	//  FORALL_INNER_SITES(x, y, z) {
-	//    i = maggs_get_linear_index(x, y, z, lparam.dim);
-	i = offset+z;
-	index = 3*i;
-	Efield[index  ] += help * calc_curl(2, 1, neighbor[i], index);
-	Efield[index+1] += help * calc_curl(0, 2, neighbor[i], index);
-	Efield[index+2] += help * calc_curl(1, 0, neighbor[i], index);
-      }
-      offset += yoffset;
-    }
-    offset += xoffset;
-  } 
-
-  exchange_surface_patch(Efield, 3, 0);
+  update_and_exchange_surface(add_curl_B_box, help, SURF_EFIELD);
 }
 
 void maggs_calc_e_forces()
@@ -2131,6 +2223,7 @@ int set_maggs_params(Tcl_Interp *interp, double bjerrum, double f_mass, int mesh
   return TCL_OK;
 }
 
+
 void maggs_thermo_init()
 {
   maggs_pref1 = -time_step*maggs.fric_gamma;
@@ -2185,6 +2278,7 @@ void Maggs_init()
     if(maggs.fric_gamma > 0.) maggs_thermo_init();
 
     calc_local_lattice();
+    init_surface_requests();
 
     /* update max_cut */
     integrate_vv_recalc_maxrange();
@@ -2196,34 +2290,39 @@ void Maggs_init()
   }
 }
 
+/** B -= help * curl E on the inner sites in the box [lo, hi). The
+    plaquettes take the E field on the links of the upper neighbours,
+    which are found by the lattice strides. The rows along z are
+    independent. */
+void sub_curl_E_box(double help, int *lo, int *hi)
+{
+  int r, i, x, y, z;
+  int sx = 3*lstride[0], sy = 3*lstride[1];
+  int ny = hi[1] - lo[1], nrows = (hi[0] - lo[0])*(hi[1] - lo[1]);
+  double *E, *B;
+
+  if(hi[2] <= lo[2]) return;
+#ifdef _OPENMP
+#pragma omp parallel for private(i,x,y,z,E,B)
+#endif
+  for(r=0;r<nrows;r++) {
+    x = lo[0] + r/ny;
+    y = lo[1] + r%ny;
+    E = Efield + 3*maggs_get_linear_index(x+1, y+1, 1, lparam.dim);
+    B = Bfield + 3*maggs_get_linear_index(x+1, y+1, 1, lparam.dim);
+    for(z=lo[2];z<hi[2];z++) {
+      i = 3*z;
+      B[i  ] -= help*(E[i+1] + E[i+sy+2] - E[i+3+1]  - E[i+2]); 
+      B[i+1] -= help*(E[i+2] + E[i+3]    - E[i+sx+2] - E[i  ]); 
+      B[i+2] -= help*(E[i  ] + E[i+sx+1] - E[i+sy]   - E[i+1]);  
+    }
+  }
+}
+
 void propagate_B_field(double dt) {
-  int x, y, z, i, offset, index;
-  int xoffset, yoffset;
   double help = dt*maggs.invsqrt_f_mass;
   /* B(t+h/2) = B(t-h/2) + h*curlE(t) */ 
-
-  offset = maggs_get_linear_index(1,1,1, lparam.dim);
-  yoffset = lparam.dim[2];
-  xoffset = 2*lparam.dim[2];
-
-  for(x=0;x<lparam.size[0];x++) {
-    for(y=0;y<lparam.size[1];y++) {
-      for(z=0;z<lparam.size[2];z++) {
-	
-	
-	//FORALL_INNER_SITES(x, y, z) {
-	//  i = maggs_get_linear_index(x, y, z, lparam.dim); 
-
-        i = offset+z;
-	index = 3*i;
-	Bfield[index+0] += - help*calc_dual_curl(1,2, neighbor[i], index); 
-	Bfield[index+1] += - help*calc_dual_curl(2,0, neighbor[i], index); 
-	Bfield[index+2] += - help*calc_dual_curl(0,1, neighbor[i], index);  
-      }
-      offset += yoffset;
-    }
-    offset += xoffset;
-  }
+  update_and_exchange_surface(sub_curl_E_box, help, SURF_BFIELD);
   
   /* add thermostat */
   /**********/
@@ -2236,7 +2335,6 @@ void propagate_B_field(double dt) {
   //    }
   //}
   /*************/
-  exchange_surface_patch(Bfield, 3, 0);
 }
 
 void check_gauss_law()
@@ -2469,6 +2567,7 @@ void Maggs_exit()
 {
   //  free(send_databuf);
   //  free(recv_databuf);
+  free_surface_requests();
   free(lattice);
   free(Efield);
   free(Bfield);
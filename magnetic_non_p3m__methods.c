@@ -19,14 +19,16 @@
  * 
  *  DS => Direct sum , compute the things via direct sum, 
  *
+ *  BH => Barnes-Hut tree, the DAWAANR interactions for large systems on any number of nodes
+ *
  *  For more information about the DAWAANR => DIPOLAR_ALL_WITH_ALL_AND_NO_REPLICA
  *  see \ref magnetic_non_p3m__methods.h "magnetic_non_p3m__methods.h"
  */
 
-//#include <mpi.h>
+#include <mpi.h>
 //#include <stdio.h>
 //#include <stdlib.h>
-//#include <string.h>
+#include <string.h>
 //#include <math.h>
 //#include "utils.h"
 //#include "integrate.h"
@@ -38,6 +40,7 @@
 
 
 #include "magnetic_non_p3m__methods.h"
+#include "octree.h"
 
 
 #ifdef MAGNETOSTATICS
@@ -311,7 +314,7 @@ double dawaanr_calculations(int force_flag, int energy_flag) {
     free(tz);
 #endif
   }
-  return u;
+  return coulomb.Dprefactor*u;
 }
 #endif   /*of  ifdef DAWAANR  */
 
@@ -641,12 +644,227 @@ double  magnetic_dipolar_direct_sum_calculations(int force_flag, int energy_flag
 #endif
   }
  
-  return 0.5*u;
+  return 0.5*coulomb.Dprefactor*u;
 } 
  
 
 #endif /*of ifdef MAGNETIC_DIPOLAR_DIRECT_SUM */
 
+/*=================== */
+/*=================== */
+
+/* =============================================================================
+                  BARNES-HUT TREE FOR MAGNETIC SYSTEMS
+   =============================================================================
+*/
+#ifdef DIPOLAR_BARNES_HUT
+
+Dipolar_BH_struct dipolar_bh_params = { 0.5 };
+
+/** the tree over all dipoles */
+static Octree bh_tree;
+
+int printDipolarBHToResult(Tcl_Interp *interp)
+{
+  char buffer[TCL_DOUBLE_SPACE];
+
+  Tcl_PrintDouble(interp, dipolar_bh_params.theta, buffer);
+  Tcl_AppendResult(interp, " bh ", buffer, (char *) NULL);
+  return TCL_OK;
+}
+
+/************************************************************/
+
+int Dinter_parse_dipolar_bh(Tcl_Interp * interp, int argc, char ** argv)
+{
+  double theta;
+
+  if (argc != 1 || ! ARG0_IS_D(theta)) {
+    Tcl_AppendResult(interp, "wrong # arguments: inter magnetic <Dbjerrum> bh <theta>", (char *) NULL);
+    return TCL_ERROR;
+  }
+  if (theta < 0 || theta >= 1) {
+    Tcl_AppendResult(interp, "tree opening angle must be between 0 and 1", (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  dipolar_bh_params.theta = theta;
+  coulomb.Dmethod = DIPOLAR_BH;
+
+  mpi_bcast_coulomb_params();
+  return TCL_OK;
+}
+
+/************************************************************/
+
+/** a dipole for the tree. As for DAWAANR, the unfolded positions are used. */
+static int bh_dipole(Particle *p, double pos[3], double v[3])
+{
+  int j;
+
+  if (p->p.dipm <= 1.e-11)
+    return 0;
+  for (j = 0; j < 3; j++) {
+    pos[j] = p->r.p[j] + p->l.i[j]*box_l[j];
+    v[j]   = p->r.dip[j];
+  }
+  return 1;
+}
+
+/** total moment and center of the dipoles of a node */
+static void bh_moments(OctreeNode *node, OctreeItem *items)
+{
+  OctreeDipoleMoments *m = &node->m.dipole;
+  int i, j;
+  double w, wsum = 0;
+
+  for (j = 0; j < 3; j++)
+    m->dip[j] = m->c[j] = 0;
+  for (i = node->start; i < node->start + node->n; i++) {
+    w = sqrt(sqrlen(items[i].v));
+    wsum += w;
+    for (j = 0; j < 3; j++) {
+      m->dip[j] += items[i].v[j];
+      m->c[j]   += w*items[i].pos[j];
+    }
+  }
+  for (j = 0; j < 3; j++)
+    m->c[j] /= wsum;
+}
+
+/** gather the dipoles of all nodes and build the tree over them. */
+static void bh_setup()
+{
+  double lo[3], hi[3], center[3], size;
+  int j;
+
+  octree_gather(&bh_tree, bh_dipole);
+
+  /* the root cube spans all dipoles */
+  octree_bounds(&bh_tree, lo, hi);
+  size = dmax(hi[0] - lo[0], dmax(hi[1] - lo[1], hi[2] - lo[2]));
+  for (j = 0; j < 3; j++)
+    center[j] = 0.5*(lo[j] + hi[j]);
+
+  octree_build(&bh_tree, center, size, bh_moments);
+}
+
+/** the interaction of the dipole m1 at pos with the dipole m2 at distance
+    r = pos - pos2. Adds the energy, and the force and torque on m1. */
+static void bh_pair(double r[3], double m1[3], double m2[3], int force_flag,
+		    double *u, double f[3], double t[3])
+{
+  double r2, r3, r5, r7, pe1, pe2, pe3, a, b, cc, d;
+
+  r2  = sqrlen(r);
+  r3  = r2*sqrt(r2);
+  r5  = r3*r2;
+  pe1 = scalar(m1, m2);
+  pe2 = scalar(m1, r);
+  pe3 = scalar(m2, r);
+
+  *u += pe1/r3 - 3.0*pe2*pe3/r5;
+
+  if (force_flag) {
+    r7 = r5*r2;
+    a  = 3.0*pe1/r5;
+    b  = -15.0*pe2*pe3/r7;
+    cc = 3.0*pe3/r5;
+    d  = 3.0*pe2/r5;
+    f[0] += (a+b)*r[0] + cc*m1[0] + d*m2[0];
+    f[1] += (a+b)*r[1] + cc*m1[1] + d*m2[1];
+    f[2] += (a+b)*r[2] + cc*m1[2] + d*m2[2];
+#ifdef ROTATION
+    t[0] += -(m1[1]*m2[2] - m2[1]*m1[2])/r3 + (m1[1]*r[2] - r[1]*m1[2])*cc;
+    t[1] += -(m2[0]*m1[2] - m1[0]*m2[2])/r3 + (r[0]*m1[2] - m1[0]*r[2])*cc;
+    t[2] += -(m1[0]*m2[1] - m2[0]*m1[1])/r3 + (m1[0]*r[1] - r[0]*m1[1])*cc;
+#endif
+  }
+}
+
+/** the interaction of the dipole m at pos with all dipoles of a node and its
+    children, except for the dipole with identity self. A node is replaced by
+    its total dipole if it is far enough away, i. e. its edge length is
+    smaller than theta times the distance. */
+static void bh_field(int nidx, double pos[3], double m[3], int self, int force_flag,
+		     double *u, double f[3], double t[3])
+{
+  OctreeNode *node = &bh_tree.nodes[nidx];
+  OctreeDipoleMoments *mom = &node->m.dipole;
+  double r[3];
+  int i, j, oct;
+
+  /* never approximate a node which contains pos */
+  for (j = 0; j < 3; j++)
+    r[j] = pos[j] - node->center[j];
+  if (fabs(r[0]) > 0.5*node->size || fabs(r[1]) > 0.5*node->size ||
+      fabs(r[2]) > 0.5*node->size) {
+    for (j = 0; j < 3; j++)
+      r[j] = pos[j] - mom->c[j];
+    if (SQR(node->size) < SQR(dipolar_bh_params.theta)*sqrlen(r)) {
+      bh_pair(r, m, mom->dip, force_flag, u, f, t);
+      return;
+    }
+  }
+
+  if (!octree_is_leaf(node)) {
+    for (oct = 0; oct < 8; oct++)
+      if (node->child[oct] != -1)
+	bh_field(node->child[oct], pos, m, self, force_flag, u, f, t);
+    return;
+  }
+
+  /* direct summation */
+  for (i = node->start; i < node->start + node->n; i++) {
+    if (bh_tree.items[i].identity == self)
+      continue;
+    for (j = 0; j < 3; j++)
+      r[j] = pos[j] - bh_tree.items[i].pos[j];
+    bh_pair(r, m, bh_tree.items[i].v, force_flag, u, f, t);
+  }
+}
+
+/************************************************************/
+
+double dipolar_bh_calculations(int force_flag, int energy_flag)
+{
+  Cell *cell;
+  Particle *part;
+  int c, i, j, np;
+  double pos[3], f[3], t[3], u = 0;
+
+  bh_setup();
+  if (bh_tree.n_nodes == 0)
+    return 0;
+
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    part = cell->part;
+    np   = cell->n;
+    for (i = 0; i < np; i++)
+      if (part[i].p.dipm > 1.e-11) {
+	for (j = 0; j < 3; j++) {
+	  pos[j] = part[i].r.p[j] + part[i].l.i[j]*box_l[j];
+	  f[j] = t[j] = 0;
+	}
+	bh_field(0, pos, part[i].r.dip, part[i].p.identity, force_flag, &u, f, t);
+	if (force_flag)
+	  for (j = 0; j < 3; j++) {
+	    part[i].f.f[j] += coulomb.Dprefactor*f[j];
+#ifdef ROTATION
+	    part[i].f.torque[j] += coulomb.Dprefactor*t[j];
+#endif
+	  }
+      }
+  }
+
+  /* every pair was counted twice */
+  return energy_flag ? 0.5*coulomb.Dprefactor*u : 0;
+}
+
+#endif /*of ifdef DIPOLAR_BARNES_HUT */
+
+
 
 
 
@@ -20,6 +20,9 @@
  * 
  *  DS => Direct sum , compute the interactions via direct sum, 
  *
+ *  BH => Barnes-Hut tree, like DAWAANR, but distant groups of dipoles are replaced by their
+ *   total dipole moment, which scales as N log N and runs on any number of nodes
+ *
  *  For more information about the DAWAANR => DIPOLAR_ALL_WITH_ALL_AND_NO_REPLICA
  *  see \ref magnetic_non_p3m__methods.c "magnetic_non_p3m__methods.c"
  */
@@ -93,6 +96,36 @@ double  magnetic_dipolar_direct_sum_calculations(int force_flag, int energy_flag
 
 
 
+/* =============================================================================
+                  BARNES-HUT TREE FOR MAGNETIC SYSTEMS
+   =============================================================================
+*/
+#ifdef DIPOLAR_BARNES_HUT
+
+/** parameters of the Barnes-Hut tree */
+typedef struct {
+  /** opening angle. A cube of the tree is replaced by its total dipole moment if its
+      edge length is smaller than theta times its distance. Smaller values are more
+      accurate, 0 gives the direct sum. */
+  double theta;
+} Dipolar_BH_struct;
+extern Dipolar_BH_struct dipolar_bh_params;
+
+    /*  Information about the status of the method */
+     int printDipolarBHToResult(Tcl_Interp *interp);
+
+  /* Parsing function for the Barnes-Hut tree method*/
+  int Dinter_parse_dipolar_bh(Tcl_Interp * interp, int argc, char ** argv);
+
+ /* Core of the method: here you compute the magnetic forces, torques and the energy of the
+    local particles in the field of all dipoles of the system. The energy is the
+    contribution of this node. */
+double dipolar_bh_calculations(int force_flag, int energy_flag);
+
+#endif /*of ifdef DIPOLAR_BARNES_HUT */
+
+
+
 
 
 
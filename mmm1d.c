@@ -13,6 +13,7 @@
 
 #include <mpi.h>
 #include <tcl.h>
+#include <string.h>
 #include "utils.h"
 #include "mmm1d.h"
 #include "polynom.h"
@@ -25,6 +26,7 @@
 #include "mmm-common.h"
 #include "parser.h"
 #include "errorhandling.h"
+#include "octree.h"
 
 #ifdef ELECTROSTATICS
 
@@ -47,12 +49,48 @@
 #define K1 LPK1
 #endif
 
+/** \name Tabulation of the lattice sums, see \ref MMM1D_struct::tabulate */
+/*@{*/
+/** smallest number of grid intervals per dimension */
+#define TAB_MIN_INTERVALS 16
+/** largest number of grid intervals per dimension. If this does not suffice
+    to reach the required accuracy, the sums are calculated directly. */
+#define TAB_MAX_INTERVALS 512
+/** number of tabulated values per grid point: the radial and z force sum
+    and the energy sum */
+#define TAB_VALUES 3
+/*@}*/
+
+
 /** inverse box dimensions and other constants */
 /*@{*/
 static double uz, L2, uz2, prefuz2, prefL3_i;
 /*@}*/
 
-MMM1D_struct mmm1d_params = { 0.05, 5, 1, 1e-5 };
+/** the Barnes-Hut tree over all charges, see \ref MMM1D_struct::tree_theta */
+static Octree tree;
+
+/** a table of the lattice sums of one of the formulas on a regular grid
+    in a radial coordinate and z/box_l[2] between 0 and 0.5. The sums are
+    even in z, except for the z force sum, which is odd. */
+typedef struct {
+  /** number of grid intervals per dimension, 0 if not tabulated */
+  int n;
+  /** range of the radial coordinate */
+  double x0, x1;
+  /** inverse grid spacings */
+  double dx_i, dz_i;
+  /** TAB_VALUES values for each of the (n+1)^2 grid points */
+  double *data;
+} MMM1D_table;
+
+/** table for the near formula over (rxy/box_l[2])^2 */
+static MMM1D_table near_tab = { 0, 0, 0, 0, 0, NULL };
+/** table for the far formula over rxy/box_l[2]. Beyond x1, the Bessel
+    sums are below the required accuracy and taken as zero. */
+static MMM1D_table far_tab = { 0, 0, 0, 0, 0, NULL };
+
+MMM1D_struct mmm1d_params = { 0.05, 5, 1, 1e-5, 0, 0 };
 
 int printMMM1DToResult(Tcl_Interp *interp)
 {
@@ -64,18 +102,43 @@ int printMMM1DToResult(Tcl_Interp *interp)
   Tcl_AppendResult(interp, buffer, " ",(char *) NULL);
   Tcl_PrintDouble(interp, mmm1d_params.maxPWerror, buffer);
   Tcl_AppendResult(interp, buffer,(char *) NULL);
+  if (mmm1d_params.tabulate)
+    Tcl_AppendResult(interp, " tabulate",(char *) NULL);
+  if (mmm1d_params.tree_theta > 0) {
+    Tcl_PrintDouble(interp, mmm1d_params.tree_theta, buffer);
+    Tcl_AppendResult(interp, " tree ", buffer, (char *) NULL);
+  }
 
   return TCL_OK;
 }
 
 int inter_parse_mmm1d(Tcl_Interp *interp, int argc, char **argv)
 {
-  double switch_rad, maxPWerror;
-  int bessel_cutoff;
+  double switch_rad, maxPWerror, tree_theta = 0;
+  int bessel_cutoff, tabulate = 0;
+
+  /* the optional flags at the end */
+  while (argc > 2) {
+    if (ARG_IS_S(argc-1, "tabulate")) {
+      tabulate = 1;
+      argc--;
+    }
+    else if (argc > 3 && ARG_IS_S(argc-2, "tree")) {
+      if (! ARG_IS_D(argc-1, tree_theta))
+	return TCL_ERROR;
+      if (tree_theta <= 0 || tree_theta >= 1) {
+	Tcl_AppendResult(interp, "tree opening angle must be between 0 and 1", (char *)NULL);
+	return TCL_ERROR;
+      }
+      argc -= 2;
+    }
+    else
+      break;
+  }
 
   if (argc < 2) {
     Tcl_AppendResult(interp, "wrong # arguments: inter coulomb mmm1d <switch radius> "
-		     "{<bessel cutoff>} <maximal error for near formula> | tune  <maximal pairwise error>", (char *) NULL);
+		     "{<bessel cutoff>} <maximal error for near formula> | tune  <maximal pairwise error> {tabulate} {tree <theta>}", (char *) NULL);
     return TCL_ERROR;
   }
 
@@ -108,7 +171,7 @@ int inter_parse_mmm1d(Tcl_Interp *interp, int argc, char **argv)
     }
     else {
       Tcl_AppendResult(interp, "wrong # arguments: inter coulomb mmm1d <switch radius> "
-		       "{<bessel cutoff>} <maximal error for near formula> | tune  <maximal pairwise error>", (char *) NULL);
+		       "{<bessel cutoff>} <maximal error for near formula> | tune  <maximal pairwise error> {tabulate} {tree <theta>}", (char *) NULL);
       return TCL_ERROR;
     }
     
@@ -118,7 +181,7 @@ int inter_parse_mmm1d(Tcl_Interp *interp, int argc, char **argv)
     }
   }
 
-  MMM1D_set_params(switch_rad, bessel_cutoff, maxPWerror);
+  MMM1D_set_params(switch_rad, bessel_cutoff, maxPWerror, tabulate, tree_theta);
   return MMM1D_tune(interp);
 }
 
@@ -150,7 +213,7 @@ double determine_bessel_cutoff(double switch_rad, double maxPWerror, int maxP)
   return P;
 }
 
-int MMM1D_set_params(double switch_rad, int bessel_cutoff, double maxPWerror)
+int MMM1D_set_params(double switch_rad, int bessel_cutoff, double maxPWerror, int tabulate, double tree_theta)
 {
   MMM1D_setup_constants();
 
@@ -162,6 +225,8 @@ int MMM1D_set_params(double switch_rad, int bessel_cutoff, double maxPWerror)
   mmm1d_params.bessel_calculated = 0;
 
   mmm1d_params.maxPWerror = maxPWerror;
+  mmm1d_params.tabulate = tabulate;
+  mmm1d_params.tree_theta = tree_theta;
   coulomb.method = COULOMB_MMM1D;
 
   mpi_bcast_coulomb_params();
@@ -236,6 +301,215 @@ int MMM1D_tune(Tcl_Interp *interp)
   return TCL_OK;
 }
 
+/** the polygamma sums of the near formula for the radial force, divided
+    by the xy-distance, and the z force, both without prefactors. */
+static void near_force_sums(double rxy2_d, double z_d, double *sr_out, double *sz_out)
+{
+  double sr, sz, r2nm1;
+  int n;
+
+  sr = 0;
+  sz = mod_psi_odd(0, z_d);
+
+  r2nm1 = 1.0;
+  for (n = 1; n < n_modPsi; n++) {
+    double deriv = 2*n;
+    double mpe   = mod_psi_even(n, z_d);
+    double mpo   = mod_psi_odd(n, z_d);
+    double r2n   = r2nm1*rxy2_d;
+
+    sz +=         r2n*mpo;
+    sr += deriv*r2nm1*mpe;
+
+    if (fabs(deriv*r2nm1*mpe) < mmm1d_params.maxPWerror)
+      break;
+
+    r2nm1 = r2n;
+  }
+  // fprintf(stderr, "max_n %d\n", n);
+
+  *sr_out = sr;
+  *sz_out = sz;
+}
+
+/** the polygamma sum of the near formula for the energy, without prefactors. */
+static double near_energy_sum(double rxy2_d, double z_d)
+{
+  double E, r2n;
+  int n;
+
+  E = -2*C_GAMMA;
+
+  r2n = 1.0;
+  for (n = 0; n < n_modPsi; n++) {
+    double add = mod_psi_even(n, z_d)*r2n;
+    E -= add;
+      
+    if (fabs(add) < mmm1d_params.maxPWerror)
+      break;
+ 
+    r2n *= rxy2_d;
+  }
+  return E;
+}
+
+/** the Bessel sums of the far formula for the radial and the z force. */
+static void far_force_sums(double rxy_d, double z_d, double *sr_out, double *sz_out)
+{
+  double sr = 0, sz = 0;
+  int bp;
+
+  for (bp = 1; bp < mmm1d_params.bessel_cutoff; bp++) {
+    double fq = C_2PI*bp, k0, k1;
+#ifdef BESSEL_MACHINE_PREC
+    k0 = K0(fq*rxy_d);
+    k1 = K1(fq*rxy_d);
+#else
+    LPK01(fq*rxy_d, &k0, &k1);
+#endif
+    sr += bp*k1*cos(fq*z_d);
+    sz += bp*k0*sin(fq*z_d);
+  }
+  *sr_out = sr*uz2*4*C_2PI;
+  *sz_out = sz*uz2*4*C_2PI;
+}
+
+/** the Bessel sum of the far formula for the energy. */
+static double far_energy_sum(double rxy_d, double z_d)
+{
+  double E = 0;
+  int bp;
+
+  for (bp = 1; bp < mmm1d_params.bessel_cutoff; bp++) {
+    double fq = C_2PI*bp;
+    E += K0(fq*rxy_d)*cos(fq*z_d);
+  }
+  return E;
+}
+
+/** all TAB_VALUES sums of one of the formulas at a point. */
+static void calc_sums(int far, double x, double z_d, double s[TAB_VALUES])
+{
+  if (far) {
+    far_force_sums(x, z_d, &s[0], &s[1]);
+    s[2] = far_energy_sum(x, z_d);
+  }
+  else {
+    near_force_sums(x, z_d, &s[0], &s[1]);
+    s[2] = near_energy_sum(x, z_d);
+  }
+}
+
+/** weights of the cubic Lagrange interpolation through the grid points
+    -1, 0, 1 and 2 at u. */
+MDINLINE void tab_weights(double u, double w[4])
+{
+  w[0] = -u*(u - 1)*(u - 2)/6;
+  w[1] = (u + 1)*(u - 1)*(u - 2)/2;
+  w[2] = -(u + 1)*u*(u - 2)/2;
+  w[3] = (u + 1)*u*(u - 1)/6;
+}
+
+/** first grid point of the interpolation stencil for the coordinate t in
+    grid units, and the relative position u of t with respect to the
+    second stencil point. */
+MDINLINE int tab_stencil(double t, int n, double *u)
+{
+  int i = (int)t;
+  if (i < 1) i = 1;
+  else if (i > n - 2) i = n - 2;
+  *u = t - i;
+  return i - 1;
+}
+
+/** interpolate all TAB_VALUES sums from a table. z_d must be between 0 and 0.5. */
+MDINLINE void tab_interpolate(MMM1D_table *tab, double x, double z_d, double s[TAB_VALUES])
+{
+  double u, v, wx[4], wz[4];
+  int ix = tab_stencil((x - tab->x0)*tab->dx_i, tab->n, &u);
+  int iz = tab_stencil(z_d*tab->dz_i, tab->n, &v);
+  int i, j;
+  double *row;
+
+  tab_weights(u, wx);
+  tab_weights(v, wz);
+  s[0] = s[1] = s[2] = 0;
+  for (i = 0; i < 4; i++) {
+    row = tab->data + ((ix + i)*(tab->n + 1) + iz)*TAB_VALUES;
+    for (j = 0; j < 4; j++) {
+      double w = wx[i]*wz[j];
+      s[0] += w*row[0];
+      s[1] += w*row[1];
+      s[2] += w*row[2];
+      row += TAB_VALUES;
+    }
+  }
+}
+
+/** tabulate the sums of one of the formulas for x between x0 and x1, refining
+    the grid until the interpolation error at the cell centers, weighted
+    with weight, is below the maximal pairwise error. If that is not possible
+    with TAB_MAX_INTERVALS, the table is left empty. */
+static void build_table(MMM1D_table *tab, int far, double x0, double x1, double weight[TAB_VALUES])
+{
+  double s[TAB_VALUES], t[TAB_VALUES], err;
+  int n, i, j, k;
+
+  tab->x0 = x0;
+  tab->x1 = x1;
+  for (n = TAB_MIN_INTERVALS; n <= TAB_MAX_INTERVALS; n *= 2) {
+    tab->n    = n;
+    tab->dx_i = n/(x1 - x0);
+    tab->dz_i = 2*n;
+    tab->data = realloc(tab->data, SQR(n + 1)*TAB_VALUES*sizeof(double));
+    for (i = 0; i <= n; i++)
+      for (j = 0; j <= n; j++)
+	calc_sums(far, x0 + i/tab->dx_i, j/tab->dz_i, tab->data + (i*(n + 1) + j)*TAB_VALUES);
+
+    err = 0;
+    for (i = 0; i < n && err <= mmm1d_params.maxPWerror; i++)
+      for (j = 0; j < n; j++) {
+	double x = x0 + (i + 0.5)/tab->dx_i, z_d = (j + 0.5)/tab->dz_i;
+	calc_sums(far, x, z_d, s);
+	tab_interpolate(tab, x, z_d, t);
+	for (k = 0; k < TAB_VALUES; k++)
+	  err = dmax(err, weight[k]*fabs(s[k] - t[k]));
+      }
+    if (err <= mmm1d_params.maxPWerror)
+      return;
+  }
+  tab->n = 0;
+  free(tab->data);
+  tab->data = NULL;
+}
+
+/** (re)create the lattice sum tables for the current parameters. */
+static void MMM1D_recalc_sum_tables()
+{
+  double weight[TAB_VALUES];
+  double switch_rad = sqrt(mmm1d_params.far_switch_radius_2), far_rad;
+
+  near_tab.n = far_tab.n = 0;
+  if (!mmm1d_params.tabulate || mmm1d_params.far_switch_radius_2 <= 0)
+    return;
+
+  /* the interpolation errors of the forces and energies without the
+     Coulomb prefactor */
+  weight[0] = uz2*uz*switch_rad;
+  weight[1] = uz2;
+  weight[2] = uz;
+  build_table(&near_tab, 0, 0, uz2*mmm1d_params.far_switch_radius_2, weight);
+
+  /* from far_rad on, the whole Bessel sum is below the required accuracy */
+  for (far_rad = switch_rad;
+       far_rad < box_l[2]/RAD_STEPPING &&
+	 determine_bessel_cutoff(far_rad, mmm1d_params.maxPWerror, MAXIMAL_B_CUT) > 1;
+       far_rad += RAD_STEPPING*box_l[2]);
+  weight[0] = weight[1] = 1;
+  weight[2] = 4*uz;
+  build_table(&far_tab, 1, uz*switch_rad, uz*far_rad, weight);
+}
+
 void MMM1D_recalcTables()
 {
   /* polygamma, determine order */
@@ -256,6 +530,8 @@ void MMM1D_recalcTables()
     // fprintf(stderr, "%f\n", err);
   }
   while (err > 0.1*mmm1d_params.maxPWerror);
+
+  MMM1D_recalc_sum_tables();
 }
 
 int MMM1D_sanity_checks()
@@ -267,7 +543,7 @@ int MMM1D_sanity_checks()
     return 1;
   }
 
-  if (cell_structure.type != CELL_STRUCTURE_NSQUARE) {
+  if (cell_structure.type != CELL_STRUCTURE_NSQUARE && mmm1d_params.tree_theta <= 0) {
     errtxt = runtime_error(128);
     ERROR_SPRINTF(errtxt, "{023 MMM1D requires n-square cellsystem} ");
     return 1;
@@ -290,17 +566,13 @@ void MMM1D_init()
   MMM1D_recalcTables();
 }
 
-void add_mmm1d_coulomb_pair_force(Particle *p1, Particle *p2, double d[3], double r2, double r, double force[3])
+/** the force between two unit charges at distance d, including all
+    periodic images. */
+static void mmm1d_force_kernel(double d[3], double r2, double r, double F[3])
 {
-  int dim;
-  double F[3];
-  double chpref = p1->p.q*p2->p.q;
   double rxy2, rxy2_d, z_d;
   double pref;
   double Fx, Fy, Fz;
-  
-  if (chpref == 0)
-    return;
 
   rxy2   = d[0]*d[0] + d[1]*d[1];
   rxy2_d = rxy2*uz2;
@@ -308,29 +580,17 @@ void add_mmm1d_coulomb_pair_force(Particle *p1, Particle *p2, double d[3], doubl
 
   if (rxy2 <= mmm1d_params.far_switch_radius_2) {
     /* near range formula */
-    double sr, sz, r2nm1, rt, rt2, shift_z;
-    int n;
+    double sr, sz, rt, rt2, shift_z;
 
     /* polygamma summation */
-    sr = 0;
-    sz = mod_psi_odd(0, z_d);
-
-    r2nm1 = 1.0;
-    for (n = 1; n < n_modPsi; n++) {
-      double deriv = 2*n;
-      double mpe   = mod_psi_even(n, z_d);
-      double mpo   = mod_psi_odd(n, z_d);
-      double r2n   = r2nm1*rxy2_d;
-
-      sz +=         r2n*mpo;
-      sr += deriv*r2nm1*mpe;
-
-      if (fabs(deriv*r2nm1*mpe) < mmm1d_params.maxPWerror)
-	break;
-
-      r2nm1 = r2n;
+    if (near_tab.n) {
+      double s[TAB_VALUES];
+      tab_interpolate(&near_tab, rxy2_d, fabs(z_d), s);
+      sr = s[0];
+      sz = (z_d < 0) ? -s[1] : s[1];
     }
-    // fprintf(stderr, "max_n %d\n", n);
+    else
+      near_force_sums(rxy2_d, z_d, &sr, &sz);
 
     Fx = prefL3_i*sr*d[0];
     Fy = prefL3_i*sr*d[1];
@@ -367,22 +627,20 @@ void add_mmm1d_coulomb_pair_force(Particle *p1, Particle *p2, double d[3], doubl
     /* far range formula */
     double rxy   = sqrt(rxy2);
     double rxy_d = rxy*uz;
-    double sr = 0, sz = 0;
-    int bp;
-
-    for (bp = 1; bp < mmm1d_params.bessel_cutoff; bp++) {
-      double fq = C_2PI*bp, k0, k1;
-#ifdef BESSEL_MACHINE_PREC
-      k0 = K0(fq*rxy_d);
-      k1 = K1(fq*rxy_d);
-#else
-      LPK01(fq*rxy_d, &k0, &k1);
-#endif
-      sr += bp*k1*cos(fq*z_d);
-      sz += bp*k0*sin(fq*z_d);
+    double sr, sz;
+
+    if (far_tab.n) {
+      double s[TAB_VALUES];
+      if (rxy_d < far_tab.x1) {
+	tab_interpolate(&far_tab, rxy_d, fabs(z_d), s);
+	sr = s[0];
+	sz = (z_d < 0) ? -s[1] : s[1];
+      }
+      else
+	sr = sz = 0;
     }
-    sr *= uz2*4*C_2PI;
-    sz *= uz2*4*C_2PI;
+    else
+      far_force_sums(rxy_d, z_d, &sr, &sz);
     
     pref = coulomb.prefactor*(sr/rxy + 2*uz/rxy2);
 
@@ -390,42 +648,47 @@ void add_mmm1d_coulomb_pair_force(Particle *p1, Particle *p2, double d[3], doubl
     F[1] = pref*d[1];
     F[2] = coulomb.prefactor*sz;
   }
+}
+
+void add_mmm1d_coulomb_pair_force(Particle *p1, Particle *p2, double d[3], double r2, double r, double force[3])
+{
+  int dim;
+  double F[3];
+  double chpref = p1->p.q*p2->p.q;
+  
+  /* with the tree, all pairs are handled by MMM1D_tree_add_forces */
+  if (chpref == 0 || mmm1d_params.tree_theta > 0)
+    return;
+
+  mmm1d_force_kernel(d, r2, r, F);
 
   for (dim = 0; dim < 3; dim++)
     force[dim] += chpref * F[dim];
 }
 
-double mmm1d_coulomb_pair_energy(Particle *p1, Particle *p2, double d[3], double r2, double r)
+/** the energy of two unit charges at distance d, including all
+    periodic images. */
+static double mmm1d_energy_kernel(double d[3], double r2, double r)
 {
-  double chpref = p1->p.q*p2->p.q;
   double rxy2, rxy2_d, z_d;
   double E;
 
-  if (chpref == 0)
-    return 0;
-
   rxy2   = d[0]*d[0] + d[1]*d[1];
   rxy2_d = rxy2*uz2;
   z_d    = d[2]*uz;
 
   if (rxy2 <= mmm1d_params.far_switch_radius_2) {
     /* near range formula */
-    double r2n, rt, shift_z;
-    int n;
-
-    E = -2*C_GAMMA;
+    double rt, shift_z;
 
     /* polygamma summation */
-    r2n = 1.0;
-    for (n = 0; n < n_modPsi; n++) {
-      double add = mod_psi_even(n, z_d)*r2n;
-      E -= add;
-      
-      if (fabs(add) < mmm1d_params.maxPWerror)
-	break;
- 
-      r2n *= rxy2_d;
+    if (near_tab.n) {
+      double s[TAB_VALUES];
+      tab_interpolate(&near_tab, rxy2_d, fabs(z_d), s);
+      E = s[2];
     }
+    else
+      E = near_energy_sum(rxy2_d, z_d);
     E *= coulomb.prefactor*uz;
 
     /* real space parts */
@@ -444,18 +707,204 @@ double mmm1d_coulomb_pair_energy(Particle *p1, Particle *p2, double d[3], double
     /* far range formula */
     double rxy   = sqrt(rxy2);
     double rxy_d = rxy*uz;
-    int bp;
     /* The first Bessel term will compensate a little bit the
        log term, so add them close together */
     E = -0.25*log(rxy2_d) + 0.5*(M_LN2 - C_GAMMA);
-    for (bp = 1; bp < mmm1d_params.bessel_cutoff; bp++) {
-      double fq = C_2PI*bp;
-      E += K0(fq*rxy_d)*cos(fq*z_d);
+    if (far_tab.n) {
+      double s[TAB_VALUES];
+      if (rxy_d < far_tab.x1) {
+	tab_interpolate(&far_tab, rxy_d, fabs(z_d), s);
+	E += s[2];
+      }
     }
+    else
+      E += far_energy_sum(rxy_d, z_d);
     E *= 4*coulomb.prefactor*uz;
   }
 
-  return chpref*E;
+  return E;
+}
+
+double mmm1d_coulomb_pair_energy(Particle *p1, Particle *p2, double d[3], double r2, double r)
+{
+  double chpref = p1->p.q*p2->p.q;
+
+  if (chpref == 0 || mmm1d_params.tree_theta > 0)
+    return 0;
+
+  return chpref*mmm1d_energy_kernel(d, r2, r);
+}
+
+/****************************************
+ * Barnes-Hut tree
+ ****************************************/
+
+/** a charge for the tree, with its position folded into the primary box
+    in z, since the tree is built from 0 to box_l[2]. */
+static int tree_charge(Particle *p, double pos[3], double v[3])
+{
+  if (p->p.q == 0.0)
+    return 0;
+  pos[0] = p->r.p[0];
+  pos[1] = p->r.p[1];
+  pos[2] = p->r.p[2] - floor(p->r.p[2]*uz)*box_l[2];
+  v[0]   = p->p.q;
+  return 1;
+}
+
+/** the charges and centers of charge of the positive and negative charges */
+static void tree_moments(OctreeNode *node, OctreeItem *items)
+{
+  OctreeChargeMoments *m = &node->m.charge;
+  int i, j, s;
+
+  for (s = 0; s < 2; s++) {
+    m->q[s] = 0;
+    for (j = 0; j < 3; j++)
+      m->c[s][j] = 0;
+  }
+  for (i = node->start; i < node->start + node->n; i++) {
+    double q = items[i].v[0];
+    s = (q > 0) ? 0 : 1;
+    m->q[s] += q;
+    for (j = 0; j < 3; j++)
+      m->c[s][j] += q*items[i].pos[j];
+  }
+  for (s = 0; s < 2; s++)
+    if (m->q[s] != 0)
+      for (j = 0; j < 3; j++)
+	m->c[s][j] /= m->q[s];
+}
+
+/** gather all charges to all nodes and build the tree over them. */
+static void tree_setup()
+{
+  double lo[3], hi[3], center[3], size;
+
+  octree_gather(&tree, tree_charge);
+
+  /* the root cube spans the charges in xy and the box in z */
+  octree_bounds(&tree, lo, hi);
+  size = dmax(box_l[2], dmax(hi[0] - lo[0], hi[1] - lo[1]));
+  center[0] = 0.5*(lo[0] + hi[0]);
+  center[1] = 0.5*(lo[1] + hi[1]);
+  center[2] = 0.5*box_l[2];
+
+  octree_build(&tree, center, size, tree_moments);
+}
+
+/** the field (and potential) at pos from all charges of a node and its
+    children, except for the charge with identity self. A node is replaced
+    by its positive and negative centers of charge if it is far enough away,
+    i. e. its edge length is smaller than theta times the distance. */
+static void tree_field(int nidx, double pos[3], int self, int energy_flag, double F[3], double *E)
+{
+  OctreeNode *node = &tree.nodes[nidx];
+  OctreeChargeMoments *m = &node->m.charge;
+  OctreeItem *item;
+  double d[3], r2, dist, Fk[3];
+  int i, j, s, oct, accept;
+
+  /* never approximate a node which contains pos */
+  get_mi_vector(d, pos, node->center);
+  accept = (fabs(d[0]) > 0.5*node->size || fabs(d[1]) > 0.5*node->size ||
+	    fabs(d[2]) > 0.5*node->size);
+  for (s = 0; s < 2 && accept; s++)
+    if (m->q[s] != 0) {
+      get_mi_vector(d, pos, m->c[s]);
+      if (SQR(node->size) >= SQR(mmm1d_params.tree_theta)*sqrlen(d))
+	accept = 0;
+    }
+
+  if (accept) {
+    for (s = 0; s < 2; s++)
+      if (m->q[s] != 0) {
+	get_mi_vector(d, pos, m->c[s]);
+	r2 = sqrlen(d);
+	dist = sqrt(r2);
+	if (energy_flag)
+	  *E += m->q[s]*mmm1d_energy_kernel(d, r2, dist);
+	else {
+	  mmm1d_force_kernel(d, r2, dist, Fk);
+	  for (j = 0; j < 3; j++)
+	    F[j] += m->q[s]*Fk[j];
+	}
+      }
+  }
+  else if (octree_is_leaf(node)) {
+    /* leaf, direct summation */
+    for (i = node->start; i < node->start + node->n; i++) {
+      item = &tree.items[i];
+      if (item->identity == self)
+	continue;
+      get_mi_vector(d, pos, item->pos);
+      r2 = sqrlen(d);
+      dist = sqrt(r2);
+      if (energy_flag)
+	*E += item->v[0]*mmm1d_energy_kernel(d, r2, dist);
+      else {
+	mmm1d_force_kernel(d, r2, dist, Fk);
+	for (j = 0; j < 3; j++)
+	  F[j] += item->v[0]*Fk[j];
+      }
+    }
+  }
+  else {
+    for (oct = 0; oct < 8; oct++)
+      if (node->child[oct] != -1)
+	tree_field(node->child[oct], pos, self, energy_flag, F, E);
+  }
+}
+
+void MMM1D_tree_add_forces()
+{
+  Cell *cell;
+  Particle *p;
+  int c, i, j, np;
+  double F[3], E;
+
+  tree_setup();
+  if (tree.n_nodes == 0)
+    return;
+
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for (i = 0; i < np; i++)
+      if (p[i].p.q != 0.0) {
+	F[0] = F[1] = F[2] = 0;
+	tree_field(0, p[i].r.p, p[i].p.identity, 0, F, &E);
+	for (j = 0; j < 3; j++)
+	  p[i].f.f[j] += p[i].p.q*F[j];
+      }
+  }
+}
+
+double MMM1D_tree_energy()
+{
+  Cell *cell;
+  Particle *p;
+  int c, i, np;
+  double F[3], E, energy = 0;
+
+  tree_setup();
+  if (tree.n_nodes == 0)
+    return 0;
+
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for (i = 0; i < np; i++)
+      if (p[i].p.q != 0.0) {
+	E = 0;
+	tree_field(0, p[i].r.p, p[i].p.identity, 1, F, &E);
+	energy += p[i].p.q*E;
+      }
+  }
+  /* every pair was counted twice */
+  return 0.5*energy;
 }
 
 #endif
@@ -11,6 +11,8 @@
     periodic systems. For details on the method see \ref MMM_general. The MMM1D method works only with the
     nsquared \ref tcl_cellsystem "cell system", since neither the near nor far formula can be decomposed. However,
     this implementation is reasonably fast, so that one can use up to 200 charges easily in a simulation.
+    For larger systems, the pairs can be summed up using a Barnes-Hut tree instead, which works with any
+    cell system.
 */
 #ifndef MMM1D_H
 #define MMM1D_H
@@ -36,6 +38,17 @@ typedef struct {
   int    bessel_calculated;
   /** required accuracy */
   double maxPWerror;
+  /** Whether to interpolate the polygamma and Bessel sums from tables
+      instead of summing them up for every pair. The tables are created
+      whenever the parameters change and are refined until they reproduce
+      the sums within the maximal pairwise error. */
+  int    tabulate;
+  /** If positive, the opening angle of the Barnes-Hut tree. Then the
+      pairs are not calculated in the pair loops, but for all charges
+      in \ref MMM1D_tree_add_forces, where distant groups of charges are
+      replaced by their centers of positive and negative charge. This
+      scales as N log N and also works with domain decomposition. */
+  double tree_theta;
 } MMM1D_struct;
 extern MMM1D_struct mmm1d_params;
 
@@ -53,14 +66,19 @@ int inter_parse_mmm1d(Tcl_Interp *interp, int argc, char **argv);
     @param bessel_cutoff the cutoff for the bessel sum, aka far formula. Normally set this
                          to -1, then the cutoff is automatically determined using the error formula.
     @param maxPWerror the maximal allowed error for the potential and the forces without the
-                      prefactors, i. e. for the pure lattice 1/r-sum. */
-int MMM1D_set_params(double switch_rad, int bessel_cutoff, double maxPWerror);
+                      prefactors, i. e. for the pure lattice 1/r-sum.
+    @param tabulate whether to interpolate the lattice sums from tables, see
+                    \ref MMM1D_struct::tabulate.
+    @param tree_theta opening angle of the tree, or 0 for the direct pair
+                      calculation, see \ref MMM1D_struct::tree_theta. */
+int MMM1D_set_params(double switch_rad, int bessel_cutoff, double maxPWerror, int tabulate, double tree_theta);
 
 /** tuning of the parameters which are not set by the user, e.g. the switching radius or the
     bessel_cutoff. */
 int MMM1D_tune(Tcl_Interp *interp);
 
-/** recalculate the polygamma taylor series. */
+/** recalculate the polygamma taylor series and, if requested, the
+    tables of the lattice sums. */
 void MMM1D_recalcTables();
 
 /// check that MMM1D can run with the current parameters
@@ -76,5 +94,13 @@ void add_mmm1d_coulomb_pair_force(Particle *p1, Particle *p2, double d[3], doubl
 ///
 double mmm1d_coulomb_pair_energy(Particle *p1, Particle *p2, double d[3], double r2, double r);
 
+/** add the forces of all charges on the local particles using the tree,
+    if \ref MMM1D_struct::tree_theta is set. */
+void MMM1D_tree_add_forces();
+
+/** the energy of the local particles in the field of all charges using
+    the tree, if \ref MMM1D_struct::tree_theta is set. */
+double MMM1D_tree_energy();
+
 #endif
 #endif
@@ -280,22 +280,27 @@ void MMM2D_setup_constants()
 static void prepare_scx_cache()
 {
   int np, c, i, ic, freq, o;
-  double pref, arg;
+  double pref, arg, s1, c1;
   Particle *part;
   
-  for (freq = 1; freq <= n_scxcache; freq++) {
-    pref = C_2PI*ux*freq;
-    o = (freq-1)*n_localpart;
-    ic = 0;
-    for (c = 1; c <= n_layers; c++) {
-      np   = cells[c].n;
-      part = cells[c].part;
-      for (i = 0; i < np; i++) {
-	arg = pref*part[i].r.p[0];
-	scxcache[o + ic].s = sin(arg);
-	scxcache[o + ic].c = cos(arg);
-	ic++;
+  pref = C_2PI*ux;
+  ic = 0;
+  for (c = 1; c <= n_layers; c++) {
+    np   = cells[c].n;
+    part = cells[c].part;
+    for (i = 0; i < np; i++) {
+      arg = pref*part[i].r.p[0];
+      s1 = sin(arg);
+      c1 = cos(arg);
+      scxcache[ic].s = s1;
+      scxcache[ic].c = c1;
+      /* the higher frequencies from the addition theorems */
+      for (freq = 2; freq <= n_scxcache; freq++) {
+	o = (freq-1)*n_localpart + ic;
+	scxcache[o].s = scxcache[o - n_localpart].s*c1 + scxcache[o - n_localpart].c*s1;
+	scxcache[o].c = scxcache[o - n_localpart].c*c1 - scxcache[o - n_localpart].s*s1;
       }
+      ic++;
     }
   }
 }
@@ -303,22 +308,27 @@ static void prepare_scx_cache()
 static void prepare_scy_cache()
 {
   int np, c, i, ic, freq, o;
-  double pref, arg;
+  double pref, arg, s1, c1;
   Particle *part;
   
-  for (freq = 1; freq <= n_scycache; freq++) {
-    pref = C_2PI*uy*freq;
-    o = (freq-1)*n_localpart;
-    ic = 0;
-    for (c = 1; c <= n_layers; c++) {
-      np   = cells[c].n;
-      part = cells[c].part;
-      for (i = 0; i < np; i++) {
-	arg = pref*part[i].r.p[1];
-	scycache[o + ic].s = sin(arg);
-	scycache[o + ic].c = cos(arg);
-	ic++;
+  pref = C_2PI*uy;
+  ic = 0;
+  for (c = 1; c <= n_layers; c++) {
+    np   = cells[c].n;
+    part = cells[c].part;
+    for (i = 0; i < np; i++) {
+      arg = pref*part[i].r.p[1];
+      s1 = sin(arg);
+      c1 = cos(arg);
+      scycache[ic].s = s1;
+      scycache[ic].c = c1;
+      /* the higher frequencies from the addition theorems */
+      for (freq = 2; freq <= n_scycache; freq++) {
+	o = (freq-1)*n_localpart + ic;
+	scycache[o].s = scycache[o - n_localpart].s*c1 + scycache[o - n_localpart].c*s1;
+	scycache[o].c = scycache[o - n_localpart].c*c1 - scycache[o - n_localpart].s*s1;
       }
+      ic++;
     }
   }
 }
@@ -111,6 +111,9 @@ MDINLINE int MPI_Type_extent(MPI_Datatype dtype, MPI_Aint *pextent) { *pextent =
 MDINLINE int MPI_Barrier(MPI_Comm comm) { return MPI_SUCCESS; }
 MDINLINE int MPI_Waitall(int count, MPI_Request *reqs, MPI_Status *stats) { return MPI_SUCCESS; }
 MDINLINE int MPI_Wait(MPI_Request *reqs, MPI_Status *stats) { return MPI_SUCCESS; }
+MDINLINE int MPI_Start(MPI_Request *req) { return MPI_SUCCESS; }
+MDINLINE int MPI_Startall(int count, MPI_Request *reqs) { return MPI_SUCCESS; }
+MDINLINE int MPI_Request_free(MPI_Request *req) { *req = MPI_REQUEST_NULL; return MPI_SUCCESS; }
 MDINLINE int MPI_Errhandler_create(MPI_Handler_function *errfunc, MPI_Errhandler *errhdl) { return MPI_SUCCESS; }
 MDINLINE int MPI_Errhandler_set(MPI_Comm comm, MPI_Errhandler errhdl) { return MPI_SUCCESS; }
 MDINLINE int MPI_Bcast(void *buff, int count, MPI_Datatype datatype, int root, MPI_Comm comm) { return MPI_SUCCESS; }
@@ -128,6 +131,10 @@ MDINLINE int MPI_Sendrecv(void *sbuf, int scount, MPI_Datatype stype, int dst, i
 }
 MDINLINE int MPI_Isend(void *buf, int count, MPI_Datatype dtype, int dst, int tag, MPI_Comm comm, MPI_Request *req) {
   fprintf(stderr, "MPI_Recv on a single node\n"); errexit(); return MPI_SUCCESS; }
+MDINLINE int MPI_Send_init(void *buf, int count, MPI_Datatype dtype, int dst, int tag, MPI_Comm comm, MPI_Request *req) {
+  fprintf(stderr, "MPI_Send_init on a single node\n"); errexit(); return MPI_SUCCESS; }
+MDINLINE int MPI_Recv_init(void *buf, int count, MPI_Datatype dtype, int src, int tag, MPI_Comm comm, MPI_Request *req) {
+  fprintf(stderr, "MPI_Recv_init on a single node\n"); errexit(); return MPI_SUCCESS; }
 
 #else
 
@@ -140,6 +147,8 @@ MDINLINE int __MPI_ERR(char *func, char *file, int line) {
 #define MPI_Irecv(buf, count, dtype, src, tag, comm, req) __MPI_ERR("MPI_IRecv", __FILE__, __LINE__)
 #define MPI_Send(buf, count, dtype, dst, tag, comm) __MPI_ERR("MPI_Send", __FILE__, __LINE__)
 #define MPI_Isend(buf, count, dtype, dst, tag, comm, req) __MPI_ERR("MPI_Isend", __FILE__, __LINE__)
+#define MPI_Send_init(buf, count, dtype, dst, tag, comm, req) __MPI_ERR("MPI_Send_init", __FILE__, __LINE__)
+#define MPI_Recv_init(buf, count, dtype, src, tag, comm, req) __MPI_ERR("MPI_Recv_init", __FILE__, __LINE__)
 #define MPI_Sendrecv(sbuf, scount, stype, dst, stag, rbuf, rcount, rtype, src, rtag, comm, stat) \
   __MPI_ERR("MPI_Sendrecv", __FILE__, __LINE__)
 
@@ -153,10 +162,20 @@ MDINLINE int MPI_Allgather(void *sbuf, int scount, MPI_Datatype sdtype,
 			   void *rbuf, int rcount, MPI_Datatype rdtype,
 			   MPI_Comm comm)
 { return mpifake_sendrecv(sbuf, scount, sdtype, rbuf, rcount, rdtype); }
+MDINLINE int MPI_Allgatherv(void *sbuf, int scount, MPI_Datatype sdtype,
+			    void *rbuf, int *rcounts, int *displs, MPI_Datatype rdtype,
+			    MPI_Comm comm)
+{ return mpifake_sendrecv(sbuf, scount, sdtype,
+			  (char *)rbuf + displs[0]*(rdtype->upper - rdtype->lower), rcounts[0], rdtype); }
 MDINLINE int MPI_Scatter(void *sbuf, int scount, MPI_Datatype sdtype,
 			 void *rbuf, int rcount, MPI_Datatype rdtype,
 			 int root, MPI_Comm comm)
 { return mpifake_sendrecv(sbuf, scount, sdtype, rbuf, rcount, rdtype); }
+MDINLINE int MPI_Alltoallv(void *sbuf, int *scounts, int *sdispls, MPI_Datatype sdtype,
+			   void *rbuf, int *rcounts, int *rdispls, MPI_Datatype rdtype,
+			   MPI_Comm comm)
+{ return mpifake_sendrecv((char *)sbuf + sdispls[0]*(sdtype->upper - sdtype->lower), scounts[0], sdtype,
+			  (char *)rbuf + rdispls[0]*(rdtype->upper - rdtype->lower), rcounts[0], rdtype); }
 MDINLINE int MPI_Op_create(MPI_User_function func, int commute, MPI_Op *pop) { *pop = func; return MPI_SUCCESS; }
 MDINLINE int MPI_Reduce(void *sbuf, void* rbuf, int count, MPI_Datatype dtype, MPI_Op op, int root, MPI_Comm comm)
 { op(sbuf, rbuf, &count, &dtype); return MPI_SUCCESS; }
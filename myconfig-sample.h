@@ -41,6 +41,7 @@
 /* #define ADRESS*/
 /* #define DAWAANR */
 /* #define MAGNETIC_DIPOLAR_DIRECT_SUM */
+/* #define DIPOLAR_BARNES_HUT */
 /* #define MDLC */
 /* #define METADYNAMICS */
 /* #define OVERLAPPED */
@@ -0,0 +1,172 @@
+// This file is part of the ESPResSo distribution (http://www.espresso.mpg.de).
+// It is therefore subject to the ESPResSo license agreement which you accepted upon receiving the distribution
+// and by which you are legally bound while utilizing this file in any form or way.
+// There is NO WARRANTY, not even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// You should have received a copy of that license along with this program;
+// if not, refer to http://www.espresso.mpg.de/license.html where its current version can be found, or
+// write to Max-Planck-Institute for Polymer Research, Theory Group, PO Box 3148, 55021 Mainz, Germany.
+// Copyright (c) 2002-2009; all rights reserved unless otherwise stated.
+/** \file octree.c Octree over the charges or dipoles of all nodes.
+ *
+ *  For more information, see \ref octree.h "octree.h".
+ */
+
+#include <mpi.h>
+#include <string.h>
+#include "utils.h"
+#include "octree.h"
+#include "communication.h"
+#include "cells.h"
+
+#if defined(ELECTROSTATICS) || defined(DIPOLAR_BARNES_HUT)
+
+/** maximal number of items in a leaf */
+#define OCTREE_LEAF_SIZE 8
+/** maximal depth of the tree, protects against coinciding items */
+#define OCTREE_MAX_DEPTH 30
+/** number of doubles per communicated item: position, value and identity */
+#define OCTREE_ITEM_DOUBLES 7
+/** granularity of the item and tree node arrays */
+#define OCTREE_ITEM_GRAN 256
+#define OCTREE_NODE_GRAN 256
+
+/** the octant of pos in a cube around center. */
+MDINLINE int octree_octant(double pos[3], double center[3])
+{
+  return (pos[0] > center[0]) + 2*(pos[1] > center[1]) + 4*(pos[2] > center[2]);
+}
+
+void octree_gather(Octree *tree, octree_item_function item)
+{
+  Cell *cell;
+  Particle *p;
+  int c, i, j, np, n_local = 0, n_total, node;
+  double *data;
+
+  /* the local items */
+  for (c = 0; c < local_cells.n; c++) {
+    cell = local_cells.cell[c];
+    p  = cell->part;
+    np = cell->n;
+    for (i = 0; i < np; i++) {
+      if (n_local >= tree->send_size) {
+	tree->send_size += OCTREE_ITEM_GRAN;
+	tree->send = realloc(tree->send, tree->send_size*OCTREE_ITEM_DOUBLES*sizeof(double));
+      }
+      data = tree->send + OCTREE_ITEM_DOUBLES*n_local;
+      data[3] = data[4] = data[5] = 0;
+      if (item(&p[i], data, data + 3)) {
+	data[6] = p[i].p.identity;
+	n_local++;
+      }
+    }
+  }
+
+  /* and the ones of all nodes */
+  tree->counts = realloc(tree->counts, n_nodes*sizeof(int));
+  tree->displs = realloc(tree->displs, n_nodes*sizeof(int));
+  n_local *= OCTREE_ITEM_DOUBLES;
+  MPI_Allgather(&n_local, 1, MPI_INT, tree->counts, 1, MPI_INT, MPI_COMM_WORLD);
+  n_total = 0;
+  for (node = 0; node < n_nodes; node++) {
+    tree->displs[node] = n_total;
+    n_total += tree->counts[node];
+  }
+  tree->recv = realloc(tree->recv, n_total*sizeof(double));
+  MPI_Allgatherv(tree->send, n_local, MPI_DOUBLE,
+		 tree->recv, tree->counts, tree->displs, MPI_DOUBLE, MPI_COMM_WORLD);
+  n_total /= OCTREE_ITEM_DOUBLES;
+
+  if (n_total > tree->items_size) {
+    tree->items_size = n_total;
+    tree->items  = realloc(tree->items, n_total*sizeof(OctreeItem));
+    tree->buffer = realloc(tree->buffer, n_total*sizeof(OctreeItem));
+  }
+  for (i = 0; i < n_total; i++) {
+    data = tree->recv + OCTREE_ITEM_DOUBLES*i;
+    for (j = 0; j < 3; j++) {
+      tree->items[i].pos[j] = data[j];
+      tree->items[i].v[j]   = data[3 + j];
+    }
+    tree->items[i].identity = (int)data[6];
+  }
+  tree->n_items = n_total;
+  tree->n_nodes = 0;
+}
+
+void octree_bounds(Octree *tree, double lo[3], double hi[3])
+{
+  int i, j;
+
+  for (j = 0; j < 3; j++)
+    lo[j] = hi[j] = (tree->n_items > 0) ? tree->items[0].pos[j] : 0;
+  for (i = 1; i < tree->n_items; i++)
+    for (j = 0; j < 3; j++) {
+      if (tree->items[i].pos[j] < lo[j]) lo[j] = tree->items[i].pos[j];
+      if (tree->items[i].pos[j] > hi[j]) hi[j] = tree->items[i].pos[j];
+    }
+}
+
+/** create the tree node for the items start to start+n-1 in a cube
+    of given center and edge length, and recursively its children. */
+static int octree_build_node(Octree *tree, int start, int n, double center[3], double size,
+			     int depth, octree_moments_function moments)
+{
+  OctreeNode *node;
+  int i, j, oct, nidx, cnt[8], first[8];
+
+  if (tree->n_nodes >= tree->nodes_size) {
+    tree->nodes_size += OCTREE_NODE_GRAN;
+    tree->nodes = realloc(tree->nodes, tree->nodes_size*sizeof(OctreeNode));
+  }
+  nidx = tree->n_nodes++;
+  node = &tree->nodes[nidx];
+
+  for (j = 0; j < 3; j++)
+    node->center[j] = center[j];
+  node->size  = size;
+  node->start = start;
+  node->n     = n;
+  moments(node, tree->items);
+
+  for (oct = 0; oct < 8; oct++)
+    node->child[oct] = -1;
+  if (n <= OCTREE_LEAF_SIZE || depth >= OCTREE_MAX_DEPTH)
+    return nidx;
+
+  /* sort the items into the octants */
+  for (oct = 0; oct < 8; oct++)
+    cnt[oct] = 0;
+  for (i = start; i < start + n; i++)
+    cnt[octree_octant(tree->items[i].pos, center)]++;
+  first[0] = start;
+  for (oct = 1; oct < 8; oct++)
+    first[oct] = first[oct - 1] + cnt[oct - 1];
+  for (i = start; i < start + n; i++)
+    tree->buffer[first[octree_octant(tree->items[i].pos, center)]++] = tree->items[i];
+  memcpy(tree->items + start, tree->buffer + start, n*sizeof(OctreeItem));
+
+  i = start;
+  for (oct = 0; oct < 8; oct++) {
+    if (cnt[oct] > 0) {
+      double c_center[3];
+      int child;
+      for (j = 0; j < 3; j++)
+	c_center[j] = center[j] + ((oct & (1 << j)) ? 0.25 : -0.25)*size;
+      child = octree_build_node(tree, i, cnt[oct], c_center, 0.5*size, depth + 1, moments);
+      /* the node array may have been reallocated */
+      tree->nodes[nidx].child[oct] = child;
+    }
+    i += cnt[oct];
+  }
+  return nidx;
+}
+
+void octree_build(Octree *tree, double center[3], double size, octree_moments_function moments)
+{
+  tree->n_nodes = 0;
+  if (tree->n_items > 0)
+    octree_build_node(tree, 0, tree->n_items, center, size, 0, moments);
+}
+
+#endif
@@ -0,0 +1,112 @@
+// This file is part of the ESPResSo distribution (http://www.espresso.mpg.de).
+// It is therefore subject to the ESPResSo license agreement which you accepted upon receiving the distribution
+// and by which you are legally bound while utilizing this file in any form or way.
+// There is NO WARRANTY, not even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// You should have received a copy of that license along with this program;
+// if not, refer to http://www.espresso.mpg.de/license.html where its current version can be found, or
+// write to Max-Planck-Institute for Polymer Research, Theory Group, PO Box 3148, 55021 Mainz, Germany.
+// Copyright (c) 2002-2009; all rights reserved unless otherwise stated.
+/** \file octree.h Octree over the charges or dipoles of all nodes, for
+    the Barnes-Hut summations of \ref mmm1d.h "MMM1D" and of the
+    \ref magnetic_non_p3m__methods.h "dipolar Barnes-Hut method".
+
+    The items of all nodes are gathered to every node and sorted into
+    an octree, so that each node can sum the interactions of its local
+    particles with all others. The tree only stores the geometry. The
+    moments of a tree node, e.g. the centers of charge, are calculated
+    by a function of the user of the tree, who also walks the tree with
+    the appropriate acceptance criterion.
+*/
+#ifndef OCTREE_H
+#define OCTREE_H
+
+#include "utils.h"
+#include "particle_data.h"
+
+#if defined(ELECTROSTATICS) || defined(DIPOLAR_BARNES_HUT)
+
+/** an item in the tree, i. e. a charge or a dipole */
+typedef struct {
+  double pos[3];
+  /** the charge (first entry only) or the dipole moment */
+  double v[3];
+  int identity;
+} OctreeItem;
+
+/** moments of a tree node that contains charges */
+typedef struct {
+  /** total positive (0) and negative (1) charge */
+  double q[2];
+  /** centers of the positive (0) and negative (1) charges */
+  double c[2][3];
+} OctreeChargeMoments;
+
+/** moments of a tree node that contains dipoles */
+typedef struct {
+  /** total dipole moment */
+  double dip[3];
+  /** center of the dipoles, weighted by their magnitude. The first order
+      error of the total dipole vanishes for parallel dipoles. */
+  double c[3];
+} OctreeDipoleMoments;
+
+/** a node of the tree, i. e. a cube containing the items start to start+n-1 */
+typedef struct {
+  /** center and edge length of the cube */
+  double center[3], size;
+  /** range in \ref Octree::items */
+  int start, n;
+  /** index of the child nodes per octant, -1 if empty */
+  int child[8];
+  /** set by the \ref octree_moments_function of the user */
+  union {
+    OctreeChargeMoments charge;
+    OctreeDipoleMoments dipole;
+  } m;
+} OctreeNode;
+
+/** an octree. All fields are managed by the octree functions, a static
+    instance initialized to zero is an empty tree. */
+typedef struct {
+  /** all items of the system, sorted by tree node */
+  OctreeItem *items;
+  int n_items;
+  /** the tree nodes, the root is the first one */
+  OctreeNode *nodes;
+  int n_nodes;
+  /** sizes of the arrays and scratch space */
+  int items_size, nodes_size;
+  OctreeItem *buffer;
+  /** communication buffers for gathering the items */
+  double *send, *recv;
+  int send_size, *counts, *displs;
+} Octree;
+
+/** fills in pos and v for a local particle and returns 1 if it goes into the tree. */
+typedef int (*octree_item_function)(Particle *p, double pos[3], double v[3]);
+
+/** calculates the moments of a node from its items. */
+typedef void (*octree_moments_function)(OctreeNode *node, OctreeItem *items);
+
+/** gather the items of all nodes to all nodes into tree->items.
+    Collective. */
+void octree_gather(Octree *tree, octree_item_function item);
+
+/** build the tree over the gathered items in a cube of given center
+    and edge length, which should contain all items. */
+void octree_build(Octree *tree, double center[3], double size, octree_moments_function moments);
+
+/** the bounding box of the gathered items. */
+void octree_bounds(Octree *tree, double lo[3], double hi[3]);
+
+/** whether a node has no children. */
+MDINLINE int octree_is_leaf(OctreeNode *node)
+{
+  return (node->child[0] == -1 && node->child[1] == -1 && node->child[2] == -1 &&
+	  node->child[3] == -1 && node->child[4] == -1 && node->child[5] == -1 &&
+	  node->child[6] == -1 && node->child[7] == -1);
+}
+
+#endif
+
+#endif
@@ -47,18 +47,30 @@
   double *meshift = NULL;
 /** Spatial differential operator in k-space. We use an i*k differentiation. */
   double *d_op = NULL;
-/** Force optimised influence function (k-space) */
+/** Force optimised influence function (k-space, half spectrum, see \ref fft_ks_half_dim) */
   double *g_force = NULL;
-/** Energy optimised influence function (k-space) */
+/** Energy optimised influence function (k-space, half spectrum,
+    including the multiplicity of the modes, see \ref calc_influence_function_energy) */
 double *g_energy = NULL;
 /** number of charged particles on the node. */
 int ca_num=0;
-/** Charge fractions for mesh assignment. */
+/** One dimensional charge assignment weights, 3*cao per charged
+    particle. The first cao weights include the charge. */
 double *ca_frac = NULL;
 /** index of first mesh point for charge assignment. */
 int *ca_fmp = NULL;
 /** number of permutations in k_space */
 int ks_pnum;
+#ifdef _OPENMP
+/** index of the first charge of each local cell in \ref ca_frac,
+    see \ref count_cell_charges. */
+static int *cell_charge_start = NULL;
+/** private charge assignment meshes of the threads other than the
+    master thread. */
+static double *thread_rs_mesh = NULL;
+/** allocated size of thread_rs_mesh. */
+static int thread_rs_mesh_size = 0;
+#endif
 
 
 /** number of charged particles (only on master node). */
@@ -67,6 +79,9 @@ int p3m_sum_qpart=0;
 double p3m_sum_q2 = 0.0;
 /** square of sum of charges (only on master node). */
 double p3m_square_sum_q = 0.0;
+/** sum of the charges, needed for the change of the net charge
+    correction in \ref P3M_energy_change. */
+static double p3m_sum_q = 0.0;
 
 /** local mesh. */
 local_mesh lm;
@@ -81,6 +96,26 @@ int    ca_mesh_size;
 double *rs_mesh = NULL;
 /** k space mesh (local) for k space calculation and FFT.*/
 double *ks_mesh = NULL;
+/** real space meshes (local) for the second and third force
+    component, which are back transformed together with \ref rs_mesh. */
+static double *rs_force_mesh[2] = { NULL, NULL };
+
+/** copy of the forward transformed charge mesh of the last plain
+    \ref P3M_charge_assign, reused by energy and pressure calculations
+    at the same particle configuration, see \ref P3M_charge_assign_cached. */
+static double *ks_cache_mesh = NULL;
+/** whether \ref ks_cache_mesh is valid for the current configuration. */
+static int ks_cache_valid = 0;
+/** set by \ref P3M_charge_assign, i. e. \ref rs_mesh holds the
+    plain charges and its transform may be cached. */
+static int rs_mesh_cacheable = 0;
+/** set by \ref P3M_charge_assign_cached, i. e. the next k-space
+    calculation takes the transformed mesh from \ref ks_cache_mesh. */
+static int rs_mesh_from_cache = 0;
+
+/** name of the tuning cache file given to the currently running tuning
+    command, or NULL if no cache is used. */
+static char *p3m_tune_cache_file = NULL;
 
 
 /** Field to store grid points to send. */
@@ -179,7 +214,9 @@ void calc_differential_operator(void);
 void calc_influence_function_force(void);
 
 /** Calculates the influence function optimized for the energy and the
-    self energy correction.  */
+    self energy correction. Since only half of the spectrum is stored
+    (see \ref fft_ks_half_dim), the values for modes with a distinct
+    hermitian partner are counted twice.  */
 void calc_influence_function_energy(void);
 
 
@@ -353,8 +390,13 @@ int p3m_set_ninterpol(int n)
 
 int inter_parse_p3m_tune_params(Tcl_Interp * interp, int argc, char ** argv, int adaptive)
 {
-  int mesh = -1, cao = -1, n_interpol = -1;
+  int mesh = -1, cao = -1, n_interpol = -1, ret;
   double r_cut = -1, accuracy = -1;
+  char *cache = NULL;
+  /* joint tuning only */
+  int steps = P3M_JOINT_TUNE_STEPS, n_skins = 0, i;
+  char **skin_list = NULL;
+  double *skins;
 
   while(argc > 0) {
     if(ARG0_IS_S("r_cut")) {
@@ -391,6 +433,32 @@ int inter_parse_p3m_tune_params(Tcl_Interp * interp, int argc, char ** argv, int
 			 (char *) NULL);
 	return TCL_ERROR;
       }
+
+    } else if (ARG0_IS_S("cache")) {
+      if (argc < 2) {
+	Tcl_AppendResult(interp, "cache expects a file name",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+      cache = argv[1];
+
+    } else if (adaptive == 2 && ARG0_IS_S("steps")) {
+      if (! (argc > 1 && ARG1_IS_I(steps) && steps > 0)) {
+	Tcl_AppendResult(interp, "steps expects a positive integer",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
+
+    } else if (adaptive == 2 && ARG0_IS_S("skin")) {
+      if (skin_list) Tcl_Free((char *)skin_list);
+      skin_list = NULL;
+      if (! (argc > 1 && Tcl_SplitList(interp, argv[1], &n_skins, &skin_list) == TCL_OK &&
+	     n_skins > 0)) {
+	Tcl_ResetResult(interp);
+	Tcl_AppendResult(interp, "skin expects a list of skins",
+			 (char *) NULL);
+	return TCL_ERROR;
+      }
     }
     /* unknown parameter. Probably one of the optionals */
     else break;
@@ -406,16 +474,38 @@ int inter_parse_p3m_tune_params(Tcl_Interp * interp, int argc, char ** argv, int
       return TCL_ERROR;
   }
 
-  if (adaptive) {
-    if(P3M_adaptive_tune_parameters(interp) == TCL_ERROR) 
-      return TCL_ERROR;
-  }
-  else {
-    if(P3M_tune_parameters(interp) == TCL_ERROR) 
-      return TCL_ERROR;
+  p3m_tune_cache_file = cache;
+  if (adaptive == 2) {
+    /* candidate skins, by default around the current one */
+    if (skin_list) {
+      skins = malloc(n_skins*sizeof(double));
+      for (i = 0; i < n_skins; i++)
+	if (Tcl_GetDouble(interp, skin_list[i], &skins[i]) == TCL_ERROR || skins[i] < 0) {
+	  Tcl_ResetResult(interp);
+	  Tcl_AppendResult(interp, "skin expects a list of nonnegative doubles", (char *) NULL);
+	  free(skins);
+	  Tcl_Free((char *)skin_list);
+	  p3m_tune_cache_file = NULL;
+	  return TCL_ERROR;
+	}
+      Tcl_Free((char *)skin_list);
+    }
+    else {
+      n_skins = 4;
+      skins = malloc(n_skins*sizeof(double));
+      for (i = 0; i < n_skins; i++)
+	skins[i] = 0.5*(i+1)*skin;
+    }
+    ret = P3M_joint_tune_parameters(interp, n_skins, skins, steps);
+    free(skins);
   }
+  else if (adaptive)
+    ret = P3M_adaptive_tune_parameters(interp);
+  else
+    ret = P3M_tune_parameters(interp);
+  p3m_tune_cache_file = NULL;
 
-  return TCL_OK;
+  return ret;
 }
 
 
@@ -441,7 +531,7 @@ int inter_parse_p3m(Tcl_Interp * interp, int argc, char ** argv)
 #endif
 
   if (argc < 1) {
-    Tcl_AppendResult(interp, "expected: inter coulomb <bjerrum> p3m tune | <r_cut> <mesh> <cao> [<alpha> [<accuracy>]]",
+    Tcl_AppendResult(interp, "expected: inter coulomb <bjerrum> p3m tune | tunev2 | tunejoint | <r_cut> <mesh> <cao> [<alpha> [<accuracy>]]",
 		     (char *) NULL);
     return TCL_ERROR;  
   }
@@ -456,6 +546,9 @@ int inter_parse_p3m(Tcl_Interp * interp, int argc, char ** argv)
 
   if (ARG0_IS_S("tunev2"))
     return inter_parse_p3m_tune_params(interp, argc-1, argv+1, 1);
+
+  if (ARG0_IS_S("tunejoint"))
+    return inter_parse_p3m_tune_params(interp, argc-1, argv+1, 2);
       
   if(! ARG0_IS_D(r_cut))
     return TCL_ERROR;  
@@ -644,6 +737,29 @@ void interpolate_charge_assignment_function()
   
 }
 
+#ifdef _OPENMP
+/** determine the index of the first charge of each local cell in the
+    charge assignment fields, so that the cells can be handled by
+    several threads.
+    \return the number of charged particles on this node. */
+static int count_cell_charges()
+{
+  Particle *p;
+  int i,c,np,cp_cnt=0;
+
+  cell_charge_start = (int *)realloc(cell_charge_start, (local_cells.n+1)*sizeof(int));
+  for (c = 0; c < local_cells.n; c++) {
+    cell_charge_start[c] = cp_cnt;
+    p  = local_cells.cell[c]->part;
+    np = local_cells.cell[c]->n;
+    for(i = 0; i < np; i++)
+      if( p[i].p.q != 0.0 ) cp_cnt++;
+  }
+  cell_charge_start[local_cells.n] = cp_cnt;
+  return cp_cnt;
+}
+#endif
+
 /* assign the charges */
 void P3M_charge_assign()
 {
@@ -652,6 +768,46 @@ void P3M_charge_assign()
   int i,c,np;
   /* charged particle counter, charge fraction counter */
   int cp_cnt=0;
+#ifdef _OPENMP
+  int n_threads = omp_get_max_threads();
+
+  cp_cnt = count_cell_charges();
+  if (cp_cnt > ca_num) realloc_ca_fields(cp_cnt);
+  if ((n_threads - 1)*lm.size > thread_rs_mesh_size) {
+    thread_rs_mesh_size = (n_threads - 1)*lm.size;
+    thread_rs_mesh = (double *)realloc(thread_rs_mesh, thread_rs_mesh_size*sizeof(double));
+  }
+
+  /* every thread spreads into its own mesh, which are summed up
+     afterwards, so that no two threads write to the same mesh point */
+#pragma omp parallel private(i,c,np,cell,p) num_threads(n_threads)
+  {
+    int t, cp, n_used = omp_get_num_threads();
+    double *mesh = (omp_get_thread_num() == 0) ? rs_mesh :
+      thread_rs_mesh + (omp_get_thread_num()-1)*lm.size;
+
+    for(i=0; i<lm.size; i++) mesh[i] = 0.0;
+
+#pragma omp for schedule(dynamic,8)
+    for (c = 0; c < local_cells.n; c++) {
+      cell = local_cells.cell[c];
+      p  = cell->part;
+      np = cell->n;
+      cp = cell_charge_start[c];
+      for(i = 0; i < np; i++) {
+	if( p[i].p.q != 0.0 ) {
+	  P3M_assign_charge_to_mesh(p[i].p.q, p[i].r.p, cp, mesh);
+	  cp++;
+	}
+      }
+    }
+
+#pragma omp for schedule(static)
+    for(i=0; i<lm.size; i++)
+      for(t=1; t<n_used; t++)
+	rs_mesh[i] += thread_rs_mesh[(t-1)*lm.size + i];
+  }
+#else
   /* prepare local FFT mesh */
   for(i=0; i<lm.size; i++) rs_mesh[i] = 0.0;
 
@@ -667,45 +823,77 @@ void P3M_charge_assign()
       }
     }
   }
+#endif
   P3M_shrink_wrap_charge_grid(cp_cnt);
-  
+  rs_mesh_cacheable = 1;
 }
 
-/* assign the forces obtained from k-space */
-static void P3M_assign_forces(double force_prefac, int d_rs)
+void P3M_charge_assign_cached()
+{
+  if (ks_cache_valid)
+    rs_mesh_from_cache = 1;
+  else
+    P3M_charge_assign();
+}
+
+/* assign the forces obtained from k-space. The force component d_rs
+   of the mesh mesh[d] is (d+ks_pnum)%3. All three components are
+   interpolated in one pass from the stored one dimensional weights. */
+static void P3M_assign_forces(double force_prefac, double **mesh)
 {
   Cell *cell;
   Particle *p;
-  int i,c,np,i0,i1,i2;
-  double q;
-  /* charged particle counter, charge fraction counter */
-  int cp_cnt=0, cf_cnt=0;
-  /* index, index jumps for rs_mesh array */
+  int i,c,np,i0,i1,i2,d_rs[3];
+  double frac, tmp1, f[3];
+  double *w, *w2, *m0, *m1, *m2;
+  /* charged particle counter */
+  int cp_cnt=0;
+  /* index, index jump for rs_mesh array */
   int q_ind;
-  int q_m_off = (lm.dim[2] - p3m.cao);
-  int q_s_off = lm.dim[2] * (lm.dim[1] - p3m.cao);
+  int q_off = lm.dim[2] * (lm.dim[1] - p3m.cao);
 
-  cp_cnt=0; cf_cnt=0;
+  for(i=0; i<3; i++) d_rs[i] = (i+ks_pnum)%3;
+
+#ifdef _OPENMP
+  /* the cells are independent, only their first charge index is needed */
+  count_cell_charges();
+#pragma omp parallel for schedule(dynamic,8) private(cell,p,np,i,i0,i1,i2,frac,tmp1,f,w,w2,m0,m1,m2,cp_cnt,q_ind)
+#endif
   for (c = 0; c < local_cells.n; c++) {
     cell = local_cells.cell[c];
     p  = cell->part;
     np = cell->n;
+#ifdef _OPENMP
+    cp_cnt = cell_charge_start[c];
+#endif
     for(i=0; i<np; i++) { 
-      if( (q=p[i].p.q) != 0.0 ) {
+      if( p[i].p.q != 0.0 ) {
 	q_ind = ca_fmp[cp_cnt];
+	w  = ca_frac + 3*p3m.cao*cp_cnt;
+	w2 = w + 2*p3m.cao;
+	f[0] = f[1] = f[2] = 0.0;
 	for(i0=0; i0<p3m.cao; i0++) {
 	  for(i1=0; i1<p3m.cao; i1++) {
+	    tmp1 = w[i0] * w[p3m.cao + i1];
+	    m0 = mesh[0] + q_ind;
+	    m1 = mesh[1] + q_ind;
+	    m2 = mesh[2] + q_ind;
 	    for(i2=0; i2<p3m.cao; i2++) {
-	      p[i].f.f[d_rs] -= force_prefac*ca_frac[cf_cnt]*rs_mesh[q_ind++]; 
-	      cf_cnt++;
+	      frac = tmp1 * w2[i2];
+	      f[0] += frac*m0[i2];
+	      f[1] += frac*m1[i2];
+	      f[2] += frac*m2[i2];
 	    }
-	    q_ind += q_m_off;
+	    q_ind += lm.dim[2];
 	  }
-	  q_ind += q_s_off;
+	  q_ind += q_off;
 	}
+	p[i].f.f[d_rs[0]] -= force_prefac*f[0];
+	p[i].f.f[d_rs[1]] -= force_prefac*f[1];
+	p[i].f.f[d_rs[2]] -= force_prefac*f[2];
 	cp_cnt++;
 
-	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  f = (%.3e,%.3e,%.3e) in dir %d add %.5f\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2],d_rs,-db_fsum));
+	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  f = (%.3e,%.3e,%.3e)\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2]));
       }
     }
   }
@@ -720,7 +908,11 @@ static void P3M_assign_forces(double force_prefac, int d_rs)
 
 double P3M_calc_kspace_forces_for_charges(int force_flag, int energy_flag) 
 {
-  int i,d,d_rs,ind,j[3];
+  int i,d,ind,j[3];
+  /* differential operator of a k-space mesh point */
+  double k[3];
+  /* meshes for the three force components */
+  double *force_mesh[3];
   /**************************************************************/
   /* Prefactor for force */
   double force_prefac;
@@ -734,9 +926,19 @@ double P3M_calc_kspace_forces_for_charges(int force_flag, int energy_flag)
   /* Gather information for FFT grid inside the nodes domain (inner local mesh) */
   /* and Perform forward 3D FFT (Charge Assignment Mesh). */
   if (p3m_sum_q2 > 0) {
-    gather_fft_grid(rs_mesh);
-    fft_perform_forw(rs_mesh);
+    if (rs_mesh_from_cache)
+      memcpy(rs_mesh, ks_cache_mesh, 2*fft_plan[3].new_size*sizeof(double));
+    else {
+      gather_fft_grid(rs_mesh);
+      fft_perform_forw(rs_mesh);
+      if (rs_mesh_cacheable) {
+	memcpy(ks_cache_mesh, rs_mesh, 2*fft_plan[3].new_size*sizeof(double));
+	ks_cache_valid = 1;
+      }
     }
+  }
+  rs_mesh_cacheable  = 0;
+  rs_mesh_from_cache = 0;
 //Note: after these calls, the grids are in the order yzx and not xyz anymore!!!
 
   /* === K Space Calculations === */
@@ -748,11 +950,12 @@ double P3M_calc_kspace_forces_for_charges(int force_flag, int energy_flag)
    Coulomb energy
 **********************/
    if (p3m_sum_q2 > 0) {
-    ind = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:node_k_space_energy)
+#endif
     for(i=0; i<fft_plan[3].new_size; i++) {
       // Use the energy optimized influence function for energy!
-      node_k_space_energy += g_energy[i] * ( SQR(rs_mesh[ind]) + SQR(rs_mesh[ind+1]) );
-      ind += 2;
+      node_k_space_energy += g_energy[i] * ( SQR(rs_mesh[2*i]) + SQR(rs_mesh[2*i+1]) );
     }
     node_k_space_energy *= force_prefac * box_l[0] / (4.0*PI) ;
  
@@ -775,38 +978,49 @@ double P3M_calc_kspace_forces_for_charges(int force_flag, int energy_flag)
 ****************************/ 
     if (p3m_sum_q2 > 0) {
     /* Force preparation */
-    ind = 0;
 
     /* apply the influence function */
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
     for(i=0; i<fft_plan[3].new_size; i++) {
-      ks_mesh[ind] = g_force[i] * rs_mesh[ind]; ind++;
-      ks_mesh[ind] = g_force[i] * rs_mesh[ind]; ind++;
+      ks_mesh[2*i]   = g_force[i] * rs_mesh[2*i];
+      ks_mesh[2*i+1] = g_force[i] * rs_mesh[2*i+1];
     }
     
     /* === 3 Fold backward 3D FFT (Force Component Meshs) === */
+    force_mesh[0] = rs_mesh;
+    force_mesh[1] = rs_force_mesh[0];
+    force_mesh[2] = rs_force_mesh[1];
     
-    /* Force component loop */
-    for(d=0;d<3;d++) {  
-      /* direction in k space: */
-      d_rs = (d+ks_pnum)%3;
-      /* srqt(-1)*k differentiation */
-      ind=0;
-      for(j[0]=0; j[0]<fft_plan[3].new_mesh[0]; j[0]++) {
-	for(j[1]=0; j[1]<fft_plan[3].new_mesh[1]; j[1]++) {
-	  for(j[2]=0; j[2]<fft_plan[3].new_mesh[2]; j[2]++) {
-	    /* i*k*(Re+i*Im) = - Im*k + i*Re*k     (i=sqrt(-1)) */ 
-	    rs_mesh[ind] = -(ks_mesh[ind+1]*d_op[ j[d]+fft_plan[3].start[d] ]); ind++;
-	    rs_mesh[ind] =   ks_mesh[ind-1]*d_op[ j[d]+fft_plan[3].start[d] ];  ind++;
+    /* srqt(-1)*k differentiation, all force components in one sweep */
+#ifdef _OPENMP
+#pragma omp parallel for private(j,d,ind,k)
+#endif
+    for(i=0; i<fft_plan[3].new_mesh[0]; i++) {
+      j[0] = i;
+      k[0] = d_op[ j[0]+fft_plan[3].start[0] ];
+      ind  = 2*i*fft_plan[3].new_mesh[1]*fft_plan[3].new_mesh[2];
+      for(j[1]=0; j[1]<fft_plan[3].new_mesh[1]; j[1]++) {
+	k[1] = d_op[ j[1]+fft_plan[3].start[1] ];
+	for(j[2]=0; j[2]<fft_plan[3].new_mesh[2]; j[2]++) {
+	  k[2] = d_op[ j[2]+fft_plan[3].start[2] ];
+	  /* i*k*(Re+i*Im) = - Im*k + i*Re*k     (i=sqrt(-1)) */ 
+	  for(d=0;d<3;d++) {
+	    force_mesh[d][ind]   = -(ks_mesh[ind+1]*k[d]);
+	    force_mesh[d][ind+1] =   ks_mesh[ind]*k[d];
 	  }
+	  ind += 2;
 	}
       }
-      /* Back FFT force component mesh */
-      fft_perform_back(rs_mesh);
-      /* redistribute force component mesh */
-      spread_force_grid(rs_mesh);
-      /* Assign force component from mesh to particle */
-      P3M_assign_forces(force_prefac, d_rs);
     }
+    /* Back FFT all force component meshes together */
+    fft_perform_back_batch(force_mesh, 3);
+    /* redistribute force component meshes */
+    for(d=0;d<3;d++)
+      spread_force_grid(force_mesh[d]);
+    /* Assign force components from the meshes to the particles */
+    P3M_assign_forces(force_prefac, force_mesh);
    }  // if(p3m_sum_q2>0)
 
   } // if(force_flag)
@@ -959,7 +1173,7 @@ void realloc_ca_fields(int newsize)
 
   P3M_TRACE(fprintf(stderr,"%d: realloc_ca_fields: old_size=%d -> new_size=%d\n",this_node,ca_num,newsize));
   ca_num = newsize;
-  ca_frac = (double *)realloc(ca_frac, p3m.cao3*ca_num*sizeof(double));
+  ca_frac = (double *)realloc(ca_frac, 3*p3m.cao*ca_num*sizeof(double));
   ca_fmp  = (int *)realloc(ca_fmp, ca_num*sizeof(int));
     
 }
@@ -1099,6 +1313,9 @@ void calc_influence_function_energy()
 	  g_energy[ind] = 0.0;
 	else {
 	  g_energy[ind] = fak1*perform_aliasing_sums_energy(n);
+	  /* account for the mode -n, which is not stored */
+	  if( n[fft_ks_half_dim] != 0 && 2*n[fft_ks_half_dim] != p3m.mesh[0] )
+	    g_energy[ind] *= 2.0;
 	}
       }
 }
@@ -1143,6 +1360,125 @@ MDINLINE double perform_aliasing_sums_energy(int n[3])
 
 #define P3M_TUNE_MAX_CUTS 50
 
+/** number of integer entries at the beginning of a tuning signature,
+    which have to match exactly. These are the coulomb method, the node
+    grid and the fixed mesh and cao (0 if free). */
+#define P3M_TUNE_SIG_INTS 6
+/** total length of a tuning signature. The remaining entries are the
+    box, the number of charges, Sum[q_i^2], the accuracy goal, the skin,
+    the coulomb prefactor and the fixed r_cut_iL, which have to agree
+    within \ref P3M_TUNE_CACHE_TOL. */
+#define P3M_TUNE_SIG_LEN 15
+
+/** collect the quantities that determine the outcome of the tuning. Has
+    to be called before the tuning changes the p3m parameters. */
+static void p3m_tune_signature(double sig[P3M_TUNE_SIG_LEN])
+{
+  int i;
+  sig[0] = coulomb.method;
+  for(i=0;i<3;i++) sig[1+i] = node_grid[i];
+  sig[4] = p3m.mesh[0];
+  sig[5] = p3m.cao;
+  for(i=0;i<3;i++) sig[6+i] = box_l[i];
+  sig[9]  = p3m_sum_qpart;
+  sig[10] = p3m_sum_q2;
+  sig[11] = p3m.accuracy;
+  sig[12] = skin;
+  sig[13] = coulomb.prefactor;
+  sig[14] = p3m.r_cut_iL;
+}
+
+/** check whether two tuning signatures describe the same system. */
+static int p3m_tune_signature_match(double *a, double *b)
+{
+  int i;
+  for(i=0;i<P3M_TUNE_SIG_INTS;i++)
+    if((int)a[i] != (int)b[i]) return 0;
+  for(;i<P3M_TUNE_SIG_LEN;i++)
+    if(fabs(a[i]-b[i]) > P3M_TUNE_CACHE_TOL*dmax(fabs(a[i]),fabs(b[i]))) return 0;
+  return 1;
+}
+
+/** read one entry of the tuning cache. An entry is a line containing the
+    signature, followed by mesh, cao, r_cut_iL and alpha_L.
+    Returns 1 on success, 0 at the end of the file. */
+static int p3m_tune_cache_read(FILE *f, double sig[P3M_TUNE_SIG_LEN], int *mesh,
+			       int *cao, double *r_cut_iL, double *alpha_L)
+{
+  int i;
+  for(i=0;i<P3M_TUNE_SIG_LEN;i++)
+    if(fscanf(f, "%lf", &sig[i]) != 1) return 0;
+  return fscanf(f, "%d %d %lf %lf", mesh, cao, r_cut_iL, alpha_L) == 4;
+}
+
+/** write one entry of the tuning cache, see \ref p3m_tune_cache_read. */
+static void p3m_tune_cache_write(FILE *f, double sig[P3M_TUNE_SIG_LEN], int mesh,
+				 int cao, double r_cut_iL, double alpha_L)
+{
+  int i;
+  for(i=0;i<P3M_TUNE_SIG_LEN;i++)
+    fprintf(f, "%.15g ", sig[i]);
+  fprintf(f, "%d %d %.15g %.15g\n", mesh, cao, r_cut_iL, alpha_L);
+}
+
+/** look up the parameters tuned last for a matching signature in the
+    tuning cache. Returns 1 if there is such an entry. */
+static int p3m_tune_cache_lookup(Tcl_Interp *interp, double sig[P3M_TUNE_SIG_LEN],
+				 int *mesh, int *cao, double *r_cut_iL)
+{
+  FILE *f;
+  double e_sig[P3M_TUNE_SIG_LEN], e_r_cut_iL, e_alpha_L;
+  int e_mesh, e_cao, found = 0;
+  char b1[TCL_INTEGER_SPACE + 2], b2[TCL_INTEGER_SPACE + 2], b3[TCL_DOUBLE_SPACE + 2];
+
+  if(!p3m_tune_cache_file || (f = fopen(p3m_tune_cache_file, "r")) == NULL)
+    return 0;
+  while(p3m_tune_cache_read(f, e_sig, &e_mesh, &e_cao, &e_r_cut_iL, &e_alpha_L))
+    if(p3m_tune_signature_match(sig, e_sig)) {
+      *mesh = e_mesh; *cao = e_cao; *r_cut_iL = e_r_cut_iL;
+      found = 1;
+    }
+  fclose(f);
+
+  if(found) {
+    sprintf(b1,"%d",*mesh); sprintf(b2,"%d",*cao); sprintf(b3,"%.5e",*r_cut_iL);
+    Tcl_AppendResult(interp, "refining cached parameters: mesh ", b1, " cao ", b2,
+		     " r_cut_iL ", b3, "\n", (char *) NULL);
+  }
+  return found;
+}
+
+/** store the tuned parameters for a signature in the tuning cache,
+    replacing older entries with a matching signature. */
+static void p3m_tune_cache_store(double sig[P3M_TUNE_SIG_LEN], int mesh, int cao,
+				 double r_cut_iL, double alpha_L)
+{
+  FILE *f, *tmp;
+  double e_sig[P3M_TUNE_SIG_LEN], e_r_cut_iL, e_alpha_L;
+  int e_mesh, e_cao;
+  char *tmp_name;
+
+  if(!p3m_tune_cache_file)
+    return;
+  tmp_name = malloc(strlen(p3m_tune_cache_file) + 5);
+  sprintf(tmp_name, "%s.tmp", p3m_tune_cache_file);
+  if((tmp = fopen(tmp_name, "w")) == NULL) {
+    fprintf(stderr, "%d: could not write P3M tuning cache %s\n", this_node, tmp_name);
+    free(tmp_name);
+    return;
+  }
+  if((f = fopen(p3m_tune_cache_file, "r")) != NULL) {
+    while(p3m_tune_cache_read(f, e_sig, &e_mesh, &e_cao, &e_r_cut_iL, &e_alpha_L))
+      if(!p3m_tune_signature_match(sig, e_sig))
+	p3m_tune_cache_write(tmp, e_sig, e_mesh, e_cao, e_r_cut_iL, e_alpha_L);
+    fclose(f);
+  }
+  p3m_tune_cache_write(tmp, sig, mesh, cao, r_cut_iL, alpha_L);
+  fclose(tmp);
+  rename(tmp_name, p3m_tune_cache_file);
+  free(tmp_name);
+}
+
 int P3M_tune_parameters(Tcl_Interp *interp)
 {
   int i,ind, try=0, best_try=0, n_cuts;
@@ -1153,12 +1489,17 @@ int P3M_tune_parameters(Tcl_Interp *interp)
   double mesh_size, k_cut;
   double rs_err, rs_err_best=0, ks_err, ks_err_best=0;
   double int_time=0, min_time=1e20, int_num;
+  /* tuning cache */
+  double sig[P3M_TUNE_SIG_LEN], c_r_cut_iL;
+  int    c_mesh, c_cao, cached;
   char b1[TCL_DOUBLE_SPACE + 12],b2[TCL_DOUBLE_SPACE + 12],b3[TCL_DOUBLE_SPACE + 12];
  
   P3M_TRACE(fprintf(stderr,"%d: P3M_tune_parameters\n",this_node));
   
   /* preparation */
   mpi_bcast_event(P3M_COUNT_CHARGES);
+  p3m_tune_signature(sig);
+  cached = p3m_tune_cache_lookup(interp, sig, &c_mesh, &c_cao, &c_r_cut_iL);
 
   /* calculate r_cut_iL tune range */
   if(p3m.r_cut_iL == 0.0) { 
@@ -1195,6 +1536,17 @@ int P3M_tune_parameters(Tcl_Interp *interp)
   /* calculate cao tune range */
   if(p3m.cao == 0) { cao_min = 1; cao_max = 7; }
   else             { cao_min = cao_max = p3m.cao; }
+  /* only scan the neighborhood of cached parameters */
+  if(cached) {
+    if(p3m.mesh[0] == 0) {
+      mesh_min = (c_mesh/2 >= 8) ? c_mesh/2 : c_mesh;
+      mesh_max = 2*c_mesh;
+    }
+    if(p3m.cao == 0) {
+      cao_min = imax(1, c_cao-1);
+      cao_max = imin(7, c_cao+1);
+    }
+  }
 
   /* Print Status */
   sprintf(b1,"%.5e",p3m.accuracy);
@@ -1303,6 +1655,7 @@ int P3M_tune_parameters(Tcl_Interp *interp)
   P3M_scaleby_box_l_charges();
   /* broadcast tuned p3m parameters */
   mpi_bcast_coulomb_params();
+  p3m_tune_cache_store(sig, mesh_best, cao_best, r_cut_iL_best, alpha_L_best);
   /* Tell the user about the outcome */
   sprintf(b1,"%d",try);
   Tcl_AppendResult(interp, "\nTune results of ",b1," trials:\n", (char *) NULL);
@@ -1615,6 +1968,9 @@ int P3M_adaptive_tune_parameters(Tcl_Interp *interp)
   double                             alpha_L  = -1, tmp_alpha_L=0.0;
   double                             accuracy = -1, tmp_accuracy=0.0;
   double                            time_best=1e20, tmp_time;
+  /* tuning cache */
+  double sig[P3M_TUNE_SIG_LEN], c_r_cut_iL;
+  int    c_mesh, c_cao, cached;
   char
     b1[TCL_INTEGER_SPACE + TCL_DOUBLE_SPACE + 12],
     b2[TCL_INTEGER_SPACE + TCL_DOUBLE_SPACE + 12],
@@ -1629,6 +1985,7 @@ int P3M_adaptive_tune_parameters(Tcl_Interp *interp)
 
   /* preparation */
   mpi_bcast_event(P3M_COUNT_CHARGES);
+  p3m_tune_signature(sig);
 
   /* Print Status */
   sprintf(b1,"%.5e",p3m.accuracy);
@@ -1689,6 +2046,18 @@ int P3M_adaptive_tune_parameters(Tcl_Interp *interp)
     cao_min = cao_max = cao = p3m.cao;
   }
 
+  /* start from the cached parameters, one mesh below to be able to
+     improve in both directions */
+  cached = p3m_tune_cache_lookup(interp, sig, &c_mesh, &c_cao, &c_r_cut_iL);
+  if(cached) {
+    if(p3m.mesh[0] == 0) {
+      tmp_mesh = (c_mesh > 1) ? c_mesh/2 : c_mesh;
+      mesh_max = imin(mesh_max, 2*c_mesh);
+    }
+    if(p3m.cao == 0)
+      cao = c_cao;
+  }
+
   Tcl_AppendResult(interp, "mesh cao r_cut_iL     alpha_L      err          rs_err     ks_err     time [ms]\n", (char *) NULL);
 
   /* mesh loop */
@@ -1736,6 +2105,7 @@ int P3M_adaptive_tune_parameters(Tcl_Interp *interp)
   P3M_scaleby_box_l_charges();
   /* broadcast tuned p3m parameters */
   mpi_bcast_coulomb_params();
+  p3m_tune_cache_store(sig, mesh, cao, r_cut_iL, alpha_L);
   /* Tell the user about the outcome */
   Tcl_AppendResult(interp, "\nresulting parameters:\n", (char *) NULL);
   sprintf(b2,"%-4d",mesh); sprintf(b3,"%-3d",cao);
@@ -1747,6 +2117,159 @@ int P3M_adaptive_tune_parameters(Tcl_Interp *interp)
   return (TCL_OK);
 }
 
+/** set the node grid and skin for the joint tuning. P3M is switched
+    off while the cell system is rebuilt, since the nodes do not agree
+    on the P3M parameters during the tuning and the parameters of the
+    user may not be complete. The method is switched back on on the
+    master only; the next \ref mpi_bcast_coulomb_params does so on all
+    nodes. */
+static void p3m_joint_tune_set_grid_skin(int grid[3], double new_skin)
+{
+  int method = coulomb.method;
+
+  coulomb.method = COULOMB_NONE;
+  mpi_bcast_coulomb_params();
+  node_grid[0] = grid[0]; node_grid[1] = grid[1]; node_grid[2] = grid[2];
+  mpi_bcast_parameter(FIELD_NODEGRID);
+  skin = new_skin;
+  mpi_bcast_parameter(FIELD_SKIN);
+  coulomb.method = method;
+}
+
+/** restore the node grid, skin and P3M parameters found on entry of the
+    joint tuning, if it fails. */
+static void p3m_joint_tune_restore(int grid_in[3], double skin_in, p3m_struct *p3m_in)
+{
+  p3m_joint_tune_set_grid_skin(grid_in, skin_in);
+  p3m = *p3m_in;
+  mpi_bcast_coulomb_params();
+}
+
+int P3M_joint_tune_parameters(Tcl_Interp *interp, int n_skins, double *skins, int steps)
+{
+  /* the setting on entry, including the free or fixed P3M parameters
+     given by the user, which the P3M tuner overwrites */
+  int    grid_in[3]  = { node_grid[0], node_grid[1], node_grid[2] };
+  double skin_in     = skin;
+  p3m_struct p3m_in  = p3m;
+  /* best setting so far */
+  int    grid_best[3], mesh_best = 0, cao_best = 0;
+  double skin_best = 0, r_cut_iL_best = 0, alpha_L_best = 0, accuracy_best = 0;
+  double time_best = 1e20, step_time;
+  int grid[3], s, try = 0;
+  Tcl_DString log;
+  char
+    b1[3*TCL_INTEGER_SPACE + 12],
+    b2[TCL_INTEGER_SPACE + TCL_DOUBLE_SPACE + 12],
+    b3[TCL_INTEGER_SPACE + TCL_DOUBLE_SPACE + 12];
+
+  P3M_TRACE(fprintf(stderr,"%d: P3M_joint_tune_parameters\n",this_node));
+
+  if (skin == -1) {
+    Tcl_AppendResult(interp, "p3m cannot be tuned, since the skin is not yet set", (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  Tcl_DStringInit(&log);
+  sprintf(b1,"%.5e",p3m.accuracy);
+  Tcl_DStringAppend(&log, "P3M joint tuning: Accuracy goal = ", -1);
+  Tcl_DStringAppend(&log, b1, -1);
+  Tcl_DStringAppend(&log, "\nnode_grid  skin         mesh cao r_cut_iL     alpha_L      err          time/step [ms]\n", -1);
+
+  /* all node grids suitable for P3M, i.e. sorted largest first */
+  for (grid[0] = n_nodes; grid[0] >= 1; grid[0]--) {
+    if (n_nodes % grid[0]) continue;
+    for (grid[1] = grid[0]; grid[1] >= 1; grid[1]--) {
+      if ((n_nodes/grid[0]) % grid[1]) continue;
+      grid[2] = n_nodes/grid[0]/grid[1];
+      if (grid[2] > grid[1]) continue;
+
+      for (s = 0; s < n_skins; s++) {
+	p3m_joint_tune_set_grid_skin(grid, skins[s]);
+	p3m = p3m_in;
+
+	sprintf(b1,"%d %d %d",grid[0],grid[1],grid[2]);
+	sprintf(b2,"%.5e",skin);
+	Tcl_DStringAppend(&log, b1, -1);
+	Tcl_DStringAppend(&log, "      ", -1);
+	Tcl_DStringAppend(&log, b2, -1);
+	Tcl_DStringAppend(&log, "  ", -1);
+
+	/* the P3M parameters optimal for this node grid and skin. The
+	   log of the P3M tuning is not kept. */
+	if (P3M_adaptive_tune_parameters(interp) == TCL_ERROR) {
+	  Tcl_ResetResult(interp);
+	  Tcl_DStringAppend(&log, "accuracy not achieved\n", -1);
+	  continue;
+	}
+	Tcl_ResetResult(interp);
+
+	/* the time of real integration steps, including the Verlet list
+	   updates and the communication */
+	step_time = time_integration(steps);
+	if (step_time == -1) {
+	  Tcl_DStringFree(&log);
+	  p3m_joint_tune_restore(grid_in, skin_in, &p3m_in);
+	  Tcl_AppendResult(interp, "tuning failed, test integration not possible", (char *)NULL);
+	  return TCL_ERROR;
+	}
+	try++;
+
+	sprintf(b2,"%-4d",p3m.mesh[0]); sprintf(b3,"%-3d",p3m.cao);
+	Tcl_DStringAppend(&log, b2, -1); Tcl_DStringAppend(&log, " ", -1);
+	Tcl_DStringAppend(&log, b3, -1); Tcl_DStringAppend(&log, " ", -1);
+	sprintf(b1,"%.5e",p3m.r_cut_iL); sprintf(b2,"%.5e",p3m.alpha_L); sprintf(b3,"%.5e",p3m.accuracy);
+	Tcl_DStringAppend(&log, b1, -1); Tcl_DStringAppend(&log, "  ", -1);
+	Tcl_DStringAppend(&log, b2, -1); Tcl_DStringAppend(&log, "  ", -1);
+	Tcl_DStringAppend(&log, b3, -1); Tcl_DStringAppend(&log, "  ", -1);
+	sprintf(b1,"%.3f\n",step_time);
+	Tcl_DStringAppend(&log, b1, -1);
+
+	if (step_time < time_best) {
+	  time_best     = step_time;
+	  grid_best[0]  = grid[0]; grid_best[1] = grid[1]; grid_best[2] = grid[2];
+	  skin_best     = skin;
+	  mesh_best     = p3m.mesh[0];
+	  cao_best      = p3m.cao;
+	  r_cut_iL_best = p3m.r_cut_iL;
+	  alpha_L_best  = p3m.alpha_L;
+	  accuracy_best = p3m.accuracy;
+	}
+      }
+    }
+  }
+
+  Tcl_DStringResult(interp, &log);
+  if (try == 0) {
+    p3m_joint_tune_restore(grid_in, skin_in, &p3m_in);
+    Tcl_AppendResult(interp, "failed to tune P3M parameters to required accuracy", (char *) NULL);
+    return TCL_ERROR;
+  }
+
+  /* set the optimal setting */
+  p3m_joint_tune_set_grid_skin(grid_best, skin_best);
+  p3m.r_cut_iL = r_cut_iL_best;
+  p3m.mesh[0]  = p3m.mesh[1] = p3m.mesh[2] = mesh_best;
+  p3m.cao      = cao_best;
+  p3m.alpha_L  = alpha_L_best;
+  p3m.accuracy = accuracy_best;
+  P3M_scaleby_box_l_charges();
+  mpi_bcast_coulomb_params();
+
+  /* Tell the user about the outcome */
+  sprintf(b1,"%d %d %d",grid_best[0],grid_best[1],grid_best[2]);
+  sprintf(b2,"%g",skin_best);
+  Tcl_AppendResult(interp, "\nresulting parameters:\nsetmd node_grid ", b1, "; setmd skin ", b2, "\n", (char *) NULL);
+  sprintf(b1,"%g",coulomb.bjerrum); sprintf(b2,"%g",p3m.r_cut); sprintf(b3,"%d",mesh_best);
+  Tcl_AppendResult(interp, "inter coulomb ", b1, " p3m ", b2, " ", b3, (char *) NULL);
+  sprintf(b1,"%d",cao_best); sprintf(b2,"%g",p3m.alpha); sprintf(b3,"%g",accuracy_best);
+  Tcl_AppendResult(interp, " ", b1," ", b2," ", b3, (char *) NULL);
+  sprintf(b1,"%.3f",time_best);
+  Tcl_AppendResult(interp, "\ntime/step ", b1, " ms", (char *) NULL);
+
+  return TCL_OK;
+}
+
 void P3M_count_charged_particles()
 {  
   Cell *cell;
@@ -1772,6 +2295,7 @@ void P3M_count_charged_particles()
   MPI_Allreduce(node_sums, tot_sums, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
   p3m_sum_qpart    = (int)(tot_sums[0]+0.1);
   p3m_sum_q2       = tot_sums[1];
+  p3m_sum_q        = tot_sums[2];
   p3m_square_sum_q = SQR(tot_sums[2]);
 }
 
@@ -2080,6 +2604,111 @@ void P3M_scaleby_box_l_charges() {
    P3M_init_a_ai_cao_cut();
   calc_lm_ld_pos();
   P3M_sanity_checks_boxl(); 
+  P3M_invalidate_charge_cache();
+}
+
+void P3M_invalidate_charge_cache()
+{
+  ks_cache_valid = 0;
+}
+
+/** the one dimensional Fourier transforms of the charge assignment
+    weights of a unit charge at \a r. phase[d] holds the complex factors
+    for the local k-space block in k-space direction d, which
+    corresponds to the real space direction (d+ks_pnum)%3. The
+    transform of the assigned charge is the product of the three. */
+static void P3M_charge_phases(double *r, double **phase)
+{
+  int d, rd, i, m, nmp;
+  double pos, frac, arg, w[7];
+
+  for(d=0; d<3; d++) {
+    rd   = (d + ks_pnum)%3;
+    /* global mesh coordinate of the first assignment point */
+    pos  = r[rd]*p3m.ai[rd] - p3m.mesh_off[rd] - pos_shift;
+    nmp  = (int)floor(pos);
+    frac = pos - nmp;
+    for(i=0; i<p3m.cao; i++)
+      w[i] = (p3m.inter == 0) ? P3M_caf(i, frac - 0.5, p3m.cao) :
+	int_caf[i][(int)(frac*p3m.inter2)];
+
+    for(m=0; m<fft_plan[3].new_mesh[d]; m++) {
+      phase[d][2*m] = phase[d][2*m+1] = 0.0;
+      for(i=0; i<p3m.cao; i++) {
+	arg = -2.0*PI*(double)(m + fft_plan[3].start[d])*(nmp + i)/(double)p3m.mesh[rd];
+	phase[d][2*m]   += w[i]*cos(arg);
+	phase[d][2*m+1] += w[i]*sin(arg);
+      }
+    }
+  }
+}
+
+double P3M_energy_change(int n, ChargeChange *c)
+{
+  int i, j, m0, m1, m2, ind, sign;
+  int *nm = fft_plan[3].new_mesh;
+  double *phase[3], *drho, *rho;
+  double q, re, im, node_energy = 0.0, energy = 0.0;
+  double dq = 0.0, dq2 = 0.0;
+
+  P3M_TRACE(fprintf(stderr,"%d: P3M_energy_change, %d changes, cache valid %d\n",this_node,n,ks_cache_valid));
+
+  /* the transformed charge mesh of the current configuration */
+  if (!ks_cache_valid && p3m_sum_q2 > 0) {
+    P3M_charge_assign();
+    P3M_calc_kspace_forces_for_charges(0,0);
+  }
+  rho = (p3m_sum_q2 > 0) ? ks_cache_mesh : NULL;
+
+  /* transform of the charge difference on the local k-space block */
+  drho = (double *)calloc(2*fft_plan[3].new_size + 1, sizeof(double));
+  phase[0] = (double *)malloc(2*(nm[0] + nm[1] + nm[2])*sizeof(double));
+  phase[1] = phase[0] + 2*nm[0];
+  phase[2] = phase[1] + 2*nm[1];
+  for(j=0; j<2*n; j++) {
+    sign = j%2;
+    q = sign ? c[j/2].new_q : -c[j/2].old_q;
+    if (q == 0.0)
+      continue;
+    P3M_charge_phases(sign ? c[j/2].new_pos : c[j/2].old_pos, phase);
+    ind = 0;
+    for(m0=0; m0<nm[0]; m0++)
+      for(m1=0; m1<nm[1]; m1++) {
+	re = q*(phase[0][2*m0]*phase[1][2*m1] - phase[0][2*m0+1]*phase[1][2*m1+1]);
+	im = q*(phase[0][2*m0]*phase[1][2*m1+1] + phase[0][2*m0+1]*phase[1][2*m1]);
+	for(m2=0; m2<nm[2]; m2++, ind++) {
+	  drho[2*ind]   += re*phase[2][2*m2] - im*phase[2][2*m2+1];
+	  drho[2*ind+1] += re*phase[2][2*m2+1] + im*phase[2][2*m2];
+	}
+      }
+  }
+  free(phase[0]);
+
+  /* |rho + drho|^2 - |rho|^2 */
+  for(i=0; i<fft_plan[3].new_size; i++) {
+    re = drho[2*i]*drho[2*i] + drho[2*i+1]*drho[2*i+1];
+    if (rho)
+      re += 2.0*(rho[2*i]*drho[2*i] + rho[2*i+1]*drho[2*i+1]);
+    node_energy += g_energy[i]*re;
+  }
+  free(drho);
+  node_energy *= coulomb.prefactor/(double)(p3m.mesh[0]*p3m.mesh[1]*p3m.mesh[2])
+    * box_l[0] / (4.0*PI);
+
+  MPI_Reduce(&node_energy, &energy, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  if (this_node != 0)
+    return 0.0;
+
+  for(j=0; j<n; j++) {
+    dq  += c[j].new_q - c[j].old_q;
+    dq2 += SQR(c[j].new_q) - SQR(c[j].old_q);
+  }
+  /* self energy correction */
+  energy -= coulomb.prefactor*(dq2*p3m.alpha_L*box_l_i[0] * wupii);
+  /* net charge correction */
+  energy -= coulomb.prefactor*((SQR(p3m_sum_q + dq) - SQR(p3m_sum_q))*PI / (2.0*box_l[0]*SQR(p3m.alpha_L)));
+
+  return energy;
 }
 
 /************************************************/
@@ -2089,6 +2718,8 @@ void P3M_scaleby_box_l_charges() {
 void   P3M_init_charges() {
   int n;
 
+  P3M_invalidate_charge_cache();
+
   if(coulomb.bjerrum == 0.0) {       
     
       if(coulomb.bjerrum == 0.0) {
@@ -2147,6 +2778,9 @@ void   P3M_init_charges() {
  
     ca_mesh_size = fft_init(&rs_mesh,lm.dim,lm.margin,&ks_pnum);
     ks_mesh = (double *) realloc(ks_mesh, ca_mesh_size*sizeof(double));
+    rs_force_mesh[0] = (double *) realloc(rs_force_mesh[0], ca_mesh_size*sizeof(double));
+    rs_force_mesh[1] = (double *) realloc(rs_force_mesh[1], ca_mesh_size*sizeof(double));
+    ks_cache_mesh = (double *) realloc(ks_cache_mesh, ca_mesh_size*sizeof(double));
     
 
     P3M_TRACE(fprintf(stderr,"%d: rs_mesh ADR=%p\n",this_node,rs_mesh));
@@ -154,18 +154,66 @@ int P3M_tune_parameters(Tcl_Interp *interp);
  */
 int P3M_adaptive_tune_parameters(Tcl_Interp *interp);
 
+/** tune the P3M parameters together with the node grid and the skin.
+    For every node grid suitable for P3M and every candidate skin, the
+    optimal P3M parameters are determined by \ref P3M_adaptive_tune_parameters,
+    and then the time for real integration steps is measured by \ref
+    time_integration, which includes the Verlet list updates and the
+    FFT communication. The setting with the smallest time per step is used.
+    Since the cell size follows from the real space cutoff and the skin,
+    it is tuned along.
+    @param interp  Tcl interpreter for the tuning log.
+    @param n_skins number of candidate skins.
+    @param skins   the candidate skins.
+    @param steps   number of timed integration steps per setting.
+*/
+int P3M_joint_tune_parameters(Tcl_Interp *interp, int n_skins, double *skins, int steps);
+
 /** assign the physical charges using the tabulated charge assignment function.
     If store_ca_frac is true, then the charge fractions are buffered in cur_ca_fmp and
     cur_ca_frac. */
 void P3M_charge_assign();
 
+/** like \ref P3M_charge_assign, but only for a following energy or
+    pressure calculation. If the forward transformed charge mesh of
+    the current configuration is still known from a previous plain
+    charge assignment, e. g. from the last force calculation, the
+    assignment and the forward FFT are skipped. The charge fractions
+    are not updated, so this must not be used before a force
+    calculation. */
+void P3M_charge_assign_cached();
+
+/** mark the cached forward transformed charge mesh as outdated. Called
+    whenever particles move or their charges or the P3M parameters
+    change. */
+void P3M_invalidate_charge_cache();
+
+/** Change of the k-space energy, including the self energy and net
+    charge corrections, if the charges are changed as given. The
+    transformed charge mesh of the current configuration is cached, so
+    that the cost is proportional to the number of changes times the
+    size of the local k-space mesh. Has to be called on all nodes, the
+    result is only valid on the master node.
+    @param n number of changes
+    @param c the changes, see \ref ChargeChange */
+double P3M_energy_change(int n, ChargeChange *c);
+
 /** assign a single charge into the current charge grid. cp_cnt gives the a running index,
     which may be smaller than 0, in which case the charge is assumed to be virtual and is not
-    stored in the ca_frac arrays. */
+    stored in the ca_frac arrays.
+
+    The charge assignment function is a product of three one
+    dimensional weights. Only these 3*cao weights are computed and
+    stored (the first set multiplied by the charge), the cao^3 charge
+    fractions are formed on the fly while spreading. The innermost
+    loop runs along the contiguous mesh direction, so that it can be
+    vectorized. The charge is spread onto \a mesh, which has the
+    layout of the local charge assignment mesh. */
     
-MDINLINE void P3M_assign_charge(double q,
-				double real_pos[3],
-				int cp_cnt)
+MDINLINE void P3M_assign_charge_to_mesh(double q,
+					double real_pos[3],
+					int cp_cnt,
+					double *mesh)
 {
   /* we do not really want to export these, but this function should be inlined */
   double P3M_caf(int i, double x,int cao_value);
@@ -175,107 +223,92 @@ MDINLINE void P3M_assign_charge(double q,
   extern double *ca_frac;
   extern double *int_caf[7];
   extern double pos_shift;
-  extern double *rs_mesh;
 
-  int d, i0, i1, i2;
-  double tmp0, tmp1;
+  int d, i, i0, i1, i2;
+  double tmp1;
   /* position of a particle in local mesh units */
   double pos;
   /* 1d-index of nearest mesh point */
   int nmp;
   /* distance to nearest mesh point */
-  double dist[3];
+  double dist;
   /* index for caf interpolation grid */
-  int arg[3];
+  int arg;
   /* index, index jumps for rs_mesh array */
   int q_ind = 0;
-  double cur_ca_frac_val, *cur_ca_frac;
-
-  // make sure we have enough space
-  if (cp_cnt >= ca_num) realloc_ca_fields(cp_cnt + 1);
-  // do it here, since realloc_ca_fields may change the address of ca_frac
-  cur_ca_frac = ca_frac + p3m.cao3*cp_cnt;
-
-  if (p3m.inter == 0) {
-    for(d=0;d<3;d++) {
-      /* particle position in mesh coordinates */
-      pos    = ((real_pos[d]-lm.ld_pos[d])*p3m.ai[d]) - pos_shift;
-      /* nearest mesh point */
-      nmp  = (int)pos;
-      /* distance to nearest mesh point */
-      dist[d] = (pos-nmp)-0.5;
-      /* 3d-array index of nearest mesh point */
-      q_ind = (d == 0) ? nmp : nmp + lm.dim[d]*q_ind;
+  int q_off = lm.dim[2] * (lm.dim[1] - p3m.cao);
+  /* one dimensional weights, for virtual charges on the stack */
+  double w_virt[3*7], *w, *w2, *row;
+
+  if (cp_cnt >= 0) {
+    // make sure we have enough space
+    if (cp_cnt >= ca_num) realloc_ca_fields(cp_cnt + 1);
+    // do it here, since realloc_ca_fields may change the address of ca_frac
+    w = ca_frac + 3*p3m.cao*cp_cnt;
+  }
+  else
+    w = w_virt;
 
-#ifdef ADDITIONAL_CHECKS
-      if( pos < -skin*p3m.ai[d] ) {
-	fprintf(stderr,"%d: rs_mesh underflow! (pos %f)\n", this_node, real_pos[d]);
-	fprintf(stderr,"%d: allowed coordinates: %f - %f\n",
-		this_node,my_left[d] - skin, my_right[d] + skin);	    
-      }
-      if( (nmp + p3m.cao) > lm.dim[d] ) {
-	fprintf(stderr,"%d: rs_mesh overflow! (pos %f, nmp=%d)\n", this_node, real_pos[d],nmp);
-	fprintf(stderr,"%d: allowed coordinates: %f - %f\n",
-		this_node, my_left[d] - skin, my_right[d] + skin);
-      }
-#endif
+  for(d=0;d<3;d++) {
+    /* particle position in mesh coordinates */
+    pos    = ((real_pos[d]-lm.ld_pos[d])*p3m.ai[d]) - pos_shift;
+    /* nearest mesh point */
+    nmp  = (int)pos;
+    /* 3d-array index of nearest mesh point */
+    q_ind = (d == 0) ? nmp : nmp + lm.dim[d]*q_ind;
+
+    if (p3m.inter == 0) {
+      /* distance to nearest mesh point */
+      dist = (pos-nmp)-0.5;
+      for(i=0; i<p3m.cao; i++)
+	w[d*p3m.cao + i] = P3M_caf(i, dist, p3m.cao);
     }
-    if (cp_cnt >= 0) ca_fmp[cp_cnt] = q_ind;
-    
-    for(i0=0; i0<p3m.cao; i0++) {
-      tmp0 = P3M_caf(i0, dist[0],p3m.cao);
-      for(i1=0; i1<p3m.cao; i1++) {
-	tmp1 = tmp0 * P3M_caf(i1, dist[1],p3m.cao);
-	for(i2=0; i2<p3m.cao; i2++) {
-	  cur_ca_frac_val = q * tmp1 * P3M_caf(i2, dist[2], p3m.cao);
-	  if (cp_cnt >= 0) *(cur_ca_frac++) = cur_ca_frac_val;
-	  rs_mesh[q_ind] += cur_ca_frac_val;
-	  q_ind++;
-	}
-	q_ind += lm.q_2_off;
-      }
-      q_ind += lm.q_21_off;
+    else {
+      arg = (int) ((pos - nmp)*p3m.inter2);
+      for(i=0; i<p3m.cao; i++)
+	w[d*p3m.cao + i] = int_caf[i][arg];
     }
-  }
-  else {
-    /* particle position in mesh coordinates */
-    for(d=0;d<3;d++) {
-      pos    = ((real_pos[d]-lm.ld_pos[d])*p3m.ai[d]) - pos_shift;
-      nmp    = (int) pos;
-      arg[d] = (int) ((pos - nmp)*p3m.inter2);
-      /* for the first dimension, q_ind is always zero, so this shifts correctly */
-      q_ind = nmp + lm.dim[d]*q_ind;
 
 #ifdef ADDITIONAL_CHECKS
-      if( pos < -skin*p3m.ai[d] ) {
-	fprintf(stderr,"%d: rs_mesh underflow! (pos %f)\n", this_node, real_pos[d]);
-	fprintf(stderr,"%d: allowed coordinates: %f - %f\n",
-		this_node,my_left[d] - skin, my_right[d] + skin);	    
-      }
-      if( (nmp + p3m.cao) > lm.dim[d] ) {
-	fprintf(stderr,"%d: rs_mesh overflow! (pos %f, nmp=%d)\n", this_node, real_pos[d],nmp);
-	fprintf(stderr,"%d: allowed coordinates: %f - %f\n",
-		this_node, my_left[d] - skin, my_right[d] + skin);
-      }
-#endif
+    if( pos < -skin*p3m.ai[d] ) {
+      fprintf(stderr,"%d: rs_mesh underflow! (pos %f)\n", this_node, real_pos[d]);
+      fprintf(stderr,"%d: allowed coordinates: %f - %f\n",
+	      this_node,my_left[d] - skin, my_right[d] + skin);	    
     }
-    if (cp_cnt >= 0) ca_fmp[cp_cnt] = q_ind;
-
-    for(i0=0; i0<p3m.cao; i0++) {
-      tmp0 = int_caf[i0][arg[0]];
-      for(i1=0; i1<p3m.cao; i1++) {
-	tmp1 = tmp0 * int_caf[i1][arg[1]];
-	for(i2=0; i2<p3m.cao; i2++) {
-	  cur_ca_frac_val = q * tmp1 * int_caf[i2][arg[2]];
-	  if (cp_cnt >= 0) *(cur_ca_frac++) = cur_ca_frac_val;
-	  rs_mesh[q_ind] += cur_ca_frac_val;
-	  q_ind++;
-	}
-	q_ind += lm.q_2_off;
-      }
-      q_ind += lm.q_21_off;
+    if( (nmp + p3m.cao) > lm.dim[d] ) {
+      fprintf(stderr,"%d: rs_mesh overflow! (pos %f, nmp=%d)\n", this_node, real_pos[d],nmp);
+      fprintf(stderr,"%d: allowed coordinates: %f - %f\n",
+	      this_node, my_left[d] - skin, my_right[d] + skin);
     }
+#endif
   }
+  if (cp_cnt >= 0) ca_fmp[cp_cnt] = q_ind;
+
+  for(i=0; i<p3m.cao; i++) w[i] *= q;
+
+  /* tensor product spreading */
+  w2 = w + 2*p3m.cao;
+  for(i0=0; i0<p3m.cao; i0++) {
+    for(i1=0; i1<p3m.cao; i1++) {
+      tmp1 = w[i0] * w[p3m.cao + i1];
+      row = mesh + q_ind;
+      for(i2=0; i2<p3m.cao; i2++)
+	row[i2] += tmp1 * w2[i2];
+      q_ind += lm.dim[2];
+    }
+    q_ind += q_off;
+  }
+}
+
+/** assign a single charge into the current charge grid, see \ref
+    P3M_assign_charge_to_mesh. */
+MDINLINE void P3M_assign_charge(double q,
+				double real_pos[3],
+				int cp_cnt)
+{
+  extern double *rs_mesh;
+
+  P3M_assign_charge_to_mesh(q, real_pos, cp_cnt, rs_mesh);
 }
 
 /** shrink wrap the charge grid */
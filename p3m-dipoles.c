@@ -58,10 +58,10 @@
  /** Spatial differential operator in k-space. We use an i*k differentiation. */ 
   double *Dd_op = NULL;
 
-  /** Force optimised influence function (k-space) */
+  /** Force optimised influence function (k-space, half spectrum, see \ref Dfft_ks_half_dim) */
   double *Dg_force = NULL;
   
-   /** Energy optimised influence function (k-space) */
+   /** Energy optimised influence function (k-space, half spectrum) */
   double *Dg_energy = NULL;
   
    /** number of magnetic particles on the node. */
@@ -99,6 +99,17 @@
    /** k space mesh (local) for k space calculation and FFT.*/
    double *Dks_mesh = NULL;
 
+  /** further meshes for the batched back transform of the six
+      independent force meshes, see \ref Dforce_mesh_dir. */
+  static double *Drs_force_mesh[4] = { NULL, NULL, NULL, NULL };
+
+  /** real space directions (a,c) of the six symmetric force meshes
+      k_a*k_c*(mu.k)*G. */
+  static const int Dforce_mesh_dir[6][2] = { {0,0}, {1,1}, {2,2}, {0,1}, {0,2}, {1,2} };
+
+  /** index of the force mesh of the directions a and c. */
+  static const int Dforce_mesh_ind[3][3] = { {0,3,4}, {3,1,5}, {4,5,2} };
+
   /** Field to store grid points to send. */
   double *Dsend_grid = NULL; 
   
@@ -347,6 +358,9 @@ double P3M_Average_dipolar_SelfEnergy(double box_l, int mesh) {
 	  node_phi += 0.0;
 	else {
 		  U2 = perform_aliasing_sums_dipolar_self_energy(n);
+		  /* account for the mode -n, which is not stored */
+		  if( n[Dfft_ks_half_dim] != 0 && 2*n[Dfft_ks_half_dim] != p3m.Dmesh[0] )
+		    U2 *= 2.0;
 		  node_phi += Dg_energy[ind] * U2*(SQR(Dd_op[n[0]])+SQR(Dd_op[n[1]])+SQR(Dd_op[n[2]]));
 	}
       }}}
@@ -858,15 +872,18 @@ void P3M_dipole_assign()
 
 
 #ifdef ROTATION
-/* assign the torques obtained from k-space */
-static void P3M_assign_torques(double prefac, int d_rs)
+/* assign the torques obtained from k-space. mesh[d] holds the
+   component d of the k-space field, the torque is its cross product
+   with the dipole moment. */
+static void P3M_assign_torques(double prefac, double **mesh)
 {
   Cell *cell;
   Particle *p;
   int i,c,np,i0,i1,i2;
+  double E[3];
   /* particle counter, charge fraction counter */
   int cp_cnt=0, cf_cnt=0;
-  /* index, index jumps for Drs_mesh array */
+  /* index, index jumps for the mesh arrays */
   int q_ind;
   int q_m_off = (Dlm.dim[2] - p3m.Dcao);
   int q_s_off = Dlm.dim[2] * (Dlm.dim[1] - p3m.Dcao);
@@ -876,41 +893,30 @@ static void P3M_assign_torques(double prefac, int d_rs)
     cell = local_cells.cell[c];
     p  = cell->part;
     np = cell->n;
-    for(i=0; i<np; i++) { 
+    for(i=0; i<np; i++) {
       if( (p[i].p.dipm) != 0.0 ) {
 	q_ind = Dca_fmp[cp_cnt];
+	E[0] = E[1] = E[2] = 0.0;
 	for(i0=0; i0<p3m.Dcao; i0++) {
 	  for(i1=0; i1<p3m.Dcao; i1++) {
 	    for(i2=0; i2<p3m.Dcao; i2++) {
-/*
-The following line would fill the torque with the k-space electric field
-(without the self-field term) [notice the minus sign!]:		  
-		    p[i].f.torque[d_rs] -= prefac*Dca_frac[cf_cnt]*Drs_mesh[q_ind];;
-Since the torque is the dipole moment cross-product with E, we have:	
-*/
-              switch (d_rs) {
-		case 0:	//E_x
-		  p[i].f.torque[1] -= p[i].r.dip[2]*prefac*Dca_frac[cf_cnt]*Drs_mesh[q_ind];     
-		  p[i].f.torque[2] += p[i].r.dip[1]*prefac*Dca_frac[cf_cnt]*Drs_mesh[q_ind]; 
-		  break;
-		case 1:	//E_y
-		  p[i].f.torque[0] += p[i].r.dip[2]*prefac*Dca_frac[cf_cnt]*Drs_mesh[q_ind];  
-		  p[i].f.torque[2] -= p[i].r.dip[0]*prefac*Dca_frac[cf_cnt]*Drs_mesh[q_ind];  
-		  break;
-		case 2:	//E_z
-		  p[i].f.torque[0] -= p[i].r.dip[1]*prefac*Dca_frac[cf_cnt]*Drs_mesh[q_ind];  
-		  p[i].f.torque[1] += p[i].r.dip[0]*prefac*Dca_frac[cf_cnt]*Drs_mesh[q_ind];  
-	      }
-	      q_ind++; 
+	      E[0] += Dca_frac[cf_cnt]*mesh[0][q_ind];
+	      E[1] += Dca_frac[cf_cnt]*mesh[1][q_ind];
+	      E[2] += Dca_frac[cf_cnt]*mesh[2][q_ind];
+	      q_ind++;
 	      cf_cnt++;
 	    }
 	    q_ind += q_m_off;
 	  }
 	  q_ind += q_s_off;
 	}
+	/* the field has the opposite sign of the mesh [notice the minus sign!] */
+	p[i].f.torque[0] -= prefac*(p[i].r.dip[1]*E[2] - p[i].r.dip[2]*E[1]);
+	p[i].f.torque[1] -= prefac*(p[i].r.dip[2]*E[0] - p[i].r.dip[0]*E[2]);
+	p[i].f.torque[2] -= prefac*(p[i].r.dip[0]*E[1] - p[i].r.dip[1]*E[0]);
 	cp_cnt++;
 
-	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  f = (%.3e,%.3e,%.3e) in dir %d add %.5f\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2],d_rs,-db_fsum));
+	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  t = (%.3e,%.3e,%.3e)\n",this_node,p[i].f.torque[0],p[i].f.torque[1],p[i].f.torque[2]));
       }
     }
   }
@@ -919,15 +925,18 @@ Since the torque is the dipole moment cross-product with E, we have:
 /*****************************************************************************/
 
 
-/* assign the dipolar forces obtained from k-space */
-static void DP3M_assign_forces_dip(double prefac, int d_rs)
+/* assign the dipolar forces obtained from k-space. The force
+   component d is the contraction of the dipole moment with the
+   symmetric meshes mesh[Dforce_mesh_ind[d][0..2]]. */
+static void DP3M_assign_forces_dip(double prefac, double **mesh)
 {
   Cell *cell;
   Particle *p;
-  int i,c,np,i0,i1,i2;
+  int i,c,np,i0,i1,i2,d;
+  double frac, f[3];
   /* particle counter, charge fraction counter */
   int cp_cnt=0, cf_cnt=0;
-  /* index, index jumps for Drs_mesh array */
+  /* index, index jumps for the mesh arrays */
   int q_ind;
   int q_m_off = (Dlm.dim[2] - p3m.Dcao);
   int q_s_off = Dlm.dim[2] * (Dlm.dim[1] - p3m.Dcao);
@@ -937,16 +946,18 @@ static void DP3M_assign_forces_dip(double prefac, int d_rs)
     cell = local_cells.cell[c];
     p  = cell->part;
     np = cell->n;
-    for(i=0; i<np; i++) { 
+    for(i=0; i<np; i++) {
       if( (p[i].p.dipm) != 0.0 ) {
 	q_ind = Dca_fmp[cp_cnt];
+	f[0] = f[1] = f[2] = 0.0;
 	for(i0=0; i0<p3m.Dcao; i0++) {
 	  for(i1=0; i1<p3m.Dcao; i1++) {
 	    for(i2=0; i2<p3m.Dcao; i2++) {
-	      p[i].f.f[d_rs] += prefac*Dca_frac[cf_cnt]*
-	                          ( Drs_mesh_dip[0][q_ind]*p[i].r.dip[0]
-		                  +Drs_mesh_dip[1][q_ind]*p[i].r.dip[1]
-				  +Drs_mesh_dip[2][q_ind]*p[i].r.dip[2]);
+	      frac = Dca_frac[cf_cnt];
+	      for(d=0; d<3; d++)
+		f[d] += frac*( mesh[Dforce_mesh_ind[d][0]][q_ind]*p[i].r.dip[0]
+			      +mesh[Dforce_mesh_ind[d][1]][q_ind]*p[i].r.dip[1]
+			      +mesh[Dforce_mesh_ind[d][2]][q_ind]*p[i].r.dip[2]);
 	      q_ind++;
 	      cf_cnt++;
 	    }
@@ -954,9 +965,11 @@ static void DP3M_assign_forces_dip(double prefac, int d_rs)
 	  }
 	  q_ind += q_s_off;
 	}
+	for(d=0; d<3; d++)
+	  p[i].f.f[d] += prefac*f[d];
 	cp_cnt++;
 
-	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  f = (%.3e,%.3e,%.3e) in dir %d add %.5f\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2],d_rs,-db_fsum));
+	ONEPART_TRACE(if(p[i].p.identity==check_id) fprintf(stderr,"%d: OPT: P3M  f = (%.3e,%.3e,%.3e)\n",this_node,p[i].f.f[0],p[i].f.f[1],p[i].f.f[2]));
       }
     }
   }
@@ -965,9 +978,16 @@ static void DP3M_assign_forces_dip(double prefac, int d_rs)
 /*****************************************************************************/
 
 
-double P3M_calc_kspace_forces_for_dipoles(int force_flag, int energy_flag) 
+double P3M_calc_kspace_forces_for_dipoles(int force_flag, int energy_flag)
 {
-  int i,d,d_rs,ind,j[3];
+  int i,c,d,s,m,ind,j[3],half,n_half;
+  /* k-space direction of the real space component c */
+  int ks_dir[3];
+  /* differential operator of a k-space mesh point, by real space component */
+  double k[3];
+  /* meshes of the batched back transform */
+  double *back_mesh[9];
+  int n_back;
   /**************************************************************/
    /* k space energy */
   double dipole_prefac;
@@ -977,19 +997,19 @@ double P3M_calc_kspace_forces_for_dipoles(int force_flag, int energy_flag)
   P3M_TRACE(fprintf(stderr,"%d: dipolar p3m_perform: \n",this_node));
 
   dipole_prefac = coulomb.Dprefactor / (double)(p3m.Dmesh[0]*p3m.Dmesh[1]*p3m.Dmesh[2]);
- 
-  if (p3m_sum_mu2 > 0) { 
+  for(d=0;d<3;d++) ks_dir[(d+Dks_pnum)%3] = d;
+  half = Dfft_ks_half_dim;
+
+  if (p3m_sum_mu2 > 0) {
     /* Gather information for FFT grid inside the nodes domain (inner local mesh) */
-    /* and Perform forward 3D FFT (Charge Assignment Mesh). */
+    /* and Perform forward 3D FFT of all three dipole components together. */
     Dgather_fft_grid(Drs_mesh_dip[0]);
     Dgather_fft_grid(Drs_mesh_dip[1]);
     Dgather_fft_grid(Drs_mesh_dip[2]);
-    Dfft_perform_forw(Drs_mesh_dip[0]);
-    Dfft_perform_forw(Drs_mesh_dip[1]);
-    Dfft_perform_forw(Drs_mesh_dip[2]);
+    Dfft_perform_forw_batch(Drs_mesh_dip, 3);
     //Note: after these calls, the grids are in the order yzx and not xyz anymore!!!
   }
-  
+
   /* === K Space Calculations === */
   P3M_TRACE(fprintf(stderr,"%d: dipolar p3m_perform: k-Space\n",this_node));
 
@@ -1003,36 +1023,39 @@ double P3M_calc_kspace_forces_for_dipoles(int force_flag, int energy_flag)
 
 
     /* i*k differentiation for dipolar gradients: |(\Fourier{\vect{mu}}(k)\cdot \vect{k})|^2 */
-    ind=0;
-    i=0;
-    for(j[0]=0; j[0]<Dfft_plan[3].new_mesh[0]; j[0]++) {
+#ifdef _OPENMP
+#pragma omp parallel for private(j,c,k,ind,i,n_half,tmp0,tmp1) reduction(+:node_k_space_energy_dip)
+#endif
+    for(m=0; m<Dfft_plan[3].new_mesh[0]; m++) {
+      j[0] = m;
       for(j[1]=0; j[1]<Dfft_plan[3].new_mesh[1]; j[1]++) {
-	for(j[2]=0; j[2]<Dfft_plan[3].new_mesh[2]; j[2]++) {	 
-	  node_k_space_energy_dip += Dg_energy[i] * (
-	  SQR(Drs_mesh_dip[0][ind]*Dd_op[j[2]+Dfft_plan[3].start[0]]+
-	      Drs_mesh_dip[1][ind]*Dd_op[j[0]+Dfft_plan[3].start[1]]+
-	      Drs_mesh_dip[2][ind]*Dd_op[j[1]+Dfft_plan[3].start[2]]
-	  ) +
-	  SQR(Drs_mesh_dip[0][ind+1]*Dd_op[j[2]+Dfft_plan[3].start[0]]+
-	      Drs_mesh_dip[1][ind+1]*Dd_op[j[0]+Dfft_plan[3].start[1]]+
-	      Drs_mesh_dip[2][ind+1]*Dd_op[j[1]+Dfft_plan[3].start[2]]
-	      ));
-	  ind += 2;
-	  i++;
+	for(j[2]=0; j[2]<Dfft_plan[3].new_mesh[2]; j[2]++) {
+	  i   = j[2] + Dfft_plan[3].new_mesh[2]*(j[1] + Dfft_plan[3].new_mesh[1]*j[0]);
+	  ind = 2*i;
+	  for(c=0;c<3;c++) k[c] = Dd_op[ j[ks_dir[c]]+Dfft_plan[3].start[ks_dir[c]] ];
+	  tmp0 = Drs_mesh_dip[0][ind]*k[0] + Drs_mesh_dip[1][ind]*k[1] + Drs_mesh_dip[2][ind]*k[2];
+	  tmp1 = Drs_mesh_dip[0][ind+1]*k[0] + Drs_mesh_dip[1][ind+1]*k[1] + Drs_mesh_dip[2][ind+1]*k[2];
+	  /* only half of the spectrum is stored, the modes with a
+	     distinct hermitian partner count twice */
+	  n_half = j[half] + Dfft_plan[3].start[half];
+	  if( n_half != 0 && 2*n_half != p3m.Dmesh[0] )
+	    node_k_space_energy_dip += 2.0 * Dg_energy[i] * (SQR(tmp0) + SQR(tmp1));
+	  else
+	    node_k_space_energy_dip += Dg_energy[i] * (SQR(tmp0) + SQR(tmp1));
 	}
       }
     }
     node_k_space_energy_dip *= dipole_prefac * PI / box_l[0];
     MPI_Reduce(&node_k_space_energy_dip, &k_space_energy_dip, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-   
+
    if (Dflag_constants_energy_dipolar==0) {Dflag_constants_energy_dipolar=1;}
-   compute_constants_energy_dipolar(); 
-   
-    k_space_energy_dip+= coulomb.Dprefactor*Dipolar_energy_correction; /* add the dipolar energy correction due to systematic Madelung-Self effects */  
-   
+   compute_constants_energy_dipolar();
+
+    k_space_energy_dip+= coulomb.Dprefactor*Dipolar_energy_correction; /* add the dipolar energy correction due to systematic Madelung-Self effects */
+
    /*fprintf(stderr,"p3m.Depsilon=%lf\n", p3m.Depsilon);
    fprintf(stderr,"*Dipolar_energy_correction=%20.15lf\n",Dipolar_energy_correction);*/
-   
+
     if(this_node==0) {
       /* self energy correction */
       k_space_energy_dip -= coulomb.Dprefactor*(p3m_sum_mu2*2*pow(p3m.Dalpha_L*box_l_i[0],3) * wupii/3.0);
@@ -1045,136 +1068,69 @@ double P3M_calc_kspace_forces_for_dipoles(int force_flag, int energy_flag)
 
   /* === K Space Force Calculation  === */
   if(force_flag) {
-  /***************************        
-   DIPOLAR TORQUES (k-space)
-****************************/
   if (p3m_sum_mu2 > 0) {
- #ifdef ROTATION
-   P3M_TRACE(fprintf(stderr,"%d: dipolar p3m start torques calculation: k-Space\n",this_node));
+    P3M_TRACE(fprintf(stderr,"%d: dipolar p3m start forces and torques calculation: k-Space\n",this_node));
 
-    /* fill in ks_mesh array for torque calculation */
-    ind=0;
-    i=0;
-       
-    for(j[0]=0; j[0]<Dfft_plan[3].new_mesh[0]; j[0]++) {	     //j[0]=n_y
-      for(j[1]=0; j[1]<Dfft_plan[3].new_mesh[1]; j[1]++) {    //j[1]=n_z
-	for(j[2]=0; j[2]<Dfft_plan[3].new_mesh[2]; j[2]++) {  //j[2]=n_x
+    /* The six independent force meshes k_a*k_c*(mu.k)*G, and with
+       ROTATION the three field meshes k_a*(mu.k)*G for the torques,
+       are filled in one sweep and transformed back in one batch. The
+       field meshes overwrite the dipole meshes. */
+    n_back = 0;
+#ifdef ROTATION
+    for(c=0;c<3;c++) back_mesh[n_back++] = Drs_mesh_dip[c];
+#endif
+    back_mesh[n_back++] = Drs_mesh;
+    back_mesh[n_back++] = Dks_mesh;
+    for(s=0;s<4;s++) back_mesh[n_back++] = Drs_force_mesh[s];
+
+#ifdef _OPENMP
+#pragma omp parallel for private(j,c,s,k,ind,i,tmp0,tmp1)
+#endif
+    for(m=0; m<Dfft_plan[3].new_mesh[0]; m++) {
+      j[0] = m;
+      for(j[1]=0; j[1]<Dfft_plan[3].new_mesh[1]; j[1]++) {
+	for(j[2]=0; j[2]<Dfft_plan[3].new_mesh[2]; j[2]++) {
+	  i   = j[2] + Dfft_plan[3].new_mesh[2]*(j[1] + Dfft_plan[3].new_mesh[1]*j[0]);
+	  ind = 2*i;
+	  for(c=0;c<3;c++) k[c] = Dd_op[ j[ks_dir[c]]+Dfft_plan[3].start[ks_dir[c]] ];
 	  //tmp0 = Re(mu)*k,   tmp1 = Im(mu)*k
-	  
-	  tmp0 = Drs_mesh_dip[0][ind]*Dd_op[j[2]+Dfft_plan[3].start[0]]+
-		 Drs_mesh_dip[1][ind]*Dd_op[j[0]+Dfft_plan[3].start[1]]+
-		 Drs_mesh_dip[2][ind]*Dd_op[j[1]+Dfft_plan[3].start[2]];
-		 
-	  tmp1 = Drs_mesh_dip[0][ind+1]*Dd_op[j[2]+Dfft_plan[3].start[0]]+
-		 Drs_mesh_dip[1][ind+1]*Dd_op[j[0]+Dfft_plan[3].start[1]]+
-		 Drs_mesh_dip[2][ind+1]*Dd_op[j[1]+Dfft_plan[3].start[2]];
-		 
+	  tmp0 = Drs_mesh_dip[0][ind]*k[0] + Drs_mesh_dip[1][ind]*k[1] + Drs_mesh_dip[2][ind]*k[2];
+	  tmp1 = Drs_mesh_dip[0][ind+1]*k[0] + Drs_mesh_dip[1][ind+1]*k[1] + Drs_mesh_dip[2][ind+1]*k[2];
+#ifdef ROTATION
 	  /* the optimal influence function is the same for torques
-	     and energy */ 
-	     
- 	  Dks_mesh[ind]   = tmp0*Dg_energy[i]; 
-	  Dks_mesh[ind+1] = tmp1*Dg_energy[i];
-	  ind += 2;
-	  i++;
-	}
-      }
-    }
- 
-        
-    /* Force component loop */
-    for(d=0;d<3;d++) {
-      d_rs = (d+Dks_pnum)%3;
-      ind=0;
-      for(j[0]=0; j[0]<Dfft_plan[3].new_mesh[0]; j[0]++) {
-	for(j[1]=0; j[1]<Dfft_plan[3].new_mesh[1]; j[1]++) {
-	  for(j[2]=0; j[2]<Dfft_plan[3].new_mesh[2]; j[2]++) {
-	    Drs_mesh[ind] = Dd_op[ j[d]+Dfft_plan[3].start[d] ]*Dks_mesh[ind]; ind++;
-	    Drs_mesh[ind] = Dd_op[ j[d]+Dfft_plan[3].start[d] ]*Dks_mesh[ind]; ind++;
+	     and energy */
+	  for(c=0;c<3;c++) {
+	    Drs_mesh_dip[c][ind]   = k[c]*(tmp0*Dg_energy[i]);
+	    Drs_mesh_dip[c][ind+1] = k[c]*(tmp1*Dg_energy[i]);
+	  }
+#endif
+	  /* i*(mu.k)*G = Im*G - i*Re*G */
+	  for(s=0;s<6;s++) {
+	    back_mesh[n_back-6+s][ind]   =  k[Dforce_mesh_dir[s][0]]*k[Dforce_mesh_dir[s][1]]*(tmp1*Dg_force[i]);
+	    back_mesh[n_back-6+s][ind+1] = -k[Dforce_mesh_dir[s][0]]*k[Dforce_mesh_dir[s][1]]*(tmp0*Dg_force[i]);
 	  }
-	}
-      }
-
-
-      /* Back FFT force component mesh */
-      Dfft_perform_back(Drs_mesh);
-      /* redistribute force component mesh */
-      Dspread_force_grid(Drs_mesh);  
-      /* Assign force component from mesh to particle */
-      P3M_assign_torques(dipole_prefac*(2*PI/box_l[0]), d_rs);
-    }
- #endif  /*if def ROTATION */ 
-    
-/***************************
-   DIPOLAR FORCES (k-space)
-****************************/
-    P3M_TRACE(fprintf(stderr,"%d: dipolar p3m start forces calculation: k-Space\n",this_node));
-
-//Compute forces after torques because the algorithm below overwrites the grids Drs_mesh_dip !
-//Note: I'll do here 9 inverse FFTs. By symmetry, we can reduce this number to 6 !
-    /* fill in ks_mesh array for force calculation */
-    ind=0;
-    i=0;
-    for(j[0]=0; j[0]<Dfft_plan[3].new_mesh[0]; j[0]++) {	     //j[0]=n_y
-      for(j[1]=0; j[1]<Dfft_plan[3].new_mesh[1]; j[1]++) {    //j[1]=n_z
-	for(j[2]=0; j[2]<Dfft_plan[3].new_mesh[2]; j[2]++) {  //j[2]=n_x
-	  //tmp0 = Im(mu)*k,   tmp1 = -Re(mu)*k
-	  tmp0 = Drs_mesh_dip[0][ind+1]*Dd_op[j[2]+Dfft_plan[3].start[0]]+
-		 Drs_mesh_dip[1][ind+1]*Dd_op[j[0]+Dfft_plan[3].start[1]]+
-		 Drs_mesh_dip[2][ind+1]*Dd_op[j[1]+Dfft_plan[3].start[2]];
-	  tmp1 = Drs_mesh_dip[0][ind]*Dd_op[j[2]+Dfft_plan[3].start[0]]+
-		 Drs_mesh_dip[1][ind]*Dd_op[j[0]+Dfft_plan[3].start[1]]+
-		 Drs_mesh_dip[2][ind]*Dd_op[j[1]+Dfft_plan[3].start[2]];
-//	  Dks_mesh[ind]   = tmp0*Dg[i];
-//	  Dks_mesh[ind+1] = -tmp1*Dg[i];
-          /* Next two lines modified by JJCP 26-4-06 */
-	  Dks_mesh[ind]   = tmp0*Dg_force[i];
-	  Dks_mesh[ind+1] = -tmp1*Dg_force[i];
-	  ind += 2;
-	  i++;
 	}
       }
     }
 
-    /* Force component loop */
-    for(d=0;d<3;d++) {       /* direction in k space: */
-    d_rs = (d+Dks_pnum)%3;
-    ind=0;
-    for(j[0]=0; j[0]<Dfft_plan[3].new_mesh[0]; j[0]++) {	     //j[0]=n_y
-      for(j[1]=0; j[1]<Dfft_plan[3].new_mesh[1]; j[1]++) {    //j[1]=n_z
-	for(j[2]=0; j[2]<Dfft_plan[3].new_mesh[2]; j[2]++) {  //j[2]=n_x
-	  tmp0 = Dd_op[ j[d]+Dfft_plan[3].start[d] ]*Dks_mesh[ind];
-	  Drs_mesh_dip[0][ind] = Dd_op[ j[2]+Dfft_plan[3].start[d] ]*tmp0;
-	  Drs_mesh_dip[1][ind] = Dd_op[ j[0]+Dfft_plan[3].start[d] ]*tmp0;
-	  Drs_mesh_dip[2][ind] = Dd_op[ j[1]+Dfft_plan[3].start[d] ]*tmp0;
-	  ind++;
-	  tmp0 = Dd_op[ j[d]+Dfft_plan[3].start[d] ]*Dks_mesh[ind];
-	  Drs_mesh_dip[0][ind] = Dd_op[ j[2]+Dfft_plan[3].start[d] ]*tmp0;
-	  Drs_mesh_dip[1][ind] = Dd_op[ j[0]+Dfft_plan[3].start[d] ]*tmp0;
-	  Drs_mesh_dip[2][ind] = Dd_op[ j[1]+Dfft_plan[3].start[d] ]*tmp0;
-	  ind++;
-	}
-      }
-    }
+    /* Back FFT all field and force meshes together */
+    Dfft_perform_back_batch(back_mesh, n_back);
+    /* redistribute the meshes */
+    for(s=0;s<n_back;s++)
+      Dspread_force_grid(back_mesh[s]);
+#ifdef ROTATION
+    /* Assign torques from the field meshes to the particles */
+    P3M_assign_torques(dipole_prefac*(2*PI/box_l[0]), back_mesh);
+#endif
+    /* Assign forces from the symmetric force meshes to the particles */
+    DP3M_assign_forces_dip(dipole_prefac*pow(2*PI/box_l[0],2), back_mesh + n_back - 6);
 
-      /* Back FFT force component mesh */
-      Dfft_perform_back(Drs_mesh_dip[0]);
-      Dfft_perform_back(Drs_mesh_dip[1]);
-      Dfft_perform_back(Drs_mesh_dip[2]);
-      /* redistribute force component mesh */
-      Dspread_force_grid(Drs_mesh_dip[0]);
-      Dspread_force_grid(Drs_mesh_dip[1]);
-      Dspread_force_grid(Drs_mesh_dip[2]);
-      /* Assign force component from mesh to particle */
-      DP3M_assign_forces_dip(dipole_prefac*pow(2*PI/box_l[0],2), d_rs); 
-   }
-   
-       P3M_TRACE(fprintf(stderr,"%d: dipolar p3m end forces calculation: k-Space\n",this_node));
+    P3M_TRACE(fprintf(stderr,"%d: dipolar p3m end forces calculation: k-Space\n",this_node));
 
-   
  } /* of if (p3m_sum_mu2>0 */
 } /* of if(force_flag) */
 
- 
+
   if (p3m.Depsilon != P3M_EPSILON_METALLIC) {
     k_space_energy_dip += calc_surface_term(force_flag, energy_flag);
    }
@@ -2815,6 +2771,8 @@ void   P3M_init_dipoles() {
 
     for (n=0;n<3;n++)   
        Drs_mesh_dip[n] = (double *) realloc(Drs_mesh_dip[n], Dca_mesh_size*sizeof(double));
+    for (n=0;n<4;n++)
+       Drs_force_mesh[n] = (double *) realloc(Drs_force_mesh[n], Dca_mesh_size*sizeof(double));
 
      P3M_TRACE(fprintf(stderr,"%d: Drs_mesh_dip[0] ADR=%p\n",this_node,Drs_mesh_dip[0]));
      P3M_TRACE(fprintf(stderr,"%d: Drs_mesh_dip[1] ADR=%p\n",this_node,Drs_mesh_dip[1]));
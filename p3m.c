@@ -24,6 +24,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "utils.h"
 #include "integrate.h"
@@ -55,6 +58,10 @@
 #define P3M_RCUT_PREC 1e-3
 /** granularity of the time measurement */
 #define P3M_TIME_GRAN 2
+/** relative tolerance for reusing an entry of the P3M tuning cache */
+#define P3M_TUNE_CACHE_TOL 0.05
+/** default number of timed integration steps per setting for the joint tuning */
+#define P3M_JOINT_TUNE_STEPS 50
 
 /************************************************
  * variables
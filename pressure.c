@@ -168,7 +168,7 @@ void calc_long_range_virials()
     break;
   case COULOMB_P3M: {
     int k;
-    P3M_charge_assign();
+    P3M_charge_assign_cached();
     virials.coulomb[1] = P3M_calc_kspace_forces_for_charges(0,1);
     
     for(k=0;k<3;k++)
@@ -204,6 +204,11 @@ void calc_long_range_virials()
     fprintf(stderr, "WARNING: pressure calculated, but  MAGNETIC DIRECT SUM pressure not implemented\n");
     break;
 #endif 
+#ifdef DIPOLAR_BARNES_HUT
+    case DIPOLAR_BH:
+    fprintf(stderr, "WARNING: pressure calculated, but Barnes-Hut dipolar pressure not implemented\n");
+    break;
+#endif
    
 #ifdef ELP3M
 #ifdef MDLC
@@ -251,6 +256,7 @@ void init_virials(Observable_stat *stat)
   case DIPOLAR_NONE:  n_dipolar = 0; break;
   case DIPOLAR_ALL_WITH_ALL_AND_NO_REPLICA:  n_dipolar = 0; break;
   case DIPOLAR_DS:  n_dipolar = 0; break;
+  case DIPOLAR_BH:  n_dipolar = 0; break;
   case DIPOLAR_P3M:   n_dipolar = 2; break;
   }
 #endif
@@ -297,6 +303,7 @@ void init_p_tensor(Observable_stat *stat)
   case DIPOLAR_NONE: n_dipolar = 0; break;
   case DIPOLAR_ALL_WITH_ALL_AND_NO_REPLICA:  n_dipolar = 0; break;
   case DIPOLAR_DS:  n_dipolar = 0; break;
+  case DIPOLAR_BH:  n_dipolar = 0; break;
   case DIPOLAR_P3M:  n_dipolar = 2; break;
   }
 #endif
@@ -871,6 +878,11 @@ int get_nonbonded_interaction(Particle *p1, Particle *p2, double *force)
     	fprintf(stderr,"WARNING: Local stress tensor calculation cannot handle MAGNETIC DIPOLAR SUM magnetostatics so it is left out\n");  
 	break;
 #endif
+#ifdef DIPOLAR_BARNES_HUT
+      case DIPOLAR_BH:
+    	fprintf(stderr,"WARNING: Local stress tensor calculation cannot handle Barnes-Hut magnetostatics so it is left out\n");  
+	break;
+#endif
 
       default:
 	fprintf(stderr,"WARNING: Local stress tensor calculation does not recognise this magnetostatic interaction\n");  
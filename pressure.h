@@ -176,6 +176,12 @@ MDINLINE void add_non_bonded_pair_virials(Particle *p1, Particle *p2, double d[3
 	ret=0;
         break; 
 #endif
+#ifdef DIPOLAR_BARNES_HUT
+    case  DIPOLAR_BH:
+	fprintf(stderr,"virials Not working for dipoles Barnes-Hut .... pressure.h \n");
+	ret=0;
+        break; 
+#endif
 
       default:
       ret = 0;
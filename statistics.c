@@ -3624,6 +3624,7 @@ int analyze(ClientData data, Tcl_Interp *interp, int argc, char **argv)
   REGISTER_ANALYSIS("cell_gpb", parse_cell_gpb);
   REGISTER_ANALYSIS("Vkappa", parse_Vkappa);
   REGISTER_ANALYSIS("energy", parse_and_print_energy);
+  REGISTER_ANALYSIS("coulomb_change", parse_coulomb_energy_change);
   REGISTER_ANALYSIS("energy_kinetic", parse_and_print_energy_kinetic);
   REGISTER_ANALYSIS_W_ARG("pressure", parse_and_print_pressure, 0);
 #ifdef VIRTUAL_SITES
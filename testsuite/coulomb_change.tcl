@@ -0,0 +1,120 @@
+#  This file is part of the ESPResSo distribution (http://www.espresso.mpg.de).
+#  It is therefore subject to the ESPResSo license agreement which you accepted upon receiving the distribution
+#  and by which you are legally bound while utilizing this file in any form or way.
+#  There is NO WARRANTY, not even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  You should have received a copy of that license along with this program;
+#  if not, refer to http://www.espresso.mpg.de/license.html where its current version can be found, or
+#  write to Max-Planck-Institute for Polymer Research, Theory Group, PO Box 3148, 55021 Mainz, Germany.
+#  Copyright (c) 2002-2006; all rights reserved unless otherwise stated.
+
+# check analyze coulomb_change against the actual change of the Coulomb energy
+set errf [lindex $argv 1]
+
+source "tests_common.tcl"
+
+require_feature "ELECTROSTATICS"
+require_feature "FFTW"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase coulomb_change.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "---------------------------------------------------------------"
+
+set epsilon 1e-8
+set box_l 10.0
+set n_part 40
+
+thermostat off
+setmd time_step 0.01
+setmd skin 0.3
+setmd box_l $box_l $box_l $box_l
+
+proc coulomb_energy {} {
+    invalidate_system
+    integrate 0
+    return [lindex [analyze energy coulomb] 0]
+}
+
+# apply the changes, which use the syntax of analyze coulomb_change
+proc apply_changes {changes} {
+    set new_id [expr [setmd max_part] + 1]
+    while { [llength $changes] > 0 } {
+	switch [lindex $changes 0] {
+	    move {
+		part [lindex $changes 1] pos [lindex $changes 2] [lindex $changes 3] [lindex $changes 4]
+		set changes [lrange $changes 5 end]
+	    }
+	    charge {
+		part [lindex $changes 1] q [lindex $changes 2]
+		set changes [lrange $changes 3 end]
+	    }
+	    delete {
+		part [lindex $changes 1] delete
+		set changes [lrange $changes 2 end]
+	    }
+	    insert {
+		part $new_id pos [lindex $changes 1] [lindex $changes 2] [lindex $changes 3] \
+		    q [lindex $changes 4]
+		incr new_id
+		set changes [lrange $changes 5 end]
+	    }
+	}
+    }
+}
+
+proc check_changes {name changes} {
+    global epsilon
+    set saved {}
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	lappend saved [concat $i [part $i print pos q]]
+    }
+
+    set e0 [coulomb_energy]
+    set predicted [eval analyze coulomb_change $changes]
+    apply_changes $changes
+    set actual [expr [coulomb_energy] - $e0]
+
+    set dev [expr abs($predicted - $actual)]
+    puts "$name: change $actual, predicted $predicted, deviation $dev"
+    if { $dev > $epsilon*(abs($e0) + 1) } {
+	error "$name: coulomb_change differs from the energy difference"
+    }
+
+    # restore the configuration
+    part deleteall
+    foreach p $saved {
+	part [lindex $p 0] pos [lindex $p 1] [lindex $p 2] [lindex $p 3] q [lindex $p 4]
+    }
+}
+
+proc check_method {name} {
+    check_changes "$name move"   {move 3 1.5 7.2 0.3}
+    check_changes "$name charge" {charge 5 -2.0}
+    check_changes "$name insert" {insert 4.4 4.1 9.7 1.0}
+    check_changes "$name delete" {delete 7}
+    check_changes "$name multi"  {move 1 2.0 2.0 2.0 charge 2 0.5 insert 8.1 0.2 3.3 -1.0 delete 9}
+}
+
+if { [catch {
+    expr srand(42)
+    for { set i 0 } { $i < $n_part } { incr i } {
+	part $i pos [expr $box_l*rand()] [expr $box_l*rand()] [expr $box_l*rand()] \
+	    q [expr ($i % 2) ? -1.0 : 1.0]
+    }
+
+    inter coulomb 1.0 p3m 2.5 16 5 1.2
+    check_method "p3m"
+
+    inter coulomb 1.0 ewald 2.5 1.2 8
+    check_method "ewald"
+
+    inter coulomb 1.0 ewald 2.5 1.2 8 pme
+    check_method "ewald-pme"
+
+    part deleteall
+    inter coulomb 0.0
+} res ] } {
+    error_exit $res
+}
+
+exec rm -f $errf
+exit 0
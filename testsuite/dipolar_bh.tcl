@@ -0,0 +1,106 @@
+#  This file is part of the ESPResSo distribution (http://www.espresso.mpg.de).
+#  It is therefore subject to the ESPResSo license agreement which you accepted upon receiving the distribution
+#  and by which you are legally bound while utilizing this file in any form or way.
+#  There is NO WARRANTY, not even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  You should have received a copy of that license along with this program;
+#  if not, refer to http://www.espresso.mpg.de/license.html where its current version can be found, or
+#  write to Max-Planck-Institute for Polymer Research, Theory Group, PO Box 3148, 55021 Mainz, Germany.
+#  Copyright (c) 2002-2006; all rights reserved unless otherwise stated.
+
+# check the dipolar Barnes-Hut tree against the DAWAANR direct sum
+set errf [lindex $argv 1]
+
+source "tests_common.tcl"
+
+require_feature "MAGNETOSTATICS"
+require_feature "ROTATION"
+require_feature "DIPOLAR_BARNES_HUT"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase dipolar_bh.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "---------------------------------------------------------------"
+
+set bjerrum 2.0
+thermostat off
+setmd time_step 0.01
+setmd skin 0.3
+
+proc read_data {file} {
+    set f [open $file "r"]
+    while {![eof $f]} { blockfile $f read auto}
+    close $f
+}
+
+proc write_data {file} {
+    set f [open $file "w"]
+    blockfile $f write variable box_l
+    blockfile $f write tclvariable energy
+    blockfile $f write particles {id pos dip f torque}
+    close $f
+}
+
+# relative rms deviation of the forces and torques from the reference
+proc check_bh {theta f_epsilon t_epsilon e_epsilon} {
+    global F T energy bjerrum
+
+    inter magnetic $bjerrum bh $theta
+    invalidate_system
+    integrate 0
+
+    set df 0; set f2 0; set dt 0; set t2 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	foreach a [part $i pr f] b $F($i) {
+	    set df [expr $df + ($a - $b)*($a - $b)]
+	    set f2 [expr $f2 + $b*$b]
+	}
+	foreach a [part $i pr torque] b $T($i) {
+	    set dt [expr $dt + ($a - $b)*($a - $b)]
+	    set t2 [expr $t2 + $b*$b]
+	}
+    }
+    set rel_f [expr sqrt($df/$f2)]
+    set rel_t [expr sqrt($dt/$t2)]
+    set rel_e [expr abs(([analyze energy magnetic] - $energy)/$energy)]
+    puts "bh $theta: relative force deviation $rel_f, torque deviation $rel_t, energy deviation $rel_e"
+    if { $rel_f > $f_epsilon } {
+	error "bh $theta: force error too large"
+    }
+    if { $rel_t > $t_epsilon } {
+	error "bh $theta: torque error too large"
+    }
+    if { $rel_e > $e_epsilon } {
+	error "bh $theta: energy error too large"
+    }
+}
+
+if { [catch {
+    read_data "dipolar_bh_system.data"
+
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set F($i) [part $i pr f]
+	# the torques are set unconverted, i. e. as body frame torques
+	set T($i) [part $i pr tbf]
+    }
+
+    # here you can create the necessary snapshot, DAWAANR only runs on one node
+    if { 0 } {
+	inter magnetic $bjerrum dawaanr
+	invalidate_system
+	integrate 0
+	set energy [analyze energy magnetic]
+
+	write_data "dipolar_bh_system.data"
+    }
+
+    # without approximation, the tree reproduces the direct sum
+    check_bh 0   1e-10 1e-10 1e-10
+    check_bh 0.5 2e-3  1e-2  5e-3
+
+    part deleteall
+    inter magnetic 0.0 bh 0.5
+} res ] } {
+    error_exit $res
+}
+
+exec rm -f $errf
+exit 0
@@ -0,0 +1,85 @@
+#  This file is part of the ESPResSo distribution (http://www.espresso.mpg.de).
+#  It is therefore subject to the ESPResSo license agreement which you accepted upon receiving the distribution
+#  and by which you are legally bound while utilizing this file in any form or way.
+#  There is NO WARRANTY, not even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  You should have received a copy of that license along with this program;
+#  if not, refer to http://www.espresso.mpg.de/license.html where its current version can be found, or
+#  write to Max-Planck-Institute for Polymer Research, Theory Group, PO Box 3148, 55021 Mainz, Germany.
+#  Copyright (c) 2002-2006; all rights reserved unless otherwise stated.
+
+# check the energies of DAWAANR and the magnetic direct sum against the
+# dipole-dipole energy of a few dipoles without periodic images
+set errf [lindex $argv 1]
+
+source "tests_common.tcl"
+
+require_feature "MAGNETOSTATICS"
+require_feature "DAWAANR"
+require_feature "MAGNETIC_DIPOLAR_DIRECT_SUM"
+
+puts "------------------------------------------------------"
+puts "- Testcase dipolar_energy.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "------------------------------------------------------"
+
+if { [setmd n_nodes] > 1 } {
+    puts "Testcase dipolar_energy.tcl only runs on 1 node"
+    exec rm -f $errf
+    exit 0
+}
+
+set epsilon 1e-10
+set bjerrum 2.0
+thermostat off
+setmd time_step 0.01
+setmd skin 0.3
+setmd box_l 20 20 20
+
+# the energy of all pairs of dipoles, the dipolar prefactor is the
+# Bjerrum length, since the temperature is 0
+proc dipole_energy {} {
+    global bjerrum
+    set u 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set pi [part $i pr pos]
+	set mi [part $i pr dip]
+	for { set j [expr $i + 1] } { $j <= [setmd max_part] } { incr j } {
+	    set mj [part $j pr dip]
+	    set r [vecsub $pi [part $j pr pos]]
+	    set r2 [vecdot_product $r $r]
+	    set r3 [expr $r2*sqrt($r2)]
+	    set u [expr $u + [vecdot_product $mi $mj]/$r3 \
+		       - 3*[vecdot_product $mi $r]*[vecdot_product $mj $r]/($r3*$r2)]
+	}
+    }
+    return [expr $bjerrum*$u]
+}
+
+if { [catch {
+    part 0 pos 8.0 9.0 10.0 dip 1.0 0.0 0.0
+    part 1 pos 10.5 10.0 9.5 dip 0.0 0.8 0.6
+    part 2 pos 9.0 11.5 11.0 dip -0.6 0.0 0.8
+
+    set energy [dipole_energy]
+
+    inter magnetic $bjerrum dawaanr
+    set e_dawaanr [analyze energy magnetic]
+    puts "dawaanr: energy $e_dawaanr, expected $energy"
+    if { abs($e_dawaanr - $energy) > $epsilon } {
+	error "dawaanr: energy error too large"
+    }
+
+    inter magnetic $bjerrum mdds n_cut 0
+    set e_mdds [analyze energy magnetic]
+    puts "mdds: energy $e_mdds, expected $energy"
+    if { abs($e_mdds - $energy) > $epsilon } {
+	error "mdds: energy error too large"
+    }
+
+    part deleteall
+    inter magnetic 0.0 dawaanr
+} res ] } {
+    error_exit $res
+}
+
+exec rm -f $errf
+exit 0
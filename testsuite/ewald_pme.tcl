@@ -0,0 +1,94 @@
+#  This file is part of the ESPResSo distribution (http://www.espresso.mpg.de).
+#  It is therefore subject to the ESPResSo license agreement which you accepted upon receiving the distribution
+#  and by which you are legally bound while utilizing this file in any form or way.
+#  There is NO WARRANTY, not even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  You should have received a copy of that license along with this program;
+#  if not, refer to http://www.espresso.mpg.de/license.html where its current version can be found, or
+#  write to Max-Planck-Institute for Polymer Research, Theory Group, PO Box 3148, 55021 Mainz, Germany.
+#  Copyright (c) 2002-2006; all rights reserved unless otherwise stated.
+
+# check the particle mesh path of the Ewald sum against the direct k-space sum
+set errf [lindex $argv 1]
+
+source "tests_common.tcl"
+
+require_feature "LENNARD_JONES"
+require_feature "ELECTROSTATICS"
+require_feature "FFTW"
+
+puts "---------------------------------------------------------------"
+puts "- Testcase ewald_pme.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "---------------------------------------------------------------"
+
+set epsilon 1e-4
+thermostat off
+setmd time_step 0.01
+setmd skin 0.05
+
+proc read_data {file} {
+    set f [open $file "r"]
+    while {![eof $f]} { blockfile $f read auto}
+    close $f
+}
+
+proc calc_coulomb {} {
+    global F
+    invalidate_system
+    integrate 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set F($i) [part $i pr f]
+    }
+    return [lindex [analyze energy coulomb] 0]
+}
+
+if { [catch {
+    puts "Tests for the Ewald particle mesh path"
+    # only the particles are taken from the P3M test
+    read_data "p3m_system.data"
+
+    inter coulomb 1.0 ewald 16.0 0.14 20
+    set eng_direct [calc_coulomb]
+    array set F_direct [array get F]
+
+    inter coulomb 1.0 ewald 16.0 0.14 20 pme
+    if { [lindex [inter coulomb] 0 end] != "pme" } {
+	error "ewald-pme: method not set, got [inter coulomb]"
+    }
+    set eng_pme [calc_coulomb]
+
+    set rel_eng_error [expr abs(($eng_pme - $eng_direct)/$eng_direct)]
+    puts "ewald-pme: relative energy deviation: $rel_eng_error"
+    if { $rel_eng_error > $epsilon } {
+	error "ewald-pme: relative energy error too large"
+    }
+
+    set rmsf 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	foreach a $F($i) b $F_direct($i) {
+	    set rmsf [expr $rmsf + ($a - $b)*($a - $b)]
+	}
+    }
+    set rmsf [expr sqrt($rmsf/[setmd n_part])]
+    puts "ewald-pme: rms force deviation $rmsf"
+    if { $rmsf > $epsilon } {
+	error "ewald-pme: force error too large"
+    }
+
+    # a mesh finer than the upper limit falls back to the direct sum
+    inter coulomb 1.0 ewald 16.0 0.03 10 pme
+    set eng_pme [calc_coulomb]
+    array set F_pme [array get F]
+    inter coulomb 1.0 ewald 16.0 0.03 10
+    set eng_direct [calc_coulomb]
+    if { $eng_pme != $eng_direct } {
+	error "ewald-pme: fallback to the direct sum differs, $eng_pme vs. $eng_direct"
+    }
+
+    part deleteall
+    inter coulomb 0.0
+} res ] } {
+    error_exit $res
+}
+
+exec rm -f $errf
+exit 0
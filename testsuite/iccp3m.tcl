@@ -0,0 +1,118 @@
+#  This file is part of the ESPResSo distribution (http://www.espresso.mpg.de).
+#  It is therefore subject to the ESPResSo license agreement which you accepted upon receiving the distribution
+#  and by which you are legally bound while utilizing this file in any form or way.
+#  There is NO WARRANTY, not even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  You should have received a copy of that license along with this program;
+#  if not, refer to http://www.espresso.mpg.de/license.html where its current version can be found, or
+#  write to Max-Planck-Institute for Polymer Research, Theory Group, PO Box 3148, 55021 Mainz, Germany.
+#  Copyright (c) 2002-2006; all rights reserved unless otherwise stated.
+
+# check the Anderson mixing and the extrapolated start values of ICC*
+# against the plain relaxation scheme
+set errf [lindex $argv 1]
+
+source "tests_common.tcl"
+
+require_feature "ELECTROSTATICS"
+require_feature "FFTW"
+require_feature "LENNARD_JONES"
+require_feature "EXTERNAL_FORCES"
+require_feature "MAGNETOSTATICS" off
+
+puts "-----------------------------------------------"
+puts "- Testcase iccp3m.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "-----------------------------------------------"
+
+set epsilon 1e-6
+thermostat off
+setmd time_step 0.01
+setmd skin 0.3
+setmd box_l 10 10 10
+
+# two dielectric walls of 100 surface elements each, with ions in between
+set n 0
+set areas ""; set normals ""; set dielectric ""
+foreach z {2.5 7.5} nz {1 -1} {
+    for { set i 0 } { $i < 10 } { incr i } {
+	for { set j 0 } { $j < 10 } { incr j } {
+	    part $n pos [expr $i + 0.5] [expr $j + 0.5] $z q 0.01 type 0 fix
+	    lappend areas 1.0
+	    lappend normals 0 0 $nz
+	    lappend dielectric 20.0
+	    incr n
+	}
+    }
+}
+set last_ind_id [expr $n - 1]
+expr srand(7)
+for { set k 0 } { $k < 20 } { incr k } {
+    part $n pos [expr 10*rand()] [expr 10*rand()] [expr 3.5 + 3*rand()] q [expr $k%2 ? 1 : -1] type 1
+    incr n
+}
+
+inter 1 1 lennard-jones 1.0 1.0 1.12246 0.25 0
+inter 0 1 lennard-jones 1.0 1.0 1.12246 0.25 0
+inter coulomb 1.0 p3m 2.0 16 5 1.6
+
+set start {}
+for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+    lappend start [concat $i [part $i print pos v q]]
+}
+
+# solve for the induced charges, then run some MD steps, iterating
+# after each. Returns the total number of iterations and the final
+# induced charges.
+proc run_icc {mixing extrapolation} {
+    global start last_ind_id areas normals dielectric
+
+    foreach p $start {
+	eval part [lindex $p 0] pos [lrange $p 1 3] v [lrange $p 4 6] q [lindex $p 7]
+    }
+    invalidate_system
+    integrate 0
+
+    iccp3m mixing $mixing
+    iccp3m extrapolation $extrapolation
+    set iterations [iccp3m $last_ind_id 1.0 200 1e-8 0.7 $areas $normals $dielectric]
+    for { set s 0 } { $s < 10 } { incr s } {
+	integrate 1
+	incr iterations [iccp3m iterate]
+    }
+
+    set q {}
+    for { set i 0 } { $i <= $last_ind_id } { incr i } {
+	lappend q [part $i print q]
+    }
+    return [list $iterations $q]
+}
+
+if { [catch {
+    # the plain relaxation
+    set ref [run_icc 0 0]
+    set qmax 0
+    foreach q [lindex $ref 1] {
+	if { abs($q) > $qmax } { set qmax [expr abs($q)] }
+    }
+    puts "mixing 0 extrapolation 0: [lindex $ref 0] iterations"
+
+    foreach {mixing extrapolation} {5 0 0 1 5 1 5 2} {
+	set res [run_icc $mixing $extrapolation]
+	set dev 0
+	foreach q [lindex $res 1] q0 [lindex $ref 1] {
+	    if { abs($q - $q0) > $dev } { set dev [expr abs($q - $q0)] }
+	}
+	set dev [expr $dev/$qmax]
+	puts "mixing $mixing extrapolation $extrapolation: [lindex $res 0] iterations, relative charge deviation $dev"
+	if { $dev > $epsilon } {
+	    error "mixing $mixing extrapolation $extrapolation: induced charges differ from the plain relaxation"
+	}
+	if { [lindex $res 0] >= [lindex $ref 0] } {
+	    error "mixing $mixing extrapolation $extrapolation: no fewer iterations than the plain relaxation"
+	}
+    }
+} res ] } {
+    error_exit $res
+}
+
+exec rm -f $errf
+exit 0
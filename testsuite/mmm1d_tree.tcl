@@ -0,0 +1,105 @@
+#  This file is part of the ESPResSo distribution (http://www.espresso.mpg.de).
+#  It is therefore subject to the ESPResSo license agreement which you accepted upon receiving the distribution
+#  and by which you are legally bound while utilizing this file in any form or way.
+#  There is NO WARRANTY, not even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  You should have received a copy of that license along with this program;
+#  if not, refer to http://www.espresso.mpg.de/license.html where its current version can be found, or
+#  write to Max-Planck-Institute for Polymer Research, Theory Group, PO Box 3148, 55021 Mainz, Germany.
+#  Copyright (c) 2002-2006; all rights reserved unless otherwise stated.
+
+# check the MMM1D Barnes-Hut tree against the pairwise MMM1D sum
+set errf [lindex $argv 1]
+
+source "tests_common.tcl"
+
+require_feature "ELECTROSTATICS"
+require_feature "PARTIAL_PERIODIC"
+
+puts "------------------------------------------------"
+puts "- Testcase mmm1d_tree.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "------------------------------------------------"
+
+thermostat off
+setmd time_step 0.01
+setmd skin 0.05
+
+proc read_data {file} {
+    set f [open $file "r"]
+    while {![eof $f]} { blockfile $f read auto}
+    close $f
+}
+
+# relative rms deviation of the forces and the energy from the pairwise sum
+proc check_tree {theta f_epsilon e_epsilon} {
+    global F energy
+
+    inter coulomb 1.0 mmm1d 6.0 3 0.0001 tree $theta
+    invalidate_system
+    integrate 0
+
+    set df 0; set f2 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	foreach a [part $i pr f] b $F($i) {
+	    set df [expr $df + ($a - $b)*($a - $b)]
+	    set f2 [expr $f2 + $b*$b]
+	}
+    }
+    set rel_f [expr sqrt($df/$f2)]
+    set rel_e [expr abs(([analyze energy coulomb] - $energy)/$energy)]
+    puts "tree $theta: relative force deviation $rel_f, energy deviation $rel_e"
+    if { $rel_f > $f_epsilon } {
+	error "tree $theta: force error too large"
+    }
+    if { $rel_e > $e_epsilon } {
+	error "tree $theta: energy error too large"
+    }
+}
+
+if { [catch {
+    read_data "mmm1d_system.data"
+    setmd periodic 0 0 1
+
+    # the reference, pairwise on the n-squared cell system
+    cellsystem nsquare
+    inter coulomb 1.0 mmm1d 6.0 3 0.0001
+    invalidate_system
+    integrate 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set F($i) [part $i pr f]
+    }
+    set energy [analyze energy coulomb]
+
+    # the tree also works with the domain decomposition
+    inter coulomb 1.0 mmm1d 6.0 3 0.0001 tree 0.1
+    cellsystem domain_decomposition
+    check_tree 0.1 1e-4 1e-4
+    check_tree 0.5 5e-3 1e-4
+
+    # the tree yields the complete force, so that it has to be evaluated
+    # in every step also with multiple time stepping
+    inter coulomb 1.0 mmm1d 6.0 3 0.0001 tree 0.1
+    integrate set nvt respa 3
+    integrate 2
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	set F($i) [part $i pr f]
+    }
+    integrate set nvt
+    invalidate_system
+    integrate 0
+    set maxdev 0
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	foreach a [part $i pr f] b $F($i) {
+	    set dev [expr abs($a - $b)]
+	    if { $dev > $maxdev } { set maxdev $dev }
+	}
+    }
+    puts "respa 3: maximal force deviation from the plain integrator $maxdev"
+    if { $maxdev > 1e-10 } {
+	error "the tree is not evaluated in every step with respa"
+    }
+} res ] } {
+    error_exit $res
+}
+
+exec rm -f $errf
+exit 0
@@ -0,0 +1,116 @@
+#  This file is part of the ESPResSo distribution (http://www.espresso.mpg.de).
+#  It is therefore subject to the ESPResSo license agreement which you accepted upon receiving the distribution
+#  and by which you are legally bound while utilizing this file in any form or way.
+#  There is NO WARRANTY, not even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+#  You should have received a copy of that license along with this program;
+#  if not, refer to http://www.espresso.mpg.de/license.html where its current version can be found, or
+#  write to Max-Planck-Institute for Polymer Research, Theory Group, PO Box 3148, 55021 Mainz, Germany.
+#  Copyright (c) 2002-2006; all rights reserved unless otherwise stated.
+
+# check the multiple time stepping of the long range forces
+set errf [lindex $argv 1]
+
+source "tests_common.tcl"
+
+require_feature "ELECTROSTATICS"
+require_feature "FFTW"
+require_feature "LENNARD_JONES"
+
+puts "---------------------------------------------"
+puts "- Testcase respa.tcl running on [format %02d [setmd n_nodes]] nodes: -"
+puts "---------------------------------------------"
+
+set epsilon 1e-10
+thermostat off
+setmd time_step 0.01
+setmd skin 0.3
+
+proc read_data {file} {
+    set f [open $file "r"]
+    while {![eof $f]} { blockfile $f read auto}
+    close $f
+}
+
+proc save_config {} {
+    set saved {}
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	lappend saved [concat $i [part $i print pos v]]
+    }
+    return $saved
+}
+
+proc restore_config {saved} {
+    foreach p $saved {
+	eval part [lindex $p 0] pos [lrange $p 1 3] v [lrange $p 4 6]
+    }
+    invalidate_system
+}
+
+# maximal relative deviation of the total energy from its initial value
+# over the given number of integration blocks
+proc energy_drift {blocks steps} {
+    set e0 [analyze energy total]
+    set drift 0
+    for { set b 0 } { $b < $blocks } { incr b } {
+	integrate $steps
+	set d [expr abs(([analyze energy total] - $e0)/$e0)]
+	if { $d > $drift } { set drift $d }
+    }
+    return $drift
+}
+
+if { [catch {
+    read_data "p3m_system.data"
+    # shifted, so that the energy is continuous
+    inter 0 0 lennard-jones 1.0 1.0 1.12246 0.25 0.0
+
+    # some random initial velocities
+    expr srand(17)
+    for { set i 0 } { $i <= [setmd max_part] } { incr i } {
+	part $i v [expr rand() - 0.5] [expr rand() - 0.5] [expr rand() - 0.5]
+    }
+    set start [save_config]
+
+    # the plain velocity Verlet integrator
+    integrate set nvt
+    integrate 50
+    set plain [save_config]
+
+    # respa 1 has to reproduce it
+    restore_config $start
+    integrate set nvt respa 1
+    integrate 50
+    set maxdev 0
+    foreach a [save_config] b $plain {
+	foreach x [lrange $a 1 end] y [lrange $b 1 end] {
+	    set d [expr abs($x - $y)]
+	    if { $d > $maxdev } { set maxdev $d }
+	}
+    }
+    puts "respa 1: maximal deviation from the plain integrator $maxdev"
+    if { $maxdev > $epsilon } {
+	error "respa 1 does not reproduce the plain integrator"
+    }
+
+    # the long range forces change slowly, so the energy drift should
+    # not grow much for longer intervals
+    restore_config $start
+    integrate set nvt
+    set drift0 [energy_drift 10 40]
+    puts "plain: relative energy drift $drift0"
+    foreach k {2 4 8} {
+	restore_config $start
+	integrate set nvt respa $k
+	set drift [energy_drift 10 40]
+	puts "respa $k: relative energy drift $drift"
+	if { $drift > 2*$drift0 } {
+	    error "respa $k: energy drift too large"
+	}
+    }
+    integrate set nvt
+} res ] } {
+    error_exit $res
+}
+
+exec rm -f $errf
+exit 0
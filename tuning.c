@@ -15,6 +15,10 @@
 #include "utils.h"
 #include "communication.h"
 #include "errorhandling.h"
+#include "grid.h"
+#include "integrate.h"
+#include "global.h"
+#include "particle_data.h"
 
 int timing_samples = 0;
 
@@ -60,3 +64,44 @@ double time_force_calc(int default_samples)
   markTime();
   return diffTime()/rds;
 }
+
+double time_integration(int steps)
+{
+  Particle *saved;
+  double saved_time = sim_time, pos[3], step_time;
+  int i, j;
+
+  if (mpi_integrate(0))
+    return -1;
+
+  saved = malloc(n_total_particles*sizeof(Particle));
+  mpi_get_particles(saved, NULL);
+
+  markTime();
+  if (mpi_integrate(steps)) {
+    free(saved);
+    return -1;
+  }
+  markTime();
+  step_time = diffTime()/steps;
+
+  /* put back the configuration from before the timing run */
+  for (i = 0; i < n_total_particles; i++) {
+    for (j = 0; j < 3; j++)
+      pos[j] = saved[i].r.p[j];
+    unfold_position(pos, saved[i].l.i);
+    place_particle(saved[i].p.identity, pos);
+    set_particle_v(saved[i].p.identity, saved[i].m.v);
+    set_particle_f(saved[i].p.identity, saved[i].f.f);
+#ifdef ROTATION
+    set_particle_quat(saved[i].p.identity, saved[i].r.quat);
+    set_particle_omega(saved[i].p.identity, saved[i].m.omega);
+    set_particle_torque(saved[i].p.identity, saved[i].f.torque);
+#endif
+  }
+  free(saved);
+  sim_time = saved_time;
+  mpi_bcast_parameter(FIELD_SIMTIME);
+
+  return step_time;
+}
@@ -24,6 +24,14 @@ extern int timing_samples;
     \ref timing_samples is not set. */
 double time_force_calc(int default_samples);
 
+/** returns the time per step for some integration steps, in ms.
+    Performs \ref mpi_integrate (steps), so that the timing includes the
+    Verlet list updates and the particle exchange. Afterwards the particle
+    positions, velocities and forces and the simulation time are restored.
+    Returns -1 if the integration fails.
+    @param steps the number of integration steps to time. */
+double time_integration(int steps);
+
 /** callback for \ref timing_samples */
 int timings_callback(Tcl_Interp *interp, void *data);
 
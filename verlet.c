@@ -9,6 +9,7 @@
 /** \file verlet.c   Verlet list.
  *  For more information see  \ref verlet.h "verlet.h"
  */
+#include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,12 +30,27 @@
 /** Granularity of the verlet list */
 #define LIST_INCREMENT 20
 
+/** Nonblocking collectives are only available from MPI-2.2/3 on */
+#if defined(MPI_VERSION) && (MPI_VERSION >= 3)
+#define ASYNC_VERLET_CRITERION
+#endif
+
 /*****************************************
  * Variables 
  *****************************************/
 
 int rebuild_verletlist = 1;
 
+int rebuild_vlist_pending = 0;
+
+#ifdef ASYNC_VERLET_CRITERION
+/** request of the pending reduction started by \ref announce_rebuild_vlist_start. */
+static MPI_Request rebuild_vlist_request = MPI_REQUEST_NULL;
+/** send and receive buffers of the pending reduction. They have to
+    stay untouched until the reduction has completed, therefore
+    \ref rebuild_verletlist itself cannot be used. */
+static int rebuild_vlist_local, rebuild_vlist_sum;
+#endif
 
 
 /** \name Privat Functions */
@@ -364,6 +380,9 @@ void announce_rebuild_vlist()
 {
   int sum;
 
+  /* a still pending criterion is superseded by this one */
+  announce_rebuild_vlist_wait();
+
   MPI_Allreduce(&rebuild_verletlist, &sum, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
   rebuild_verletlist = (sum > 0) ? 1 : 0;
   
@@ -371,6 +390,41 @@ void announce_rebuild_vlist()
 }
 
 
+void announce_rebuild_vlist_start()
+{
+#ifdef ASYNC_VERLET_CRITERION
+  announce_rebuild_vlist_wait();
+
+  rebuild_vlist_local = rebuild_verletlist;
+  MPI_Iallreduce(&rebuild_vlist_local, &rebuild_vlist_sum, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD,
+		 &rebuild_vlist_request);
+  rebuild_vlist_pending = 1;
+
+  INTEG_TRACE(fprintf(stderr,"%d: announce_rebuild_vlist_start: local rebuild_verletlist=%d\n",this_node,rebuild_verletlist));
+#else
+  announce_rebuild_vlist();
+#endif
+}
+
+void announce_rebuild_vlist_wait()
+{
+#ifdef ASYNC_VERLET_CRITERION
+  MPI_Status status;
+
+  if (!rebuild_vlist_pending)
+    return;
+
+  MPI_Wait(&rebuild_vlist_request, &status);
+  rebuild_vlist_pending = 0;
+  /* the flag might have been announced again in between (e.g. by
+     RATTLE), so only ever switch it on */
+  if (rebuild_vlist_sum > 0)
+    rebuild_verletlist = 1;
+
+  INTEG_TRACE(fprintf(stderr,"%d: announce_rebuild_vlist_wait: rebuild_verletlist=%d\n",this_node,rebuild_verletlist));
+#endif
+}
+
 /* Callback functions */
 /************************************************************/
 
@@ -67,6 +67,10 @@ typedef struct {
 /** If non-zero, the verlet list has to be rebuilt. */
 extern int rebuild_verletlist;
 
+/** If non-zero, the global value of \ref rebuild_verletlist is still
+    being reduced, see \ref announce_rebuild_vlist_start. */
+extern int rebuild_vlist_pending;
+
 /*@}*/
 
 /** \name Exported Functions */
@@ -104,6 +108,20 @@ void calculate_verlet_virials(int v_comp);
 /** spread the verlet criterion across the nodes. */
 void announce_rebuild_vlist();
 
+/** start spreading the verlet criterion across the nodes without
+    waiting for the result. This allows to overlap the global reduction
+    with the ghost position update, which is needed anyways unless the
+    particles have to be resorted. Falls back to \ref
+    announce_rebuild_vlist if the MPI implementation does not provide
+    nonblocking collectives. */
+void announce_rebuild_vlist_start();
+
+/** complete a verlet criterion reduction started by \ref
+    announce_rebuild_vlist_start. Afterwards, \ref rebuild_verletlist
+    has the same value on all nodes. Does nothing if no reduction is
+    pending. */
+void announce_rebuild_vlist_wait();
+
 /** Callback for integrator flag tcl:verletflag c:rebuild_verletlist (= 0 or 1).
     <ul>
     <li> 1 means the integrator rebuilds the verlet list befor the